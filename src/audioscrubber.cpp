@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audioscrubber.h"
+#include <QMutexLocker>
+#include <QtMath>
+#include <QDebug>
+#include <Mlt.h>
+#include "mltcontroller.h"
+
+// The window in frames of audio kept ahead of and behind the play head
+// in the direction of play.
+static const int kFramesAhead = 100;
+static const int kFramesBehind = 50;
+// Only this much faster than normal is stretched; beyond it is too sparse.
+static const int kMaxSpeed = 8;
+// The clips within this many frames of the play head are copied.
+static const int kCopyRange = kFramesAhead * kMaxSpeed;
+
+// Copies what the XML of a service does not get from its producer.
+static void copyProperties(Mlt::Properties& from, Mlt::Properties& to)
+{
+    for (int i = 0; i < from.count(); i++) {
+        const char* name = from.get_name(i);
+        if (name && name[0] != '_' && qstrcmp(name, "mlt_type") && qstrcmp(name, "mlt_service") && from.get(i))
+            to.set(name, from.get(i));
+    }
+}
+
+static void copyFilters(Mlt::Service& from, Mlt::Service& to)
+{
+    for (int i = 0; i < from.filter_count(); i++) {
+        QScopedPointer<Mlt::Filter> filter(from.filter(i));
+        if (filter && filter->is_valid() && !filter->get_int("_loader")) {
+            Mlt::Filter copy(MLT.profile(), filter->get("mlt_service"));
+            if (copy.is_valid()) {
+                copyProperties(*filter, copy);
+                to.attach(copy);
+            }
+        }
+    }
+}
+
+// Returns the span of the clips of a playlist that overlap first to last.
+static void clipRange(Mlt::Playlist& playlist, int first, int last, int& start, int& end)
+{
+    int i = playlist.get_clip_index_at(qMax(0, first));
+    int j = playlist.get_clip_index_at(last);
+    if (i >= playlist.count()) {
+        start = end = -1;
+        return;
+    }
+    if (j >= playlist.count())
+        j = playlist.count() - 1;
+    start = playlist.clip_start(i);
+    end = playlist.clip_start(j) + playlist.clip_length(j);
+}
+
+// Copies the clips of a playlist from start to end so that they begin at
+// offset in the copy.
+static void copyClips(Mlt::Playlist& from, int start, int end, int offset, Mlt::Playlist& to)
+{
+    if (start < 0)
+        return;
+    if (start > offset)
+        to.blank(start - offset - 1);
+    for (int i = from.get_clip_index_at(start); i < from.count() && from.clip_start(i) < end; i++) {
+        QScopedPointer<Mlt::ClipInfo> info(from.clip_info(i));
+        if (!info)
+            break;
+        // A cut keeps its in and out points and filters.
+        if (from.is_blank(i))
+            to.blank(info->frame_count - 1);
+        else
+            to.append(*info->cut);
+    }
+    copyFilters(from, to);
+}
+
+AudioScrubber::AudioScrubber(QObject* parent)
+    : QThread(parent)
+    , m_filter(0)
+    , m_isXmlChanged(false)
+    , m_offset(0)
+    , m_length(0)
+    , m_position(0)
+    , m_speed(0.0)
+    , m_frequency(48000)
+    , m_channels(2)
+    , m_isStopping(false)
+{
+    mlt_filter filter = mlt_filter_new();
+    if (filter) {
+        filter->process = process;
+        mlt_properties_set_data(MLT_FILTER_PROPERTIES(filter), "_scrubber", this, 0, NULL, NULL);
+        m_filter = new Mlt::Filter(filter);
+        mlt_filter_close(filter);
+    }
+    setObjectName("AudioScrubber");
+    start(QThread::LowPriority);
+}
+
+AudioScrubber::~AudioScrubber()
+{
+    stop();
+    delete m_filter;
+}
+
+// Copies the clips around position, or stops using a copy without a producer.
+void AudioScrubber::setProducer(Mlt::Producer* producer, int position)
+{
+    int offset = 0;
+    int length = 0;
+    QString xml;
+    if (producer && producer->is_valid())
+        xml = rangeXML(*producer, position - kCopyRange, position + kCopyRange, offset, length);
+    QMutexLocker locker(&m_mutex);
+    m_xml = xml;
+    m_isXmlChanged = true;
+    m_offset = offset;
+    m_length = xml.isEmpty()? 0 : length;
+    m_blocks.clear();
+    m_condition.wakeOne();
+}
+
+bool AudioScrubber::covers(int position) const
+{
+    QMutexLocker locker(&m_mutex);
+    return position >= m_offset && position < m_offset + m_length;
+}
+
+// Playlists and timelines can be long, so only their clips that overlap first
+// to last are copied. Anything else is copied whole.
+QString AudioScrubber::rangeXML(Mlt::Producer& producer, int first, int last, int& offset, int& length)
+{
+    offset = 0;
+    length = producer.get_length();
+    if (producer.type() == playlist_type) {
+        Mlt::Playlist playlist(producer);
+        int end;
+        clipRange(playlist, first, last, offset, end);
+        if (offset < 0)
+            return QString();
+        length = end - offset;
+        Mlt::Playlist copy;
+        copyClips(playlist, offset, end, offset, copy);
+        return MLT.XML(&copy);
+    } else if (producer.type() == tractor_type) {
+        Mlt::Tractor tractor(producer);
+        QVector<int> starts(tractor.count(), -1);
+        QVector<int> ends(tractor.count(), -1);
+        int end = 0;
+        offset = length;
+        for (int i = 0; i < tractor.count(); i++) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(i));
+            if (track && track->type() == playlist_type) {
+                Mlt::Playlist playlist(*track);
+                clipRange(playlist, first, last, starts[i], ends[i]);
+                if (starts[i] >= 0) {
+                    offset = qMin(offset, starts[i]);
+                    end = qMax(end, ends[i]);
+                }
+            }
+        }
+        if (end <= offset)
+            return QString();
+        length = end - offset;
+
+        Mlt::Tractor copy(MLT.profile());
+        for (int i = 0; i < tractor.count(); i++) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(i));
+            Mlt::Playlist playlist;
+            if (track && track->type() == playlist_type) {
+                Mlt::Playlist from(*track);
+                copyClips(from, starts[i], ends[i], offset, playlist);
+                copyProperties(from, playlist);
+            }
+            copy.set_track(playlist, i);
+        }
+        // The transitions mix the audio of the tracks.
+        QList<Mlt::Service*> field;
+        Mlt::Service* service = tractor.producer();
+        while (service && service->is_valid()
+               && (service->type() == filter_type || service->type() == transition_type)) {
+            field.prepend(service);
+            service = service->producer();
+        }
+        delete service;
+        foreach (Mlt::Service* s, field) {
+            if (s->type() == transition_type) {
+                Mlt::Transition transition(*s);
+                Mlt::Transition t(MLT.profile(), s->get("mlt_service"));
+                if (!t.is_valid() || (transition.get_out() > 0 && transition.get_out() < offset))
+                    continue;
+                copyProperties(transition, t);
+                if (transition.get_out() > 0)
+                    t.set_in_and_out(qMax(0, transition.get_in() - offset), transition.get_out() - offset);
+                copy.plant_transition(t, t.get_int("a_track"), t.get_int("b_track"));
+            } else {
+                Mlt::Filter f(MLT.profile(), s->get("mlt_service"));
+                if (f.is_valid()) {
+                    copyProperties(*s, f);
+                    copy.plant_filter(f, f.get_int("track"));
+                }
+            }
+        }
+        qDeleteAll(field);
+        copyFilters(tractor, copy);
+        return MLT.XML(&copy);
+    }
+    return MLT.XML(&producer);
+}
+
+void AudioScrubber::setPosition(int position, double speed)
+{
+    QMutexLocker locker(&m_mutex);
+    if (position != m_position || speed != m_speed) {
+        m_position = position;
+        m_speed = speed;
+        trim();
+        m_condition.wakeOne();
+    }
+}
+
+void AudioScrubber::setAudioFormat(int frequency, int channels)
+{
+    QMutexLocker locker(&m_mutex);
+    if (frequency != m_frequency || channels != m_channels) {
+        m_frequency = frequency;
+        m_channels = channels;
+        m_blocks.clear();
+        m_condition.wakeOne();
+    }
+}
+
+void AudioScrubber::stop()
+{
+    m_mutex.lock();
+    m_isStopping = true;
+    m_condition.wakeOne();
+    m_mutex.unlock();
+    wait();
+}
+
+void AudioScrubber::run()
+{
+    Mlt::Producer* producer = 0;
+    QMutexLocker locker(&m_mutex);
+    while (!m_isStopping) {
+        if (m_isXmlChanged) {
+            QString xml = m_xml;
+            m_isXmlChanged = false;
+            locker.unlock();
+            delete producer;
+            producer = 0;
+            if (!xml.isEmpty()) {
+                producer = new Mlt::Producer(MLT.profile(), "xml-string", xml.toUtf8().constData());
+                if (producer->is_valid()) {
+                    producer->set_speed(1.0);
+                } else {
+                    delete producer;
+                    producer = 0;
+                }
+            }
+            locker.relock();
+            continue;
+        }
+        int position = nextMissing();
+        if (!producer || position < 0) {
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+        int frequency = m_frequency;
+        int channels = m_channels;
+        int offset = m_offset;
+        locker.unlock();
+
+        // Decoding continues forward from the last frame without seeking.
+        if (producer->position() != position - offset)
+            producer->seek(position - offset);
+        QByteArray block;
+        Mlt::Frame* frame = producer->get_frame();
+        if (frame && frame->is_valid()) {
+            mlt_audio_format format = mlt_audio_s16;
+            int frameFrequency = frequency;
+            int frameChannels = channels;
+            int samples = mlt_sample_calculator(MLT.profile().fps(), frequency, position);
+            const char* data = (const char*) frame->get_audio(format, frameFrequency, frameChannels, samples);
+            if (data && format == mlt_audio_s16 && frameFrequency == frequency && frameChannels == channels)
+                block = QByteArray(data, samples * channels * sizeof(qint16));
+        }
+        delete frame;
+
+        locker.relock();
+        if (!m_isXmlChanged && frequency == m_frequency && channels == m_channels)
+            m_blocks.insert(position, block);
+    }
+    locker.unlock();
+    delete producer;
+}
+
+// Returns the frame nearest the play head in the window that is not decoded
+// yet, or -1.
+int AudioScrubber::nextMissing() const
+{
+    int direction = (m_speed < 0.0)? -1 : 1;
+    for (int i = 0; i <= kFramesAhead; i++) {
+        int position = m_position + i * direction;
+        if (position < m_offset || position >= m_offset + m_length)
+            break;
+        if (!m_blocks.contains(position))
+            return position;
+    }
+    for (int i = 1; i <= kFramesBehind; i++) {
+        int position = m_position - i * direction;
+        if (position < m_offset || position >= m_offset + m_length)
+            break;
+        if (!m_blocks.contains(position))
+            return position;
+    }
+    return -1;
+}
+
+void AudioScrubber::trim()
+{
+    int direction = (m_speed < 0.0)? -1 : 1;
+    int first = m_position - qMax(kFramesAhead, kFramesBehind);
+    int last = m_position + qMax(kFramesAhead, kFramesBehind);
+    if (direction > 0)
+        first = m_position - kFramesBehind;
+    else
+        last = m_position + kFramesBehind;
+    QHash<int, QByteArray>::iterator i = m_blocks.begin();
+    while (i != m_blocks.end()) {
+        if (i.key() < first || i.key() > last)
+            i = m_blocks.erase(i);
+        else
+            ++i;
+    }
+}
+
+bool AudioScrubber::read(int position, double speed, int frequency, int channels, int samples, QVector<qint16>& output)
+{
+    QMutexLocker locker(&m_mutex);
+    if (frequency != m_frequency || channels != m_channels)
+        return false;
+    if (speed == 0.0) {
+        // Scrubbing plays the frame's own audio.
+        if (!m_blocks.contains(position) || m_blocks[position].isEmpty())
+            return false;
+        const QByteArray& block = m_blocks[position];
+        output.fill(0, samples * channels);
+        memcpy(output.data(), block.constData(), qMin(block.size(), output.size() * int(sizeof(qint16))));
+        return true;
+    }
+    // Gather the frames this one spans at the speed, reversed when playing
+    // backwards.
+    int count = qRound(qAbs(speed));
+    if (count < 1 || count > kMaxSpeed)
+        return false;
+    int direction = (speed < 0.0)? -1 : 1;
+    QVector<qint16> input;
+    for (int i = 0; i < count; i++) {
+        int p = position + i * direction;
+        if (!m_blocks.contains(p) || m_blocks[p].isEmpty())
+            return false;
+        const qint16* data = (const qint16*) m_blocks[p].constData();
+        int n = m_blocks[p].size() / sizeof(qint16) / channels;
+        if (direction > 0) {
+            for (int j = 0; j < n * channels; j++)
+                input << data[j];
+        } else {
+            for (int j = n - 1; j >= 0; j--)
+                for (int c = 0; c < channels; c++)
+                    input << data[j * channels + c];
+        }
+    }
+    locker.unlock();
+    stretch(input, channels, samples, output);
+    return true;
+}
+
+// Shortens or lengthens input to samples by overlap-adding windowed grains
+// taken at a different rate than they are placed, which keeps the pitch.
+void AudioScrubber::stretch(const QVector<qint16>& input, int channels, int samples, QVector<qint16>& output)
+{
+    const int grain = 1024;
+    const int hopOut = grain / 2;
+    int inputSamples = input.size() / channels;
+    double hopIn = double(hopOut) * inputSamples / qMax(1, samples);
+    QVector<float> window(grain);
+    for (int i = 0; i < grain; i++)
+        window[i] = 0.5f - 0.5f * qCos(2.0 * M_PI * i / (grain - 1));
+
+    QVector<float> sum(samples * channels, 0.0f);
+    QVector<float> weight(samples, 0.0f);
+    for (int out = -hopOut, k = -1; out < samples; out += hopOut, k++) {
+        int in = qRound(k * hopIn);
+        for (int i = 0; i < grain; i++) {
+            int o = out + i;
+            int s = in + i;
+            if (o < 0 || o >= samples || s < 0 || s >= inputSamples)
+                continue;
+            for (int c = 0; c < channels; c++)
+                sum[o * channels + c] += window[i] * input[s * channels + c];
+            weight[o] += window[i];
+        }
+    }
+    output.resize(samples * channels);
+    for (int o = 0; o < samples; o++) {
+        float w = weight[o] > 0.001f? weight[o] : 1.0f;
+        for (int c = 0; c < channels; c++)
+            output[o * channels + c] = qBound(-32768, qRound(sum[o * channels + c] / w), 32767);
+    }
+}
+
+mlt_frame AudioScrubber::process(mlt_filter filter, mlt_frame frame)
+{
+    mlt_frame_push_audio(frame, filter);
+    mlt_frame_push_audio(frame, (void*) getAudio);
+    return frame;
+}
+
+int AudioScrubber::getAudio(mlt_frame frame, void** buffer, mlt_audio_format* format,
+                            int* frequency, int* channels, int* samples)
+{
+    mlt_filter filter = (mlt_filter) mlt_frame_pop_audio(frame);
+    AudioScrubber* scrubber = (AudioScrubber*) mlt_properties_get_data(MLT_FILTER_PROPERTIES(filter), "_scrubber", NULL);
+    double speed = mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame), "_speed");
+
+    // Normal playback decodes as usual.
+    QVector<qint16> output;
+    if (speed == 1.0 || *format != mlt_audio_s16 || *samples <= 0
+            || !scrubber->read(mlt_frame_get_position(frame), speed, *frequency, *channels, *samples, output))
+        return mlt_frame_get_audio(frame, buffer, format, frequency, channels, samples);
+
+    int size = output.size() * sizeof(qint16);
+    void* data = mlt_pool_alloc(size);
+    memcpy(data, output.constData(), size);
+    mlt_frame_set_audio(frame, data, *format, size, mlt_pool_release);
+    *buffer = data;
+    return 0;
+}
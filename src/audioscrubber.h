@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUDIOSCRUBBER_H
+#define AUDIOSCRUBBER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QByteArray>
+#include <QVector>
+#include <framework/mlt_types.h>
+
+namespace Mlt {
+    class Filter;
+    class Producer;
+}
+
+// Decodes the audio around the play head ahead of time on its own thread,
+// from a copy of the clips of the player's producer around the play head,
+// into a window of per-frame blocks.
+// Its filter, attached to the player's consumer, answers the audio of paused
+// and fast or reverse frames from the window instead of decoding it again:
+// scrubbing gets the block of the frame, and other speeds get the blocks the
+// frame spans, time-stretched to one frame without changing the pitch.
+class AudioScrubber : public QThread
+{
+    Q_OBJECT
+public:
+    explicit AudioScrubber(QObject* parent = 0);
+    ~AudioScrubber();
+    Mlt::Filter* filter() const { return m_filter; }
+    void setProducer(Mlt::Producer* producer, int position);
+    bool covers(int position) const;
+    void setPosition(int position, double speed);
+    void setAudioFormat(int frequency, int channels);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    static QString rangeXML(Mlt::Producer& producer, int first, int last, int& offset, int& length);
+    int nextMissing() const;
+    void trim();
+    bool read(int position, double speed, int frequency, int channels, int samples, QVector<qint16>& output);
+    static void stretch(const QVector<qint16>& input, int channels, int samples, QVector<qint16>& output);
+    static mlt_frame process(mlt_filter filter, mlt_frame frame);
+    static int getAudio(mlt_frame frame, void** buffer, mlt_audio_format* format,
+                        int* frequency, int* channels, int* samples);
+
+    Mlt::Filter* m_filter;
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    QHash<int, QByteArray> m_blocks; // empty when the frame has no audio
+    QString m_xml;
+    bool m_isXmlChanged;
+    int m_offset; // of the copy in the player's producer
+    int m_length;
+    int m_position;
+    double m_speed;
+    int m_frequency;
+    int m_channels;
+    bool m_isStopping;
+};
+
+#endif // AUDIOSCRUBBER_H
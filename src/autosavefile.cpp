@@ -19,6 +19,7 @@
  */
 
 #include "autosavefile.h"
+#include "autosavejournal.h"
 
 #include <QtCore/QDir>
 #include <QtCore/QStandardPaths>
@@ -42,14 +43,18 @@ AutoSaveFile::AutoSaveFile(const QString &filename, QObject *parent)
 
 AutoSaveFile::~AutoSaveFile()
 {
-    if (!fileName().isEmpty())
+    if (!fileName().isEmpty()) {
         remove();
+        QFile::remove(AutosaveJournal::journalFileName(fileName()));
+    }
 }
 
 void AutoSaveFile::changeManagedFile(const QString &filename)
 {
-    if (!fileName().isEmpty())
+    if (!fileName().isEmpty()) {
         remove();
+        QFile::remove(AutosaveJournal::journalFileName(fileName()));
+    }
     m_managedFile = filename;
     m_managedFileNameChanged = true;
 }
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "autosavejournal.h"
+#include "models/multitrackmodel.h"
+#include "mltcontroller.h"
+#include "projectsnapshot.h"
+#include "proxymanager.h"
+#include <QRunnable>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMap>
+#include <QPair>
+#include <QScopedPointer>
+#include <QDebug>
+
+// Take a full snapshot after this many journal records.
+static const int kMaxRecords = 100;
+
+class JournalTask : public QRunnable
+{
+public:
+    JournalTask(AutosaveJournal* journal, const QString& fileName, const QList<QPair<int, QByteArray> >& tracks)
+        : QRunnable()
+        , journal(journal)
+        , fileName(fileName)
+        , tracks(tracks)
+    {
+    }
+    void run()
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "failed to open the autosave journal" << file.fileName();
+            journal->setFailed();
+            return;
+        }
+        QDataStream out(&file);
+        for (int i = 0; i < tracks.count(); i++) {
+            QString xml = ProxyManager::originalXML(ProjectSnapshot::toXML(tracks.at(i).second));
+            if (xml.isEmpty()) {
+                journal->setFailed();
+                return;
+            }
+            out << qint32(tracks.at(i).first) << qCompress(xml.toUtf8());
+        }
+        if (out.status() != QDataStream::Ok || !file.flush()) {
+            qWarning() << "failed to write the autosave journal" << file.fileName();
+            journal->setFailed();
+        }
+    }
+private:
+    AutosaveJournal* journal;
+    QString fileName;
+    QList<QPair<int, QByteArray> > tracks;
+};
+
+AutosaveJournal::AutosaveJournal(MultitrackModel& model, QObject* parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_isFull(true)
+    , m_isChanged(false)
+    , m_count(0)
+    , m_isFailed(false)
+{
+    // One at a time keeps the records in order.
+    m_pool.setMaxThreadCount(1);
+    connect(&m_model, SIGNAL(modified()), SLOT(onModified()));
+    connect(&m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)),
+            SLOT(onDataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    connect(&m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), SLOT(onRowsChanged(QModelIndex)));
+    connect(&m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), SLOT(onRowsChanged(QModelIndex)));
+    connect(&m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), SLOT(onRowsChanged(QModelIndex)));
+    connect(&m_model, SIGNAL(modelReset()), SLOT(invalidate()));
+    connect(&m_model, SIGNAL(created()), SLOT(invalidate()));
+    connect(&m_model, SIGNAL(loaded()), SLOT(invalidate()));
+    connect(&m_model, SIGNAL(closed()), SLOT(invalidate()));
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    m_pool.waitForDone();
+}
+
+bool AutosaveJournal::canAppend(const QString& fileName) const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_isFull && !m_isFailed && m_count < kMaxRecords && fileName == m_fileName
+        && m_model.tractor() && QFile::exists(fileName);
+}
+
+bool AutosaveJournal::append(const QString& fileName)
+{
+    if (m_tracks.isEmpty())
+        return true;
+    QList<QPair<int, QByteArray> > tracks;
+    foreach (int trackIndex, m_tracks) {
+        if (trackIndex >= m_model.trackList().size())
+            return false;
+        int i = m_model.trackList().at(trackIndex).mlt_index;
+        QScopedPointer<Mlt::Producer> track(m_model.tractor()->track(i));
+        if (!track || !track->is_valid())
+            return false;
+        tracks << qMakePair(i, ProjectSnapshot::write(MLT.profile(), *track));
+    }
+    m_pool.start(new JournalTask(this, journalFileName(fileName), tracks));
+    m_count += tracks.count();
+    m_tracks.clear();
+    return true;
+}
+
+void AutosaveJournal::reset(const QString& fileName)
+{
+    waitForDone();
+    QFile::remove(journalFileName(fileName));
+    m_fileName = fileName;
+    m_tracks.clear();
+    m_isFull = false;
+    m_count = 0;
+    QMutexLocker locker(&m_mutex);
+    m_isFailed = false;
+}
+
+void AutosaveJournal::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+void AutosaveJournal::setFailed()
+{
+    QMutexLocker locker(&m_mutex);
+    m_isFailed = true;
+}
+
+QString AutosaveJournal::journalFileName(const QString& fileName)
+{
+    return fileName + ".journal";
+}
+
+bool AutosaveJournal::replay(const QString& fileName)
+{
+    QFile file(journalFileName(fileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return true;
+
+    // The last record of a track wins. A record cut short by a crash ends it.
+    QMap<int, QByteArray> tracks;
+    QDataStream in(&file);
+    while (!in.atEnd()) {
+        qint32 i;
+        QByteArray data;
+        in >> i >> data;
+        if (in.status() != QDataStream::Ok)
+            break;
+        tracks[i] = qUncompress(data);
+    }
+    file.close();
+    if (tracks.isEmpty())
+        return true;
+
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "xml", fileName.toUtf8().constData());
+    if (!producer.is_valid())
+        return false;
+    // See MultitrackModel::load().
+    producer.set("mlt_type", "mlt_producer");
+    producer.set("resource", "<tractor>");
+    Mlt::Tractor tractor(producer);
+    if (!tractor.is_valid())
+        return false;
+    foreach (int i, tracks.keys()) {
+        Mlt::Producer track(profile, "xml-string", tracks[i].constData());
+        if (track.is_valid() && i < tractor.count())
+            tractor.set_track(track, i);
+        else
+            qWarning() << "failed to replay the autosave journal for track" << i;
+    }
+    QString xml = Mlt::Controller::XML(profile, tractor, QFileInfo(fileName).absolutePath());
+    QSaveFile f(fileName);
+    if (xml.isEmpty() || !f.open(QIODevice::WriteOnly))
+        return false;
+    f.write(xml.toUtf8());
+    if (!f.commit())
+        return false;
+    qDebug() << "replayed" << tracks.count() << "tracks from the autosave journal";
+    file.remove();
+    return true;
+}
+
+void AutosaveJournal::invalidate()
+{
+    m_isFull = true;
+}
+
+void AutosaveJournal::onModified()
+{
+    // A change the model did not report for a particular track.
+    if (!m_isChanged)
+        m_isFull = true;
+    m_isChanged = false;
+}
+
+void AutosaveJournal::onDataChanged(const QModelIndex& topLeft, const QModelIndex&, const QVector<int>& roles)
+{
+    if (roles.size() == 1 && roles.first() == MultitrackModel::AudioLevelsRole)
+        return;
+    addTrack(topLeft.parent());
+}
+
+void AutosaveJournal::onRowsChanged(const QModelIndex& parent)
+{
+    addTrack(parent);
+}
+
+void AutosaveJournal::addTrack(const QModelIndex& parent)
+{
+    // Without a parent, tracks were added, removed, or changed their properties.
+    m_isChanged = true;
+    if (parent.isValid())
+        m_tracks << parent.row();
+    else
+        m_isFull = true;
+}
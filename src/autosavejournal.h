@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QObject>
+#include <QModelIndex>
+#include <QVector>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QMutex>
+
+class MultitrackModel;
+
+// Keeps the autosave of a timeline up to date without serializing the whole
+// project each time. The autosave file holds a full snapshot, and the journal
+// next to it gets a record with the XML of each track edited since. A binary
+// copy of each edited track is taken on the GUI thread so it is consistent
+// with the model, and its XML is made and written on another thread. Anything
+// that does not belong to a single track, a journal that has grown long, or
+// one that failed to be written makes the next autosave a full snapshot
+// again, which empties the journal.
+class AutosaveJournal : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutosaveJournal(MultitrackModel& model, QObject* parent = 0);
+    ~AutosaveJournal();
+    bool canAppend(const QString& fileName) const;
+    bool append(const QString& fileName);
+    void reset(const QString& fileName);
+    // Blocks until the records appended so far are written.
+    void waitForDone();
+    static QString journalFileName(const QString& fileName);
+    static bool replay(const QString& fileName);
+
+public slots:
+    void invalidate();
+
+private slots:
+    void onModified();
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onRowsChanged(const QModelIndex& parent);
+
+private:
+    friend class JournalTask;
+    void addTrack(const QModelIndex& parent);
+    void setFailed();
+
+    MultitrackModel& m_model;
+    QSet<int> m_tracks; // by index in the model
+    QString m_fileName;
+    bool m_isFull;
+    bool m_isChanged;
+    int m_count;
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    bool m_isFailed;
+};
+
+#endif // AUTOSAVEJOURNAL_H
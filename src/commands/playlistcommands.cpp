@@ -31,8 +31,22 @@ AppendCommand::AppendCommand(PlaylistModel& model, const QString& xml, QUndoComm
     setText(QObject::tr("Append playlist item %1").arg(m_model.rowCount() + 1));
 }
 
+AppendCommand::AppendCommand(PlaylistModel& model, Mlt::Producer* producer, const QString& xml, QUndoCommand *parent)
+    : QUndoCommand(parent)
+    , m_model(model)
+    , m_xml(xml)
+    , m_producer(producer)
+{
+    setText(QObject::tr("Append playlist item %1").arg(m_model.rowCount() + 1));
+}
+
 void AppendCommand::redo()
 {
+    if (m_producer) {
+        m_model.append(*m_producer);
+        m_producer.reset();
+        return;
+    }
     Mlt::Producer producer(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
     m_model.append(producer);
 }
@@ -69,7 +83,7 @@ UpdateCommand::UpdateCommand(PlaylistModel& model, const QString& xml, int row,
     , m_row(row)
 {
     setText(QObject::tr("Update playlist item %1").arg(row + 1));
-    m_oldXml = MLT.XML(m_model.playlist()->get_clip(m_row));
+    m_oldXml.set(MLT.XML(m_model.playlist()->get_clip(m_row)));
 }
 
 void UpdateCommand::redo()
@@ -89,7 +103,7 @@ RemoveCommand::RemoveCommand(PlaylistModel& model, int row, QUndoCommand *parent
     , m_model(model)
     , m_row(row)
 {
-    m_xml = MLT.XML(m_model.playlist()->get_clip(m_row));
+    m_xml.set(MLT.XML(m_model.playlist()->get_clip(m_row)));
     setText(QObject::tr("Remove playlist item %1").arg(row + 1));
 }
 
@@ -108,7 +122,7 @@ ClearCommand::ClearCommand(PlaylistModel& model, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_model(model)
 {
-    m_xml = MLT.XML(m_model.playlist());
+    m_xml.set(MLT.XML(m_model.playlist()));
     setText(QObject::tr("Clear playlist"));
 }
 
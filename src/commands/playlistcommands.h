@@ -20,8 +20,10 @@
 #define PLAYLISTCOMMANDS_H
 
 #include "models/playlistmodel.h"
+#include "undohistory.h"
 #include <QUndoCommand>
 #include <QString>
+#include <QScopedPointer>
 
 namespace Playlist
 {
@@ -30,11 +32,14 @@ class AppendCommand : public QUndoCommand
 {
 public:
     AppendCommand(PlaylistModel& model, const QString& xml, QUndoCommand * parent = 0);
+    // Takes the producer to append the first time instead of parsing the XML.
+    AppendCommand(PlaylistModel& model, Mlt::Producer* producer, const QString& xml, QUndoCommand * parent = 0);
     void redo();
     void undo();
 private:
     PlaylistModel& m_model;
-    QString m_xml;
+    UndoXml m_xml;
+    QScopedPointer<Mlt::Producer> m_producer;
 };
 
 class InsertCommand : public QUndoCommand
@@ -45,7 +50,7 @@ public:
     void undo();
 private:
     PlaylistModel& m_model;
-    QString m_xml;
+    UndoXml m_xml;
     int m_row;
 };
 
@@ -57,8 +62,8 @@ public:
     void undo();
 private:
     PlaylistModel& m_model;
-    QString m_newXml;
-    QString m_oldXml;
+    UndoXml m_newXml;
+    UndoXml m_oldXml;
     int m_row;
 };
 
@@ -70,7 +75,7 @@ public:
     void undo();
 private:
     PlaylistModel& m_model;
-    QString m_xml;
+    UndoXml m_xml;
     int m_row;
 };
 
@@ -94,7 +99,7 @@ public:
     void undo();
 private:
     PlaylistModel& m_model;
-    QString m_xml;
+    UndoXml m_xml;
 };
 
 }
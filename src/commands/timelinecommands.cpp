@@ -22,6 +22,67 @@
 
 namespace Timeline {
 
+ClipReference::ClipReference()
+    : m_in(-1)
+    , m_out(-1)
+{
+}
+
+void ClipReference::fromXml(const QString& xml)
+{
+    m_producer.reset(new Mlt::Producer(MLT.profile(), "xml-string", xml.toUtf8().constData()));
+    m_xml.set(QString());
+    if (m_producer->is_blank()) {
+        m_in = 0;
+        m_out = m_producer->get_int("blank_length") - 1;
+    } else {
+        m_in = m_producer->get_in();
+        m_out = m_producer->get_out();
+    }
+    setProducerCount(m_producer->is_blank()? 0 : 1);
+}
+
+void ClipReference::fromTrack(MultitrackModel& model, int trackIndex, int clipIndex)
+{
+    m_producer.reset();
+    m_xml.set(QString());
+    setProducerCount(0);
+    int i = model.trackList().at(trackIndex).mlt_index;
+    QScopedPointer<Mlt::Producer> track(model.tractor()->track(i));
+    if (track) {
+        Mlt::Playlist playlist(*track);
+        QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(clipIndex));
+        if (info) {
+            m_producer.reset(new Mlt::Producer(info->producer));
+            m_in = info->frame_in;
+            m_out = info->frame_out;
+            setProducerCount(m_producer->is_blank()? 0 : 1);
+        }
+    }
+}
+
+Mlt::Producer& ClipReference::producer()
+{
+    if (!m_producer) {
+        m_producer.reset(new Mlt::Producer(MLT.profile(), "xml-string", m_xml.toUtf8().constData()));
+        m_xml.set(QString());
+        setProducerCount(1);
+    }
+    if (m_producer->is_blank())
+        m_producer->set("blank_length", m_out - m_in + 1);
+    else
+        m_producer->set_in_and_out(m_in, m_out);
+    return *m_producer;
+}
+
+// Blanks are not counted, so this is only for media.
+void ClipReference::release()
+{
+    m_xml.set(MLT.XML(m_producer.data()));
+    m_producer.reset();
+    setProducerCount(0);
+}
+
 AppendCommand::AppendCommand(MultitrackModel &model, int trackIndex, const QString &xml, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_model(model)
@@ -33,8 +94,11 @@ AppendCommand::AppendCommand(MultitrackModel &model, int trackIndex, const QStri
 
 void AppendCommand::redo()
 {
-    Mlt::Producer producer(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
-    m_clipIndex = m_model.appendClip(m_trackIndex, producer);
+    if (!m_clip.isValid()) {
+        m_clip.fromXml(m_xml);
+        m_xml.clear();
+    }
+    m_clipIndex = m_model.appendClip(m_trackIndex, m_clip.producer());
 }
 
 void AppendCommand::undo()
@@ -56,8 +120,11 @@ InsertCommand::InsertCommand(MultitrackModel &model, int trackIndex,
 
 void InsertCommand::redo()
 {
-    Mlt::Producer clip(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
-    m_clipIndex = m_model.insertClip(m_trackIndex, clip, m_position);
+    if (!m_clip.isValid()) {
+        m_clip.fromXml(m_xml);
+        m_xml.clear();
+    }
+    m_clipIndex = m_model.insertClip(m_trackIndex, m_clip.producer(), m_position);
 }
 
 void InsertCommand::undo()
@@ -79,61 +146,79 @@ OverwriteCommand::OverwriteCommand(MultitrackModel &model, int trackIndex,
 
 void OverwriteCommand::redo()
 {
-    Mlt::Producer clip(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
-    m_playlistXml = m_model.overwrite(m_trackIndex, clip, m_position);
+    if (!m_clip.isValid()) {
+        m_clip.fromXml(m_xml);
+        m_xml.clear();
+    }
+    m_replaced.reset(new Mlt::Playlist);
+    m_replacedXml.set(QString());
+    m_model.overwrite(m_trackIndex, m_clip.producer(), m_position, *m_replaced);
+    setProducerCount(m_replaced->count());
 }
 
 void OverwriteCommand::undo()
 {
-    Mlt::Producer producer(MLT.profile(), "xml-string", m_playlistXml.toUtf8().constData());
-    Mlt::Playlist playlist(producer);
-    m_model.overwriteFromPlaylist(playlist, m_trackIndex, m_position);
+    if (!m_replaced) {
+        Mlt::Producer producer(MLT.profile(), "xml-string", m_replacedXml.toUtf8().constData());
+        m_replaced.reset(new Mlt::Playlist(producer));
+    }
+    m_model.overwriteFromPlaylist(*m_replaced, m_trackIndex, m_position);
+    m_replaced.reset();
+    m_replacedXml.set(QString());
+    setProducerCount(0);
+}
+
+void OverwriteCommand::release()
+{
+    m_replacedXml.set(MLT.XML(m_replaced.data()));
+    m_replaced.reset();
+    setProducerCount(0);
 }
 
 LiftCommand::LiftCommand(MultitrackModel &model, int trackIndex,
-    int clipIndex, int position, const QString &xml, QUndoCommand *parent)
+    int clipIndex, int position, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_model(model)
     , m_trackIndex(trackIndex)
     , m_clipIndex(clipIndex)
     , m_position(position)
-    , m_xml(xml)
 {
     setText(QObject::tr("Lift from track"));
 }
 
 void LiftCommand::redo()
 {
+    m_clip.fromTrack(m_model, m_trackIndex, m_clipIndex);
     m_model.liftClip(m_trackIndex, m_clipIndex);
 }
 
 void LiftCommand::undo()
 {
-    Mlt::Producer clip(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
-    m_model.overwriteClip(m_trackIndex, clip, m_position);
+    if (m_clip.isValid())
+        m_model.overwriteClip(m_trackIndex, m_clip.producer(), m_position);
 }
 
 RemoveCommand::RemoveCommand(MultitrackModel &model, int trackIndex,
-    int clipIndex, int position, const QString &xml, QUndoCommand *parent)
+    int clipIndex, int position, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_model(model)
     , m_trackIndex(trackIndex)
     , m_clipIndex(clipIndex)
     , m_position(position)
-    , m_xml(xml)
 {
     setText(QObject::tr("Remove from track"));
 }
 
 void RemoveCommand::redo()
 {
+    m_clip.fromTrack(m_model, m_trackIndex, m_clipIndex);
     m_model.removeClip(m_trackIndex, m_clipIndex);
 }
 
 void RemoveCommand::undo()
 {
-    Mlt::Producer clip(MLT.profile(), "xml-string", m_xml.toUtf8().constData());
-    m_model.insertClip(m_trackIndex, clip, m_position);
+    if (m_clip.isValid())
+        m_model.insertClip(m_trackIndex, m_clip.producer(), m_position);
 }
 
 
@@ -246,6 +331,19 @@ void MoveClipCommand::undo()
         qWarning() << "Failed to undo the clip movement!";
 }
 
+bool MoveClipCommand::mergeWith(const QUndoCommand *other)
+{
+    // Moving the same clip again undoes to where it started.
+    const MoveClipCommand* that = static_cast<const MoveClipCommand*>(other);
+    if (that->id() != id() || that->m_fromTrackIndex != m_toTrackIndex
+            || that->m_fromClipIndex != m_toClipIndex || that->m_toClipIndex < 0)
+        return false;
+    m_toTrackIndex = that->m_toTrackIndex;
+    m_toClipIndex = that->m_toClipIndex;
+    m_toStart = that->m_toStart;
+    return true;
+}
+
 TrimClipInCommand::TrimClipInCommand(MultitrackModel &model, int trackIndex, int clipIndex, int delta, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_model(model)
@@ -581,4 +679,53 @@ bool AddTransitionByTrimOutCommand::mergeWith(const QUndoCommand *other)
     return true;
 }
 
+EditGraphCommand::EditGraphCommand(MultitrackModel &model, TimelineGraph::Edit edit, int trackIndex, int clipIndex,
+                                   const TimelineGraph &before, const TimelineGraph &after, QUndoCommand *parent)
+    : QUndoCommand(parent)
+    , m_model(model)
+    , m_edit(edit)
+    , m_trackIndex(trackIndex)
+    , m_clipIndex(clipIndex)
+    , m_before(before)
+    , m_after(after)
+{
+    switch (edit) {
+    case TimelineGraph::RippleTrimIn:
+        setText(QObject::tr("Ripple trim clip in point"));
+        break;
+    case TimelineGraph::RippleTrimOut:
+        setText(QObject::tr("Ripple trim clip out point"));
+        break;
+    case TimelineGraph::Roll:
+        setText(QObject::tr("Roll edit"));
+        break;
+    case TimelineGraph::Slip:
+        setText(QObject::tr("Slip clip"));
+        break;
+    case TimelineGraph::Slide:
+        setText(QObject::tr("Slide clip"));
+        break;
+    }
+}
+
+void EditGraphCommand::redo()
+{
+    m_model.applyGraph(m_after, m_before);
+}
+
+void EditGraphCommand::undo()
+{
+    m_model.applyGraph(m_before, m_after);
+}
+
+bool EditGraphCommand::mergeWith(const QUndoCommand *other)
+{
+    const EditGraphCommand* that = static_cast<const EditGraphCommand*>(other);
+    if (that->id() != id() || that->m_edit != m_edit || that->m_trackIndex != m_trackIndex
+            || that->m_clipIndex != m_clipIndex)
+        return false;
+    m_after = that->m_after;
+    return true;
+}
+
 } // namespace
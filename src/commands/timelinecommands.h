@@ -20,8 +20,10 @@
 #define COMMANDS_H
 
 #include "models/multitrackmodel.h"
+#include "undohistory.h"
 #include <QUndoCommand>
 #include <QString>
+#include <QScopedPointer>
 
 namespace Timeline
 {
@@ -34,7 +36,30 @@ enum {
     UndoIdTrimTransitionIn,
     UndoIdTrimTransitionOut,
     UndoIdAddTransitionByTrimIn,
-    UndoIdAddTransitionByTrimOut
+    UndoIdAddTransitionByTrimOut,
+    UndoIdMoveClip,
+    UndoIdEditGraph
+};
+
+// A clip to put on a track, kept as a reference to its producer with its in
+// and out points so that redo and undo do not parse XML and open the media
+// again, unless the undo history released it to XML.
+class ClipReference : private UndoResource
+{
+public:
+    ClipReference();
+    bool isValid() const { return !m_producer.isNull() || m_xml.size() > 0; }
+    void fromXml(const QString& xml);
+    void fromTrack(MultitrackModel& model, int trackIndex, int clipIndex);
+    // The model changes the in and out points of a clip it adds, so they
+    // are restored each time.
+    Mlt::Producer& producer();
+private:
+    void release();
+    QScopedPointer<Mlt::Producer> m_producer;
+    UndoXml m_xml;
+    int m_in;
+    int m_out;
 };
 
 class AppendCommand : public QUndoCommand
@@ -48,6 +73,7 @@ private:
     int m_trackIndex;
     int m_clipIndex;
     QString m_xml;
+    ClipReference m_clip;
 };
 
 class InsertCommand : public QUndoCommand
@@ -62,26 +88,30 @@ private:
     int m_clipIndex;
     int m_position;
     QString m_xml;
+    ClipReference m_clip;
 };
 
-class OverwriteCommand : public QUndoCommand
+class OverwriteCommand : public QUndoCommand, private UndoResource
 {
 public:
     OverwriteCommand(MultitrackModel& model, int trackIndex, int position, const QString &xml, QUndoCommand * parent = 0);
     void redo();
     void undo();
 private:
+    void release();
     MultitrackModel& m_model;
     int m_trackIndex;
-    QString m_playlistXml;
+    QScopedPointer<Mlt::Playlist> m_replaced;
+    UndoXml m_replacedXml;
     int m_position;
     QString m_xml;
+    ClipReference m_clip;
 };
 
 class LiftCommand : public QUndoCommand
 {
 public:
-    LiftCommand(MultitrackModel& model, int trackIndex, int clipIndex, int position, const QString &xml, QUndoCommand * parent = 0);
+    LiftCommand(MultitrackModel& model, int trackIndex, int clipIndex, int position, QUndoCommand * parent = 0);
     void redo();
     void undo();
 private:
@@ -89,13 +119,13 @@ private:
     int m_trackIndex;
     int m_clipIndex;
     int m_position;
-    QString m_xml;
+    ClipReference m_clip;
 };
 
 class RemoveCommand : public QUndoCommand
 {
 public:
-    RemoveCommand(MultitrackModel& model, int trackIndex, int clipIndex, int position, const QString &xml, QUndoCommand * parent = 0);
+    RemoveCommand(MultitrackModel& model, int trackIndex, int clipIndex, int position, QUndoCommand * parent = 0);
     void redo();
     void undo();
 private:
@@ -103,7 +133,7 @@ private:
     int m_trackIndex;
     int m_clipIndex;
     int m_position;
-    QString m_xml;
+    ClipReference m_clip;
 };
 
 class NameTrackCommand : public QUndoCommand
@@ -162,6 +192,9 @@ public:
     MoveClipCommand(MultitrackModel& model, int fromTrackIndex, int toTrackIndex, int clipIndex, int position, QUndoCommand * parent = 0);
     void redo();
     void undo();
+protected:
+    int id() const { return UndoIdMoveClip; }
+    bool mergeWith(const QUndoCommand *other);
 private:
     MultitrackModel& m_model;
     int m_fromTrackIndex;
@@ -335,6 +368,27 @@ private:
     bool m_notify;
 };
 
+// Applies an edit worked out on a TimelineGraph. Both graphs are kept so that
+// redo and undo only touch what the edit changed.
+class EditGraphCommand : public QUndoCommand
+{
+public:
+    EditGraphCommand(MultitrackModel& model, TimelineGraph::Edit edit, int trackIndex, int clipIndex,
+                     const TimelineGraph& before, const TimelineGraph& after, QUndoCommand * parent = 0);
+    void redo();
+    void undo();
+protected:
+    int id() const { return UndoIdEditGraph; }
+    bool mergeWith(const QUndoCommand *other);
+private:
+    MultitrackModel& m_model;
+    TimelineGraph::Edit m_edit;
+    int m_trackIndex;
+    int m_clipIndex;
+    TimelineGraph m_before;
+    TimelineGraph m_after;
+};
+
 } // namespace
 
 #endif
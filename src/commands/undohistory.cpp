@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "undohistory.h"
+#include "settings.h"
+#include <QCoreApplication>
+#include <QTemporaryFile>
+#include <QDir>
+#include <QDebug>
+
+UndoXml::UndoXml()
+    : m_isCompressed(false)
+    , m_offset(-1)
+    , m_length(0)
+{
+    UNDOHISTORY.add(this);
+}
+
+UndoXml::UndoXml(const QString& xml)
+    : m_data(xml.toUtf8())
+    , m_isCompressed(false)
+    , m_offset(-1)
+    , m_length(0)
+{
+    UNDOHISTORY.add(this);
+}
+
+UndoXml::~UndoXml()
+{
+    UNDOHISTORY.remove(this);
+}
+
+void UndoXml::set(const QString& xml)
+{
+    UNDOHISTORY.remove(this);
+    m_data = xml.toUtf8();
+    m_isCompressed = false;
+    m_offset = -1;
+    m_length = 0;
+    UNDOHISTORY.add(this);
+}
+
+QByteArray UndoXml::toUtf8() const
+{
+    if (m_offset >= 0)
+        return qUncompress(UNDOHISTORY.read(this));
+    else if (m_isCompressed)
+        return qUncompress(m_data);
+    else
+        return m_data;
+}
+
+qint64 UndoXml::size() const
+{
+    return m_data.size();
+}
+
+// There is no asking a producer how much memory it uses, so this is a guess
+// for a decoder with its buffers.
+static const qint64 kProducerSize = 1024 * 1024;
+
+UndoResource::UndoResource()
+    : m_producerCount(0)
+{
+    UNDOHISTORY.add(this);
+}
+
+UndoResource::~UndoResource()
+{
+    UNDOHISTORY.remove(this);
+}
+
+void UndoResource::setProducerCount(int count)
+{
+    UNDOHISTORY.setProducerCount(this, count);
+}
+
+UndoHistory::UndoHistory(QObject *parent)
+    : QObject(parent)
+    , m_memory(0)
+    , m_disk(0)
+    , m_file(0)
+    , m_isOverBudget(false)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(compact()));
+}
+
+UndoHistory::~UndoHistory()
+{
+    delete m_file;
+}
+
+UndoHistory& UndoHistory::singleton()
+{
+    static UndoHistory* instance = 0;
+    if (!instance)
+        instance = new UndoHistory(QCoreApplication::instance());
+    return *instance;
+}
+
+void UndoHistory::add(UndoXml* xml)
+{
+    m_items.append(xml);
+    m_memory += xml->size();
+    changed();
+}
+
+void UndoHistory::remove(UndoXml* xml)
+{
+    if (!m_items.removeOne(xml))
+        return;
+    m_memory -= xml->size();
+    if (xml->m_offset >= 0)
+        m_disk -= xml->m_length;
+    if (m_items.isEmpty() && m_file) {
+        // Nothing refers to the spill file anymore.
+        m_file->resize(0);
+        m_disk = 0;
+    }
+    changed();
+}
+
+void UndoHistory::add(UndoResource* resource)
+{
+    m_resources.append(resource);
+}
+
+void UndoHistory::remove(UndoResource* resource)
+{
+    if (m_resources.removeOne(resource))
+        setProducerCount(resource, 0);
+}
+
+void UndoHistory::setProducerCount(UndoResource* resource, int count)
+{
+    if (count == resource->m_producerCount)
+        return;
+    m_memory += (count - resource->m_producerCount) * kProducerSize;
+    resource->m_producerCount = count;
+    changed();
+}
+
+void UndoHistory::changed()
+{
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+void UndoHistory::compact()
+{
+    qint64 budget = qint64(Settings.undoBudget()) * 1024 * 1024;
+
+    // Open producers cost the most, so the oldest give way to XML first.
+    for (int i = 0; i < m_resources.size() - 1 && m_memory > budget; i++) {
+        UndoResource* resource = m_resources.at(i);
+        if (resource->m_producerCount > 0)
+            resource->release();
+    }
+
+    // Compress the oldest entries first but leave the newest as it is since
+    // it is the most likely to be undone.
+    for (int i = 0; i < m_items.size() - 1 && m_memory > budget; i++) {
+        UndoXml* xml = m_items.at(i);
+        if (xml->m_isCompressed || xml->m_data.isEmpty())
+            continue;
+        QByteArray compressed = qCompress(xml->m_data);
+        m_memory += compressed.size() - xml->m_data.size();
+        xml->m_data = compressed;
+        xml->m_isCompressed = true;
+    }
+    if (Settings.undoSpill()) {
+        for (int i = 0; i < m_items.size() - 1 && m_memory > budget; i++) {
+            UndoXml* xml = m_items.at(i);
+            if (xml->m_isCompressed && xml->m_offset < 0 && !spill(xml))
+                break;
+        }
+    }
+    // Only say so when it goes over, as this runs after every edit.
+    if (m_memory > budget && !m_isOverBudget)
+        qDebug() << "undo history is over budget" << m_memory << budget;
+    m_isOverBudget = m_memory > budget;
+    emit usageChanged(m_memory, m_disk);
+}
+
+bool UndoHistory::spill(UndoXml* xml)
+{
+    if (!m_file) {
+        m_file = new QTemporaryFile(QDir::tempPath().append("/shotcut-undo-XXXXXX"));
+        if (!m_file->open()) {
+            qWarning() << "failed to open the undo spill file";
+            delete m_file;
+            m_file = 0;
+            return false;
+        }
+    }
+    qint64 offset = m_file->size();
+    if (!m_file->seek(offset) || m_file->write(xml->m_data) != xml->m_data.size()) {
+        qWarning() << "failed to write the undo spill file" << m_file->fileName();
+        return false;
+    }
+    xml->m_offset = offset;
+    xml->m_length = xml->m_data.size();
+    m_memory -= xml->m_length;
+    m_disk += xml->m_length;
+    xml->m_data = QByteArray();
+    return true;
+}
+
+QByteArray UndoHistory::read(const UndoXml* xml)
+{
+    QByteArray result;
+    if (m_file && m_file->seek(xml->m_offset))
+        result = m_file->read(xml->m_length);
+    if (result.size() != xml->m_length)
+        qWarning() << "failed to read the undo spill file";
+    return result;
+}
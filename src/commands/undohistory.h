@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QTimer>
+
+class QTemporaryFile;
+
+// XML kept by an undo command to restore something later. It is held as
+// UTF-8 while it is recent and handed to UndoHistory, which compresses or
+// moves it to disk when the history grows past its budget.
+class UndoXml
+{
+public:
+    UndoXml();
+    explicit UndoXml(const QString& xml);
+    ~UndoXml();
+    void set(const QString& xml);
+    QByteArray toUtf8() const;
+    qint64 size() const;
+
+private:
+    friend class UndoHistory;
+    QByteArray m_data;
+    bool m_isCompressed;
+    qint64 m_offset; // in the spill file, or -1
+    int m_length;
+    Q_DISABLE_COPY(UndoXml)
+};
+
+// Something an undo command keeps open instead of as XML, such as producers,
+// so that redo and undo are fast. Open producers count against the budget
+// too, and the oldest are released to XML when the history is over it.
+class UndoResource
+{
+public:
+    UndoResource();
+    virtual ~UndoResource();
+
+protected:
+    void setProducerCount(int count);
+
+private:
+    friend class UndoHistory;
+    virtual void release() = 0;
+    int m_producerCount;
+    Q_DISABLE_COPY(UndoResource)
+};
+
+// Accounts for the memory used by the undo history and keeps it within the
+// budget in the settings by compacting the oldest entries first.
+class UndoHistory : public QObject
+{
+    Q_OBJECT
+public:
+    static UndoHistory& singleton();
+    qint64 memoryUsed() const { return m_memory; }
+    qint64 diskUsed() const { return m_disk; }
+
+signals:
+    void usageChanged(qint64 memory, qint64 disk);
+
+private slots:
+    void compact();
+
+private:
+    explicit UndoHistory(QObject* parent = 0);
+    ~UndoHistory();
+    void add(UndoXml* xml);
+    void remove(UndoXml* xml);
+    void add(UndoResource* resource);
+    void remove(UndoResource* resource);
+    void setProducerCount(UndoResource* resource, int count);
+    void changed();
+    bool spill(UndoXml* xml);
+    QByteArray read(const UndoXml* xml);
+
+    QList<UndoXml*> m_items; // oldest first
+    QList<UndoResource*> m_resources; // oldest first
+    qint64 m_memory;
+    qint64 m_disk;
+    QTemporaryFile* m_file;
+    QTimer m_timer;
+    bool m_isOverBudget;
+
+    friend class UndoXml;
+    friend class UndoResource;
+};
+
+#define UNDOHISTORY UndoHistory::singleton()
+
+#endif // UNDOHISTORY_H
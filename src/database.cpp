@@ -21,6 +21,9 @@
 #include <QtSql>
 #include <QStandardPaths>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
 #include <QtDebug>
 
 static Database* instance = 0;
@@ -50,6 +53,10 @@ Database::Database(QObject *parent) :
     }
     if (version < 1 && upgradeVersion1())
         version = 1;
+    if (version < 2 && upgradeVersion2())
+        version = 2;
+    if (version < 3 && upgradeVersion3())
+        version = 3;
     qDebug() << "Database version is" << version;
 }
 
@@ -82,6 +89,48 @@ bool Database::upgradeVersion1()
     return success;
 }
 
+bool Database::upgradeVersion2()
+{
+    bool success = false;
+    QSqlQuery query;
+    if (query.exec("CREATE TABLE keyframes (hash TEXT PRIMARY KEY NOT NULL, accessed DATETIME NOT NULL, times BLOB);")) {
+        success = query.exec("UPDATE version SET version = 2;");
+        if (!success)
+            qCritical() << __FUNCTION__ << query.lastError();
+    } else {
+        qCritical() << __PRETTY_FUNCTION__ << "Failed to create keyframes table.";
+    }
+    return success;
+}
+
+bool Database::upgradeVersion3()
+{
+    bool success = false;
+    QSqlQuery query;
+    if (query.exec("CREATE TABLE mediainfo (hash TEXT PRIMARY KEY NOT NULL, accessed DATETIME NOT NULL, info BLOB);")) {
+        success = query.exec("UPDATE version SET version = 3;");
+        if (!success)
+            qCritical() << __FUNCTION__ << query.lastError();
+    } else {
+        qCritical() << __PRETTY_FUNCTION__ << "Failed to create mediainfo table.";
+    }
+    return success;
+}
+
+// Identifies a file by its path, size, and modification time, so that
+// anything cached about it is not used after it changes.
+QString Database::fingerprint(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    if (!info.isFile())
+        return QString();
+    QString key = QString("%1 %2 %3").arg(info.absoluteFilePath())
+            .arg(info.size()).arg(info.lastModified().toTime_t());
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(key.toUtf8());
+    return hash.result().toHex();
+}
+
 bool Database::putThumbnail(const QString& hash, const QImage& image)
 {
     QByteArray ba;
@@ -130,3 +179,98 @@ void Database::deleteOldThumbnails()
         qCritical() << __FUNCTION__ << query.lastError();
 }
 
+bool Database::putKeyframes(const QString& hash, const QVector<double>& times)
+{
+    QByteArray ba;
+    QDataStream stream(&ba, QIODevice::WriteOnly);
+    stream << times;
+
+    QSqlQuery query;
+    query.prepare("DELETE FROM keyframes WHERE hash = :hash;");
+    query.bindValue(":hash", hash);
+    query.exec();
+    query.prepare("INSERT INTO keyframes VALUES (:hash, datetime('now'), :times);");
+    query.bindValue(":hash", hash);
+    query.bindValue(":times", ba);
+    bool result = query.exec();
+    if (!result)
+        qCritical() << __FUNCTION__ << query.lastError();
+    deleteOldKeyframes();
+    return result;
+}
+
+bool Database::getKeyframes(const QString& hash, QVector<double>& times)
+{
+    bool result = false;
+    QSqlQuery query;
+    query.prepare("SELECT times FROM keyframes WHERE hash = :hash;");
+    query.bindValue(":hash", hash);
+    if (query.exec() && query.first()) {
+        QByteArray ba = query.value(0).toByteArray();
+        QDataStream stream(&ba, QIODevice::ReadOnly);
+        stream >> times;
+        result = stream.status() == QDataStream::Ok;
+        QSqlQuery update;
+        update.prepare("UPDATE keyframes SET accessed = datetime('now') WHERE hash = :hash ;");
+        update.bindValue(":hash", hash);
+        if (!update.exec())
+            qCritical() << __FUNCTION__ << update.lastError();
+    }
+    return result;
+}
+
+void Database::deleteOldKeyframes()
+{
+    QSqlQuery query;
+    // OFFSET is the number of sources to keep.
+    if (!query.exec("DELETE FROM keyframes WHERE hash IN (SELECT hash FROM keyframes ORDER BY accessed DESC LIMIT -1 OFFSET 1000);"))
+        qCritical() << __FUNCTION__ << query.lastError();
+}
+
+bool Database::putMediaInfo(const QString& hash, const QMap<QString, QString>& info)
+{
+    QByteArray ba;
+    QDataStream stream(&ba, QIODevice::WriteOnly);
+    stream << info;
+
+    QSqlQuery query;
+    query.prepare("DELETE FROM mediainfo WHERE hash = :hash;");
+    query.bindValue(":hash", hash);
+    query.exec();
+    query.prepare("INSERT INTO mediainfo VALUES (:hash, datetime('now'), :info);");
+    query.bindValue(":hash", hash);
+    query.bindValue(":info", ba);
+    bool result = query.exec();
+    if (!result)
+        qCritical() << __FUNCTION__ << query.lastError();
+    deleteOldMediaInfo();
+    return result;
+}
+
+bool Database::getMediaInfo(const QString& hash, QMap<QString, QString>& info)
+{
+    bool result = false;
+    QSqlQuery query;
+    query.prepare("SELECT info FROM mediainfo WHERE hash = :hash;");
+    query.bindValue(":hash", hash);
+    if (query.exec() && query.first()) {
+        QByteArray ba = query.value(0).toByteArray();
+        QDataStream stream(&ba, QIODevice::ReadOnly);
+        stream >> info;
+        result = stream.status() == QDataStream::Ok;
+        QSqlQuery update;
+        update.prepare("UPDATE mediainfo SET accessed = datetime('now') WHERE hash = :hash ;");
+        update.bindValue(":hash", hash);
+        if (!update.exec())
+            qCritical() << __FUNCTION__ << update.lastError();
+    }
+    return result;
+}
+
+void Database::deleteOldMediaInfo()
+{
+    QSqlQuery query;
+    // OFFSET is the number of files to keep.
+    if (!query.exec("DELETE FROM mediainfo WHERE hash IN (SELECT hash FROM mediainfo ORDER BY accessed DESC LIMIT -1 OFFSET 10000);"))
+        qCritical() << __FUNCTION__ << query.lastError();
+}
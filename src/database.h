@@ -21,6 +21,8 @@
 
 #include <QObject>
 #include <QImage>
+#include <QVector>
+#include <QMap>
 
 class Database : public QObject
 {
@@ -32,11 +34,20 @@ public:
     ~Database();
 
     bool upgradeVersion1();
+    bool upgradeVersion2();
+    bool upgradeVersion3();
+    static QString fingerprint(const QString& fileName);
     bool putThumbnail(const QString& hash, const QImage& image);
     QImage getThumbnail(const QString& hash);
+    bool putKeyframes(const QString& hash, const QVector<double>& times);
+    bool getKeyframes(const QString& hash, QVector<double>& times);
+    bool putMediaInfo(const QString& hash, const QMap<QString, QString>& info);
+    bool getMediaInfo(const QString& hash, QMap<QString, QString>& info);
 
 private:
     void deleteOldThumbnails();
+    void deleteOldKeyframes();
+    void deleteOldMediaInfo();
 };
 
 #define DB Database::singleton()
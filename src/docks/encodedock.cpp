@@ -25,10 +25,11 @@
 #include "settings.h"
 #include "qmltypes/qmlapplication.h"
 #include "jobs/encodejob.h"
+#include "jobs/meltjob.h"
+#include "proxymanager.h"
 
 #include <QtDebug>
 #include <QtWidgets>
-#include <QtXml>
 
 // formulas to map absolute value ranges to percentages as int
 #define TO_ABSOLUTE(min, max, rel) qRound(float(min) + float((max) - (min) + 1) * float(rel) / 100.0f)
@@ -303,18 +304,101 @@ Mlt::Properties* EncodeDock::collectProperties(int realtime)
     return p;
 }
 
-void EncodeDock::collectProperties(QDomElement& node, int realtime)
+static QString intermediateName(const QString& target)
 {
-    Mlt::Properties* p = collectProperties(realtime);
-    if (p && p->is_valid()) {
-        for (int i = 0; i < p->count(); i++)
-            if (p->get_name(i) && strcmp(p->get_name(i), ""))
-                node.setAttribute(p->get_name(i), p->get(i));
+    return target + "_2pass.mkv";
+}
+
+static QString tempXmlName()
+{
+    QTemporaryFile tmp(QDir::tempPath().append("/shotcut-XXXXXX"));
+    tmp.open();
+    QString tmpName = tmp.fileName();
+    tmp.close();
+    tmpName.append(".mlt");
+    return tmpName;
+}
+
+static Mlt::Properties* teeToIntermediate(Mlt::Properties* encoder, const QString& intermediate)
+{
+    // Move the encoder to output 0 of a multi consumer and cache the rendered
+    // frames losslessly on output 1 so the second pass need not render them.
+    // What controls the consumer itself stays on the multi consumer.
+    static const QStringList consumerNames = QStringList() << "real_time" << "terminate_on_pause"
+        << "in" << "out" << "prefill" << "buffer" << "mlt_profile";
+    Mlt::Properties* consumer = new Mlt::Properties;
+    consumer->set("mlt_service", "multi");
+    for (int i = 0; i < encoder->count(); i++) {
+        QString name = QString::fromUtf8(encoder->get_name(i));
+        if (name.isEmpty() || !encoder->get(i))
+            continue;
+        if (consumerNames.contains(name))
+            consumer->set(encoder->get_name(i), encoder->get(i));
+        else if (name == "mlt_service")
+            consumer->set("0", encoder->get(i));
+        else
+            consumer->set(QString("0.%1").arg(name).toUtf8().constData(), encoder->get(i));
     }
-    delete p;
+    consumer->set("1", "avformat");
+    consumer->set("1.target", intermediate.toUtf8().constData());
+    consumer->set("1.f", "matroska");
+    consumer->set("1.vcodec", "ffv1");
+    consumer->set("1.acodec", "pcm_s16le");
+    consumer->set("1.threads", QThread::idealThreadCount());
+    const char* copied[] = {"width", "height", "aspect", "progressive", "top_field_first",
+        "r", "frame_rate_num", "frame_rate_den", "ar", "channels", "pix_fmt", 0};
+    for (int i = 0; copied[i]; i++) {
+        if (encoder->get(copied[i]))
+            consumer->set(QString("1.%1").arg(copied[i]).toLatin1().constData(), encoder->get(copied[i]));
+    }
+    delete encoder;
+    return consumer;
+}
+
+static QString intermediateXml(const QString& intermediate)
+{
+    // A document that plays the cached first pass instead of the timeline.
+    QString xml;
+    QXmlStreamWriter writer(&xml);
+    Mlt::Profile& profile = MLT.profile();
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeStartElement("mlt");
+    writer.writeAttribute("LC_NUMERIC", "C");
+    writer.writeStartElement("profile");
+    writer.writeAttribute("width", QString::number(profile.width()));
+    writer.writeAttribute("height", QString::number(profile.height()));
+    writer.writeAttribute("progressive", QString::number(profile.progressive()));
+    writer.writeAttribute("sample_aspect_num", QString::number(profile.sample_aspect_num()));
+    writer.writeAttribute("sample_aspect_den", QString::number(profile.sample_aspect_den()));
+    writer.writeAttribute("display_aspect_num", QString::number(profile.display_aspect_num()));
+    writer.writeAttribute("display_aspect_den", QString::number(profile.display_aspect_den()));
+    writer.writeAttribute("frame_rate_num", QString::number(profile.frame_rate_num()));
+    writer.writeAttribute("frame_rate_den", QString::number(profile.frame_rate_den()));
+    writer.writeAttribute("colorspace", QString::number(profile.colorspace()));
+    writer.writeEndElement();
+    writer.writeStartElement("producer");
+    writer.writeAttribute("id", "intermediate");
+    writer.writeStartElement("property");
+    writer.writeAttribute("name", "resource");
+    writer.writeCharacters(intermediate);
+    writer.writeEndElement();
+    writer.writeStartElement("property");
+    writer.writeAttribute("name", "mlt_service");
+    writer.writeCharacters("avformat-novalidate");
+    writer.writeEndElement();
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    return xml;
+}
+
+bool EncodeDock::isCachingFirstPass() const
+{
+    return ui->dualPassCheckbox->isEnabled() && ui->dualPassCheckbox->isChecked()
+        && ui->cachePassCheckbox->isChecked();
 }
 
-MeltJob* EncodeDock::createMeltJob(const QString& target, int realtime, int pass)
+Mlt::Properties* EncodeDock::createConsumer(const QString& target, int realtime, int pass)
 {
     // if image sequence, change filename to include number
     QString mytarget = target;
@@ -327,67 +411,240 @@ MeltJob* EncodeDock::createMeltJob(const QString& target, int realtime, int pass
         }
     }
 
-    // get temp filename
-    QTemporaryFile tmp(QDir::tempPath().append("/shotcut-XXXXXX"));
-    tmp.open();
-    QString tmpName = tmp.fileName();
-    tmp.close();
-    tmpName.append(".mlt");
-    MAIN.saveXML(tmpName);
-
-    // parse xml
-    QFile f1(tmpName);
-    f1.open(QIODevice::ReadOnly);
-    QDomDocument dom(tmpName);
-    dom.setContent(&f1);
-    f1.close();
-
-    // add consumer element
-    QDomElement consumerNode = dom.createElement("consumer");
-    QDomNodeList profiles = dom.elementsByTagName("profile");
-    if (profiles.isEmpty())
-        dom.documentElement().insertAfter(consumerNode, dom.documentElement());
-    else
-        dom.documentElement().insertAfter(consumerNode, profiles.at(profiles.length() - 1));
-    consumerNode.setAttribute("mlt_service", "avformat");
-    consumerNode.setAttribute("target", mytarget);
-    collectProperties(consumerNode, realtime);
-    if ("libx265" == ui->videoCodecCombo->currentText()) {
+    Mlt::Properties* p = collectProperties(realtime);
+    p->set("mlt_service", "avformat");
+    p->set("target", mytarget.toUtf8().constData());
+    setPassProperties(*p, mytarget, pass);
+    if (ui->formatCombo->currentIndex() == 0 &&
+            ui->audioCodecCombo->currentIndex() == 0 &&
+            (mytarget.endsWith(".mp4") || mytarget.endsWith(".mov")))
+        p->set("strict", "experimental");
+    if (pass == 1 && isCachingFirstPass())
+        p = teeToIntermediate(p, intermediateName(target));
+    return p;
+}
+
+void EncodeDock::setPassProperties(Mlt::Properties& p, const QString& target, int pass)
+{
+    if (!qstrcmp(p.get("vcodec"), "libx265")) {
         if (pass == 1 || pass == 2) {
-            QString x265params = consumerNode.attribute("x265-params");
+            QString x265params = QString::fromUtf8(p.get("x265-params"));
             x265params = QString("pass=%1:stats=%2:%3")
-                .arg(pass).arg(mytarget + "_2pass.log").arg(x265params);
-            consumerNode.setAttribute("x265-params", x265params);
+                .arg(pass).arg(target + "_2pass.log").arg(x265params);
+            p.set("x265-params", x265params.toUtf8().constData());
         }
     } else {
         if (pass == 1 || pass == 2) {
-            consumerNode.setAttribute("pass", pass);
-            consumerNode.setAttribute("passlogfile", mytarget + "_2pass.log");
+            p.set("pass", pass);
+            p.set("passlogfile", QString(target + "_2pass.log").toUtf8().constData());
         } if (pass == 1) {
-            consumerNode.setAttribute("fastfirstpass", 1);
-            consumerNode.removeAttribute("acodec");
-            consumerNode.setAttribute("an", 1);
+            p.set("fastfirstpass", 1);
+            p.set("acodec", (const char*) 0);
+            p.set("an", 1);
         } else {
-            consumerNode.removeAttribute("fastfirstpass");
+            p.set("fastfirstpass", (const char*) 0);
         }
     }
-    if (ui->formatCombo->currentIndex() == 0 &&
-            ui->audioCodecCombo->currentIndex() == 0 &&
-            (mytarget.endsWith(".mp4") || mytarget.endsWith(".mov")))
-        consumerNode.setAttribute("strict", "experimental");
+}
 
-    // save new xml
-    f1.open(QIODevice::WriteOnly);
-    QTextStream ts(&f1);
-    dom.save(ts, 2);
-    f1.close();
+MeltJob* EncodeDock::createMeltJob(const QString& target, int realtime, int pass,
+                                   const QString& xml, MeltXmlTask* task)
+{
+    MeltJob* job = new EncodeJob(target, tempXmlName());
+    Mlt::Properties* consumer = createConsumer(target, realtime, pass);
+    QString jobXml = xml;
+    if (pass == 2 && isCachingFirstPass()) {
+        job->addTempFile(intermediateName(target));
+        jobXml = intermediateXml(intermediateName(target));
+    }
+    if (task) {
+        task->add(job, jobXml, consumer);
+    } else {
+        Mlt::Controller::writeXML(job->xmlPath(), ProxyManager::originalXML(jobXml), consumer);
+        delete consumer;
+    }
+    return job;
+}
+
+static QString codecForEncoder(const QString& encoder)
+{
+    // Map an encoder name to the codec name reported by the avformat producer.
+    if (encoder == "libx264")
+        return "h264";
+    else if (encoder == "libx265")
+        return "hevc";
+    else if (encoder == "libvpx")
+        return "vp8";
+    else if (encoder == "libvpx-vp9")
+        return "vp9";
+    else if (encoder == "libxvid")
+        return "mpeg4";
+    else if (encoder == "libtheora")
+        return "theora";
+    else if (encoder.startsWith("prores"))
+        return "prores";
+    else if (encoder == "libmp3lame")
+        return "mp3";
+    else if (encoder == "libvorbis")
+        return "vorbis";
+    else if (encoder == "libopus")
+        return "opus";
+    else if (encoder == "libfdk_aac" || encoder == "libfaac" || encoder == "libvo_aacenc")
+        return "aac";
+    else if (encoder == "libtwolame")
+        return "mp2";
+    return encoder;
+}
+
+static bool hasUserFilters(Mlt::Service& service)
+{
+    for (int i = 0; i < service.filter_count(); i++) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        if (filter && filter->is_valid() && !filter->get_int("_loader"))
+            return true;
+    }
+    return false;
+}
+
+// The job compares the profile, level and more of each stream with those of
+// what the export encodes, which MLT does not report.
+static bool isCopyable(Mlt::ClipInfo& info, const QString& vcodec, const QString& pixFmt, const QString& acodec)
+{
+    if (!info.producer || !info.producer->is_valid() || info.producer->is_blank())
+        return false;
+    Mlt::Producer parent = info.producer->parent();
+    if (!QString(parent.get("mlt_service")).startsWith("avformat") || ProxyManager::isProxy(parent))
+        return false;
+    if (hasUserFilters(*info.producer) || hasUserFilters(parent))
+        return false;
+    int index = parent.get_int("video_index");
+    if (index < 0 || vcodec != parent.get(QString("meta.media.%1.codec.name").arg(index).toLatin1().constData()))
+        return false;
+    if (!pixFmt.isEmpty() && pixFmt != parent.get(QString("meta.media.%1.codec.pix_fmt").arg(index).toLatin1().constData()))
+        return false;
+    if (parent.get_int("meta.media.width") != MLT.profile().width()
+            || parent.get_int("meta.media.height") != MLT.profile().height())
+        return false;
+    if (qint64(parent.get_int("meta.media.frame_rate_num")) * MLT.profile().frame_rate_den()
+            != qint64(parent.get_int("meta.media.frame_rate_den")) * MLT.profile().frame_rate_num())
+        return false;
+    if (!acodec.isEmpty()) {
+        index = parent.get_int("audio_index");
+        if (index < 0 || acodec != parent.get(QString("meta.media.%1.codec.name").arg(index).toLatin1().constData()))
+            return false;
+    }
+    return true;
+}
 
-    return new EncodeJob(target, tmpName);
+static bool segmentLessThan(const SmartRenderJob::Segment& a, const SmartRenderJob::Segment& b)
+{
+    return a.start < b.start;
+}
+
+QList<SmartRenderJob::Segment> EncodeDock::findCopySegments(Mlt::Properties& p)
+{
+    QList<SmartRenderJob::Segment> result;
+    if (!MAIN.multitrack() || !p.get("vcodec") || p.get_int("vn") || p.get_int("pass"))
+        return result;
+    if (!p.get_int("an") && !p.get("acodec"))
+        return result;
+
+    // The export must not scale or change the frame rate of the timeline.
+    if (p.get_int("width") != MLT.profile().width() || p.get_int("height") != MLT.profile().height())
+        return result;
+    double fps = p.get("r")? p.get_double("r")
+                           : double(p.get_int("frame_rate_num")) / qMax(1, p.get_int("frame_rate_den"));
+    if (qAbs(fps - MLT.profile().fps()) > 0.001)
+        return result;
+
+    Mlt::Tractor tractor(*MAIN.multitrack());
+    if (!tractor.is_valid() || hasUserFilters(tractor))
+        return result;
+    QString vcodec = codecForEncoder(p.get("vcodec"));
+    QString pixFmt = QString::fromLatin1(p.get("pix_fmt"));
+    QString acodec = p.get_int("an")? QString() : codecForEncoder(p.get("acodec"));
+
+    // Find the candidates and every range that is occupied on each track,
+    // skipping the background track.
+    QList<int> tracks;
+    QList<SmartRenderJob::Segment> occupied;
+    for (int i = 1; i < tractor.count(); i++) {
+        QScopedPointer<Mlt::Producer> track(tractor.track(i));
+        if (!track || !track->is_valid())
+            continue;
+        Mlt::Playlist playlist(*track);
+        bool trackOk = playlist.get_int("hide") == 0 && !hasUserFilters(playlist);
+        for (int j = 0; j < playlist.count(); j++) {
+            if (playlist.is_blank(j))
+                continue;
+            QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(j));
+            if (!info)
+                continue;
+            SmartRenderJob::Segment segment;
+            segment.start = info->start;
+            segment.length = info->frame_count;
+            segment.in = info->frame_in;
+            segment.videoIndex = -1;
+            segment.audioIndex = -1;
+            if (trackOk && isCopyable(*info, vcodec, pixFmt, acodec)) {
+                Mlt::Producer parent = info->producer->parent();
+                segment.resource = QString::fromUtf8(parent.get("resource"));
+                segment.videoIndex = parent.get_int("video_index");
+                segment.audioIndex = parent.get_int("audio_index");
+            }
+            occupied << segment;
+            tracks << i;
+        }
+    }
+
+    // A candidate may only be copied if nothing else is on top of or under it.
+    for (int i = 0; i < occupied.count(); i++) {
+        const SmartRenderJob::Segment& candidate = occupied.at(i);
+        if (candidate.resource.isEmpty())
+            continue;
+        bool isAlone = true;
+        for (int j = 0; j < occupied.count() && isAlone; j++) {
+            const SmartRenderJob::Segment& other = occupied.at(j);
+            if (tracks.at(j) != tracks.at(i)
+                    && other.start < candidate.start + candidate.length
+                    && candidate.start < other.start + other.length)
+                isAlone = false;
+        }
+        if (isAlone)
+            result << candidate;
+    }
+    qSort(result.begin(), result.end(), segmentLessThan);
+    return result;
+}
+
+MeltJob* EncodeDock::createSmartRenderJob(const QString& target, int realtime,
+                                          const QString& xml, MeltXmlTask* task)
+{
+    QList<SmartRenderJob::Segment> segments;
+    bool hasAudio = false;
+    Mlt::Properties* p = collectProperties(realtime);
+    if (p && p->is_valid()) {
+        segments = findCopySegments(*p);
+        hasAudio = !p->get_int("an");
+    }
+    delete p;
+    if (segments.isEmpty()) {
+        MAIN.showStatusMessage(tr("Smart render found nothing to copy"));
+        return 0;
+    }
+    int frames = 0;
+    foreach (SmartRenderJob::Segment segment, segments)
+        frames += segment.length;
+    int length = MAIN.multitrack()->get_length();
+    MAIN.showStatusMessage(tr("Smart render can copy up to %1 of %2 frames").arg(frames).arg(length));
+    MeltJob* job = new SmartRenderJob(target, tempXmlName(), length, segments, hasAudio);
+    task->add(job, xml, createConsumer(target, realtime));
+    return job;
 }
 
 void EncodeDock::runMelt(const QString& target, int realtime)
 {
-    m_immediateJob = createMeltJob(target, realtime);
+    m_immediateJob = createMeltJob(target, realtime, 0, MAIN.XML(QDir::tempPath()));
     if (m_immediateJob) {
         connect(m_immediateJob, SIGNAL(finished(AbstractJob*,bool)), this, SLOT(onFinished(AbstractJob*,bool)));
         m_immediateJob->start();
@@ -397,15 +654,17 @@ void EncodeDock::runMelt(const QString& target, int realtime)
 void EncodeDock::enqueueMelt(const QString& target, int realtime)
 {
     int pass = ui->dualPassCheckbox->isEnabled() && ui->dualPassCheckbox->isChecked()? 1 : 0;
-    MeltJob* job = createMeltJob(target, realtime, pass);
-    if (job) {
-        JOBS.add(job);
-        if (pass) {
-            job = createMeltJob(target, realtime, 2);
-            if (job)
-                JOBS.add(job);
-        }
+    // Serialize the project once here; the files are written in the background.
+    QString xml = MAIN.XML(QDir::tempPath());
+    MeltXmlTask* task = new MeltXmlTask;
+    if (!pass && ui->smartRenderCheckbox->isChecked() && createSmartRenderJob(target, realtime, xml, task)) {
+        QThreadPool::globalInstance()->start(task);
+        return;
     }
+    MeltJob* job = createMeltJob(target, realtime, pass, xml, task);
+    if (pass)
+        createMeltJob(target, realtime, 2, xml, task)->addDependency(job);
+    QThreadPool::globalInstance()->start(task);
 }
 
 void EncodeDock::encode(const QString& target)
@@ -454,6 +713,8 @@ void EncodeDock::resetOptions()
     ui->bFramesSpinner->setValue(0);
     ui->videoCodecThreadsSpinner->setValue(0);
     ui->dualPassCheckbox->setChecked(false);
+    ui->cachePassCheckbox->setChecked(false);
+    ui->smartRenderCheckbox->setChecked(false);
     ui->disableVideoCheckbox->setChecked(false);
 
     ui->sampleRateCombo->lineEdit()->setText("48000");
@@ -909,6 +1170,7 @@ void EncodeDock::on_videoRateControlCombo_activated(int index)
         ui->videoBufferSizeSpinner->hide();
         ui->videoQualitySpinner->hide();
         ui->dualPassCheckbox->show();
+        ui->cachePassCheckbox->show();
         ui->videoBitrateLabel->show();
         ui->videoBitrateSuffixLabel->show();
         ui->videoBufferSizeLabel->hide();
@@ -920,6 +1182,7 @@ void EncodeDock::on_videoRateControlCombo_activated(int index)
         ui->videoBufferSizeSpinner->show();
         ui->videoQualitySpinner->hide();
         ui->dualPassCheckbox->hide();
+        ui->cachePassCheckbox->hide();
         ui->videoBitrateLabel->show();
         ui->videoBitrateSuffixLabel->show();
         ui->videoBufferSizeLabel->show();
@@ -931,6 +1194,7 @@ void EncodeDock::on_videoRateControlCombo_activated(int index)
         ui->videoBufferSizeSpinner->hide();
         ui->videoQualitySpinner->show();
         ui->dualPassCheckbox->hide();
+        ui->cachePassCheckbox->hide();
         ui->videoBitrateLabel->hide();
         ui->videoBitrateSuffixLabel->hide();
         ui->videoBufferSizeLabel->hide();
@@ -20,9 +20,9 @@
 #define ENCODEDOCK_H
 
 #include <QDockWidget>
-#include <QDomElement>
 #include <QStandardItemModel>
 #include <QSortFilterProxyModel>
+#include "jobs/smartrenderjob.h"
 
 class QTreeWidgetItem;
 class QStringList;
@@ -34,6 +34,7 @@ namespace Mlt {
 }
 class AbstractJob;
 class MeltJob;
+class MeltXmlTask;
 
 class PresetsProxyModel : public QSortFilterProxyModel
 {
@@ -48,6 +49,7 @@ class EncodeDock : public QDockWidget
 public:
     explicit EncodeDock(QWidget *parent = 0);
     ~EncodeDock();
+    static void setPassProperties(Mlt::Properties& consumer, const QString& target, int pass);
 
 signals:
     void captureStateChanged(bool);
@@ -97,8 +99,13 @@ private:
 
     void loadPresets();
     Mlt::Properties* collectProperties(int realtime);
-    void collectProperties(QDomElement& node, int realtime);
-    MeltJob* createMeltJob(const QString& target, int realtime, int pass = 0);
+    bool isCachingFirstPass() const;
+    Mlt::Properties* createConsumer(const QString& target, int realtime, int pass = 0);
+    MeltJob* createMeltJob(const QString& target, int realtime, int pass,
+                           const QString& xml, MeltXmlTask* task = 0);
+    MeltJob* createSmartRenderJob(const QString& target, int realtime,
+                                  const QString& xml, MeltXmlTask* task);
+    QList<SmartRenderJob::Segment> findCopySegments(Mlt::Properties& consumer);
     void runMelt(const QString& target, int realtime = -1);
     void enqueueMelt(const QString& target, int realtime);
     void encode(const QString& target);
@@ -62,7 +62,8 @@ void JobsDock::on_treeView_customContextMenuRequested(const QPoint &pos)
         if (job->ran() && job->state() == QProcess::NotRunning && job->exitStatus() == QProcess::NormalExit) {
             menu.addActions(job->successActions());
         }
-        if (job->stopped() || (JOBS.isPaused() && !job->ran()))
+        // A job runs only after its dependencies succeed, as in the queue.
+        if ((job->stopped() || (JOBS.isPaused() && !job->ran())) && job->isReady())
             menu.addAction(ui->actionRun);
         if (job->state() == QProcess::Running)
             menu.addAction(ui->actionStopJob);
@@ -107,7 +108,7 @@ void JobsDock::on_actionRun_triggered()
     QModelIndex index = ui->treeView->currentIndex();
     if (!index.isValid()) return;
     AbstractJob* job = JOBS.jobFromIndex(index);
-    if (job) job->start();
+    if (job && job->isReady()) job->start();
 }
 
 void JobsDock::on_menuButton_clicked()
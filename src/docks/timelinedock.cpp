@@ -194,12 +194,11 @@ void TimelineDock::remove(int trackIndex, int clipIndex)
         clipIndex = m_quickView.rootObject()->property("currentClip").toInt();
     Mlt::Producer* clip = getClip(trackIndex, clipIndex);
     if (clip) {
-        QString xml = MLT.XML(clip);
         delete clip;
         QModelIndex idx = m_model.index(clipIndex, 0, m_model.index(trackIndex));
         int position = m_model.data(idx, MultitrackModel::StartRole).toInt();
         MAIN.undoStack()->push(
-            new Timeline::RemoveCommand(m_model, trackIndex, clipIndex, position, xml));
+            new Timeline::RemoveCommand(m_model, trackIndex, clipIndex, position));
     }
 }
 
@@ -211,12 +210,11 @@ void TimelineDock::lift(int trackIndex, int clipIndex)
         clipIndex = m_quickView.rootObject()->property("currentClip").toInt();
     Mlt::Producer* clip = getClip(trackIndex, clipIndex);
     if (clip) {
-        QString xml = MLT.XML(clip);
         delete clip;
         QModelIndex idx = m_model.index(clipIndex, 0, m_model.index(trackIndex));
         int position = m_model.data(idx, MultitrackModel::StartRole).toInt();
         MAIN.undoStack()->push(
-            new Timeline::LiftCommand(m_model, trackIndex, clipIndex, position, xml));
+            new Timeline::LiftCommand(m_model, trackIndex, clipIndex, position));
     }
 }
 
@@ -358,6 +356,42 @@ bool TimelineDock::trimClipOut(int trackIndex, int clipIndex, int delta)
     return true;
 }
 
+bool TimelineDock::rippleTrimClipIn(int trackIndex, int clipIndex, int delta)
+{
+    return editGraph(TimelineGraph::RippleTrimIn, trackIndex, clipIndex, delta);
+}
+
+bool TimelineDock::rippleTrimClipOut(int trackIndex, int clipIndex, int delta)
+{
+    return editGraph(TimelineGraph::RippleTrimOut, trackIndex, clipIndex, delta);
+}
+
+bool TimelineDock::rollEdit(int trackIndex, int clipIndex, int delta)
+{
+    return editGraph(TimelineGraph::Roll, trackIndex, clipIndex, delta);
+}
+
+bool TimelineDock::slipClip(int trackIndex, int clipIndex, int delta)
+{
+    return editGraph(TimelineGraph::Slip, trackIndex, clipIndex, delta);
+}
+
+bool TimelineDock::slideClip(int trackIndex, int clipIndex, int delta)
+{
+    return editGraph(TimelineGraph::Slide, trackIndex, clipIndex, delta);
+}
+
+bool TimelineDock::editGraph(TimelineGraph::Edit edit, int trackIndex, int clipIndex, int delta)
+{
+    TimelineGraph before = m_model.graph();
+    TimelineGraph after(before);
+    if (!after.edit(edit, trackIndex, clipIndex, delta))
+        return false;
+    MAIN.undoStack()->push(
+        new Timeline::EditGraphCommand(m_model, edit, trackIndex, clipIndex, before, after));
+    return true;
+}
+
 void TimelineDock::insert(int trackIndex, int position, const QString &xml)
 {
     if (MLT.isSeekableClip() || MLT.savedProducer() || !xml.isEmpty()) {
@@ -82,6 +82,11 @@ public slots:
     bool moveClip(int fromTrack, int toTrack, int clipIndex, int position);
     bool trimClipIn(int trackIndex, int clipIndex, int delta);
     bool trimClipOut(int trackIndex, int clipIndex, int delta);
+    bool rippleTrimClipIn(int trackIndex, int clipIndex, int delta);
+    bool rippleTrimClipOut(int trackIndex, int clipIndex, int delta);
+    bool rollEdit(int trackIndex, int clipIndex, int delta);
+    bool slipClip(int trackIndex, int clipIndex, int delta);
+    bool slideClip(int trackIndex, int clipIndex, int delta);
     void insert(int trackIndex, int position = -1, const QString &xml = QString());
     void overwrite(int trackIndex, int position = -1, const QString &xml = QString());
     void appendFromPlaylist(Mlt::Playlist* playlist);
@@ -99,6 +104,8 @@ protected:
     bool event(QEvent *event);
 
 private:
+    bool editGraph(TimelineGraph::Edit edit, int trackIndex, int clipIndex, int delta);
+
     Ui::TimelineDock *ui;
     QQuickView m_quickView;
     MultitrackModel m_model;
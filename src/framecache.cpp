@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framecache.h"
+#include <QMutexLocker>
+
+FrameCache::FrameCache(int budgetMB)
+    : m_cache(qMax(0, budgetMB) * 1024)
+    , m_revision(0)
+{
+}
+
+quint64 FrameCache::key(int position) const
+{
+    return (quint64(m_revision) << 32) | quint32(position);
+}
+
+bool FrameCache::find(int position, SharedFrame& frame)
+{
+    QMutexLocker locker(&m_mutex);
+    SharedFrame* cached = m_cache.object(key(position));
+    if (cached)
+        frame = *cached;
+    return cached != 0;
+}
+
+void FrameCache::insert(const SharedFrame& frame)
+{
+    // The cost is in KiB to keep large budgets within an int.
+    int size = mlt_image_format_size(frame.get_image_format(),
+                                     frame.get_image_width(),
+                                     frame.get_image_height(), 0);
+    QMutexLocker locker(&m_mutex);
+    m_cache.insert(key(frame.get_position()), new SharedFrame(frame), qMax(1, size / 1024));
+}
+
+void FrameCache::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_revision;
+    m_cache.clear();
+}
+
+void FrameCache::setBudget(int budgetMB)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(qMax(0, budgetMB) * 1024);
+}
+
+uint FrameCache::revision() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_revision;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include "sharedframe.h"
+
+/*!
+  \class FrameCache
+  \brief FrameCache keeps recently displayed images for instant re-display.
+
+  \threadsafe
+
+  Frames are keyed by the revision of the producer graph and the position.
+  Call invalidate() whenever anything changes the rendered images; it bumps
+  the revision and drops all frames. The least recently used frames are
+  dropped when the total image size exceeds the budget.
+*/
+
+class FrameCache
+{
+public:
+    explicit FrameCache(int budgetMB = 512);
+
+    bool find(int position, SharedFrame& frame);
+    void insert(const SharedFrame& frame);
+    void invalidate();
+    void setBudget(int budgetMB);
+    uint revision() const;
+
+private:
+    quint64 key(int position) const;
+
+    mutable QMutex m_mutex;
+    QCache<quint64, SharedFrame> m_cache;
+    uint m_revision;
+};
+
+#endif // FRAMECACHE_H
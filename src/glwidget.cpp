@@ -30,6 +30,9 @@
 #include "qmltypes/qmlutilities.h"
 #include "qmltypes/qmlfilter.h"
 #include "mainwindow.h"
+#include "seekindex.h"
+#include "playbacktrace.h"
+#include "audioscrubber.h"
 
 #define USE_GL_SYNC // Use glFinish() if not defined.
 
@@ -44,6 +47,9 @@ typedef GLenum (*ClientWaitSync_fp) (GLsync sync, GLbitfield flags, GLuint64 tim
 static ClientWaitSync_fp ClientWaitSync = 0;
 #endif
 
+// The clock of frame presentation times, started with the first renderer.
+static QElapsedTimer presentClock;
+
 using namespace Mlt;
 
 GLWidget::GLWidget(QObject *parent)
@@ -58,8 +64,25 @@ GLWidget::GLWidget(QObject *parent)
     , m_threadCreateEvent(0)
     , m_threadJoinEvent(0)
     , m_frameRenderer(0)
+    , m_textureFormat(mlt_image_yuv420p)
     , m_zoom(0.0f)
     , m_offset(QPoint(0, 0))
+    , m_cachedPosition(-1)
+    , m_cachedRevision(0)
+    , m_previewScale(1)
+    , m_scrubTarget(-1)
+    , m_lastFrame(-1)
+    , m_keyframePosition(-1)
+    , m_keyframeTarget(-1)
+    , m_seekPosition(-1)
+    , m_presentDelay(Settings.playerPresentDelay())
+    , m_vsyncInterval(1000000 / 60)
+    , m_isAnchorReset(1)
+    , m_anchorTime(0)
+    , m_anchorPosition(0)
+    , m_anchorSpeed(0.0)
+    , m_audioScrubber(0)
+    , m_scrubberRevision(0)
 {
     qDebug() << "begin";
     m_texture[0] = m_texture[1] = m_texture[2] = 0;
@@ -83,6 +106,16 @@ GLWidget::GLWidget(QObject *parent)
     connect(this, SIGNAL(sceneGraphInitialized()), SLOT(initializeGL()), Qt::DirectConnection);
     connect(this, SIGNAL(sceneGraphInitialized()), SLOT(setBlankScene()), Qt::QueuedConnection);
     connect(this, SIGNAL(beforeRendering()), SLOT(paintGL()), Qt::DirectConnection);
+    connect(this, SIGNAL(frameDisplayed(const SharedFrame&)), SLOT(onFrameDisplayed(const SharedFrame&)));
+    connect(this, SIGNAL(frameSwapped()), SLOT(onFrameSwapped()), Qt::DirectConnection);
+    if (QGuiApplication::primaryScreen() && QGuiApplication::primaryScreen()->refreshRate() > 0)
+        m_vsyncInterval = 1000000 / QGuiApplication::primaryScreen()->refreshRate();
+    m_scrubTimer.setSingleShot(true);
+    m_scrubTimer.setInterval(150);
+    connect(&m_scrubTimer, SIGNAL(timeout()), SLOT(onScrubTimeout()));
+    // The scrubber copies the producer, which is not done for GPU effects.
+    if (!Settings.playerGPU())
+        m_audioScrubber = new AudioScrubber;
     qDebug() << "end";
 }
 
@@ -90,6 +123,9 @@ GLWidget::~GLWidget()
 {
     qDebug();
     stop();
+    if (m_consumer && m_audioScrubber && m_audioScrubber->filter())
+        m_consumer->detach(*m_audioScrubber->filter());
+    delete m_audioScrubber;
     delete m_glslManager;
     delete m_threadStartEvent;
     delete m_threadStopEvent;
@@ -127,11 +163,11 @@ void GLWidget::initializeGL()
 #endif
 
     openglContext()->doneCurrent();
-    m_frameRenderer = new FrameRenderer(openglContext());
+    m_frameRenderer = new FrameRenderer(openglContext(), m_presentDelay, m_vsyncInterval, m_droppedCount);
     openglContext()->makeCurrent(openglContext()->surface());
 
     connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), this, SIGNAL(frameDisplayed(const SharedFrame&)), Qt::QueuedConnection);
-    connect(m_frameRenderer, SIGNAL(textureReady(GLuint,GLuint,GLuint)), SLOT(updateTexture(GLuint,GLuint,GLuint)), Qt::DirectConnection);
+    connect(m_frameRenderer, SIGNAL(textureReady(GLuint,GLuint,GLuint,int)), SLOT(updateTexture(GLuint,GLuint,GLuint,int)), Qt::DirectConnection);
     connect(this, SIGNAL(textureUpdated()), SLOT(update()), Qt::QueuedConnection);
 
     m_initSem.release();
@@ -206,12 +242,19 @@ void GLWidget::createShader()
         m_shader->addShaderFromSourceCode(QOpenGLShader::Fragment,
                                           "uniform sampler2D Ytex, Utex, Vtex;"
                                           "uniform int colorspace;"
+                                          "uniform int isPacked;"
                                           "varying vec2 coordinates;"
                                           "void main(void) {"
                                           "  vec3 texel;"
                                           "  texel.r = texture2D(Ytex, coordinates).r - 0.0625;" // Y
-                                          "  texel.g = texture2D(Utex, coordinates).r - 0.5;"    // U
-                                          "  texel.b = texture2D(Vtex, coordinates).r - 0.5;"    // V
+                                          "  if (isPacked == 1) {" // YUYV as RGBA: U in green, V in alpha
+                                          "    vec4 chroma = texture2D(Utex, coordinates);"
+                                          "    texel.g = chroma.g - 0.5;"
+                                          "    texel.b = chroma.a - 0.5;"
+                                          "  } else {"
+                                          "    texel.g = texture2D(Utex, coordinates).r - 0.5;" // U
+                                          "    texel.b = texture2D(Vtex, coordinates).r - 0.5;" // V
+                                          "  }"
                                           "  mat3 coefficients;"
                                           "  if (colorspace == 601) {"
                                           "    coefficients = mat3("
@@ -231,6 +274,7 @@ void GLWidget::createShader()
         m_textureLocation[1] = m_shader->uniformLocation("Utex");
         m_textureLocation[2] = m_shader->uniformLocation("Vtex");
         m_colorspaceLocation = m_shader->uniformLocation("colorspace");
+        m_isPackedLocation = m_shader->uniformLocation("isPacked");
     }
     m_projectionLocation = m_shader->uniformLocation("projection");
     m_modelViewLocation = m_shader->uniformLocation("modelView");
@@ -240,6 +284,7 @@ void GLWidget::createShader()
 
 void GLWidget::paintGL()
 {
+    qint64 start = TRACE.isEnabled()? TRACE.now() : 0;
     int width = this->width() * devicePixelRatio();
     int height = this->height() * devicePixelRatio();
 
@@ -273,6 +318,7 @@ void GLWidget::paintGL()
         m_shader->setUniformValue(m_textureLocation[1], 1);
         m_shader->setUniformValue(m_textureLocation[2], 2);
         m_shader->setUniformValue(m_colorspaceLocation, MLT.profile().colorspace());
+        m_shader->setUniformValue(m_isPackedLocation, m_textureFormat == mlt_image_yuv422);
     }
     check_error();
 
@@ -334,6 +380,29 @@ void GLWidget::paintGL()
     }
     glActiveTexture(GL_TEXTURE0);
     check_error();
+
+    if (start) {
+        TRACE.add(PlaybackTrace::PaintStage, start, TRACE.now());
+        paintStatistics();
+    }
+}
+
+void GLWidget::paintStatistics()
+{
+    // Draw with QPainter over the image; the scene graph draws after this.
+    QOpenGLPaintDevice device(width() * devicePixelRatio(), height() * devicePixelRatio());
+    QPainter painter(&device);
+    QFont font = painter.font();
+    font.setPixelSize(12 * devicePixelRatio());
+    painter.setFont(font);
+    QString text = TRACE.summary();
+    QRect rect = painter.fontMetrics().boundingRect(QRect(), Qt::AlignLeft, text).adjusted(-4, -2, 4, 2);
+    rect.moveTopLeft(QPoint(4, 4));
+    painter.fillRect(rect, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(rect.adjusted(4, 2, -4, -2), Qt::AlignLeft, text);
+    painter.end();
+    resetOpenGLState();
 }
 
 void GLWidget::mousePressEvent(QMouseEvent* event)
@@ -459,6 +528,7 @@ int GLWidget::setProducer(Mlt::Producer* producer, bool isMulti)
         if (!error) {
             // The profile display aspect ratio may have changed.
             resizeGL(width(), height());
+            resetAudioScrubber();
         }
     }
     return error;
@@ -499,6 +569,7 @@ int GLWidget::reconfigure(bool isMulti)
         m_consumer->connect(*m_producer);
         // Make an event handler for when a frame's image should be displayed
         m_consumer->listen("consumer-frame-show", this, (mlt_listener) on_frame_show);
+        m_consumer->listen("consumer-frame-render", this, (mlt_listener) on_frame_render);
         m_consumer->set("real_time", MLT.realTime());
         m_consumer->set("mlt_image_format", "yuv422");
         m_consumer->set("color_trc", Settings.playerGamma().toLatin1().constData());
@@ -535,6 +606,12 @@ int GLWidget::reconfigure(bool isMulti)
             m_consumer->set("buffer", 25);
             m_consumer->set("prefill", 1);
             m_consumer->set("scrub_audio", 1);
+            if (m_audioScrubber && m_audioScrubber->filter()) {
+                m_consumer->detach(*m_audioScrubber->filter());
+                m_consumer->attach(*m_audioScrubber->filter());
+                m_audioScrubber->setAudioFormat(m_consumer->get("frequency")? m_consumer->get_int("frequency") : 48000,
+                                                m_consumer->get("channels")? m_consumer->get_int("channels") : 2);
+            }
             if (property("keyer").isValid())
                 m_consumer->set("keyer", property("keyer").toInt());
         }
@@ -595,23 +672,257 @@ void GLWidget::setCurrentFilter(QmlFilter* filter, QmlMetadata* meta)
     }
 }
 
-void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName)
+void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName, int format)
 {
     m_texture[0] = yName;
     m_texture[1] = uName;
     m_texture[2] = vName;
+    m_textureFormat = format;
     emit textureUpdated();
 }
 
+void GLWidget::play(double speed)
+{
+    m_cachedPosition = -1;
+    m_keyframePosition = -1;
+    m_isAnchorReset = 1;
+    if (speed != 0) {
+        m_scrubTimer.stop();
+        m_frameCount = 0;
+        m_droppedCount = 0;
+        m_previewScale = playbackScale();
+    } else {
+        m_previewScale = 1;
+    }
+    setPreviewScale(m_previewScale);
+    Controller::play(speed);
+    if (speed == 0) emit paused();
+    else emit playing();
+}
+
+void GLWidget::pause()
+{
+    m_cachedPosition = -1;
+    // Restore the full resolution first so that the paused frame is
+    // rendered once at it.
+    bool isPlaying = producer() && producer()->get_speed() != 0;
+    bool isScaled = m_previewScale != 1;
+    if (isScaled) {
+        m_previewScale = 1;
+        setPreviewScale(1);
+    }
+    Controller::pause();
+    if (isScaled && !isPlaying)
+        refreshConsumer(false);
+    emit paused();
+}
+
+int GLWidget::playbackScale() const
+{
+    int divisor = Settings.playerPreviewScale();
+    if (divisor > 0)
+        return divisor;
+    // Automatic: no more pixels than the video area shows.
+    int shown = qMax(1, qRound(m_rect.width() * devicePixelRatio()));
+    divisor = 1;
+    while (divisor < 4 && profile().width() / (divisor * 2) >= shown)
+        divisor *= 2;
+    return divisor;
+}
+
+void GLWidget::onBehind()
+{
+    // Automatic scaling steps down when playback drops frames.
+    if (Settings.playerPreviewScale() == 0 && m_previewScale < 4
+            && producer() && producer()->get_speed() != 0) {
+        m_previewScale *= 2;
+        m_frameCount = 0;
+        m_droppedCount = 0;
+        setPreviewScale(m_previewScale);
+    }
+}
+
+void GLWidget::seek(int position)
+{
+    m_isAnchorReset = 1;
+    // A seek soon after another is scrubbing.
+    if (m_scrubTimer.isActive())
+        updateAudioScrubber(position);
+    // Show a cached image right away instead of rendering it again. The
+    // renderer must be idle to take it; otherwise, render as usual.
+    SharedFrame cached;
+    if (!Settings.playerGPU() && m_frameRenderer
+            && m_frameCache.find(position, cached)
+            && m_frameRenderer->semaphore()->tryAcquire()) {
+        m_cachedPosition = position;
+        m_cachedRevision = m_frameCache.revision();
+        m_keyframePosition = -1;
+        Controller::seek(position, false);
+        Mlt::Frame frame = cached.clone(false, true);
+        frame.set("shotcut_cached", 1);
+        QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+    } else {
+        m_cachedPosition = -1;
+        if (m_previewScale != 1) {
+            m_previewScale = 1;
+            setPreviewScale(1);
+        }
+        // Show a key frame for the target without moving the play head.
+        int target = position;
+        position = scrubPosition(position);
+        m_keyframeTarget = target;
+        m_keyframePosition = (position != target)? position : -1;
+        Controller::seek(position);
+        m_seekPosition = position;
+        m_seekTime.start();
+    }
+    emit paused();
+}
+
+int GLWidget::scrubPosition(int position)
+{
+    // Seeks that arrive in quick succession are scrubbing. Then it is cheaper
+    // to show the key frame before the target, unless the decoder can reach
+    // the target by continuing forward within the same GOP. The exact frame
+    // follows once the scrubbing stops.
+    bool isScrubbing = m_scrubTimer.isActive();
+    m_scrubTimer.start();
+    m_scrubTarget = position;
+    QString resource;
+    int frame, firstFrame, keyframe;
+    if (!producer() || !SeekIndex::findSource(*producer(), position, resource, frame, firstFrame)
+            || !SEEKINDEX.keyframeAtOrBefore(resource, frame, profile().fps(), keyframe)) {
+        m_lastResource.clear();
+        return position;
+    }
+    if (isScrubbing && keyframe >= firstFrame && keyframe < frame
+            && !(resource == m_lastResource && m_lastFrame >= keyframe && m_lastFrame <= frame)) {
+        position -= frame - keyframe;
+        frame = keyframe;
+    }
+    m_lastResource = resource;
+    m_lastFrame = frame;
+    return position;
+}
+
+void GLWidget::onScrubTimeout()
+{
+    if (m_scrubTarget >= 0 && m_scrubTarget != m_seekPosition && m_cachedPosition < 0)
+        seek(m_scrubTarget);
+}
+
+// The scrubber copies the clips around the play head when scrubbing or
+// shuttling starts, unless its copy is still current and reaches here.
+void GLWidget::updateAudioScrubber(int position)
+{
+    if (!m_audioScrubber || !Settings.playerAudioScrubber())
+        return;
+    if (m_scrubberRevision == m_frameCache.revision() && m_audioScrubber->covers(position))
+        return;
+    m_scrubberRevision = m_frameCache.revision();
+    m_audioScrubber->setProducer(m_producer, position);
+}
+
+void GLWidget::resetAudioScrubber()
+{
+    if (m_audioScrubber)
+        m_audioScrubber->setProducer(0, 0);
+}
+
+void GLWidget::onFrameDisplayed(const SharedFrame& frame)
+{
+    if (m_audioScrubber) {
+        double speed = frame.get_double("_speed");
+        m_audioScrubber->setPosition(frame.get_position(), speed);
+        if (speed != 0.0 && speed != 1.0)
+            updateAudioScrubber(frame.get_position());
+    }
+    if (m_seekTime.isValid() && frame.get_position() == m_scrubTarget) {
+        TRACE.addSeekLatency(m_seekTime.elapsed());
+        m_seekTime.invalidate();
+    }
+}
+
+// MLT consumer-frame-render event handler
+void GLWidget::on_frame_render(mlt_consumer, void*, mlt_frame frame_ptr)
+{
+    if (TRACE.isEnabled())
+        mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame_ptr), "shotcut:render", TRACE.now());
+}
+
+void GLWidget::onFrameSwapped()
+{
+    if (m_frameRenderer)
+        m_frameRenderer->addVsync(FrameRenderer::now());
+}
+
+// Played frames are presented on a schedule that starts when playing starts,
+// seeks or changes speed, so that they stay evenly spaced however unevenly
+// they are rendered. It starts over when rendering falls behind it.
+qint64 GLWidget::presentTime(int position, double speed)
+{
+    qint64 now = FrameRenderer::now();
+    double frameDuration = 1000000.0 / profile().fps();
+    qint64 time = m_anchorTime + qRound64((position - m_anchorPosition) * frameDuration / speed);
+    if (m_isAnchorReset.fetchAndStoreRelaxed(0) || speed != m_anchorSpeed
+            || time < now - 2 * frameDuration
+            || time > now + (m_presentDelay + 3) * frameDuration) {
+        m_anchorTime = now + qRound64(m_presentDelay * frameDuration);
+        m_anchorPosition = position;
+        m_anchorSpeed = speed;
+        time = m_anchorTime;
+    }
+    return time;
+}
+
 // MLT consumer-frame-show event handler
 void GLWidget::on_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
 {
     GLWidget* widget = static_cast<GLWidget*>(self);
-    int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
+    qint64 start = TRACE.isEnabled()? TRACE.now() : 0;
+    if (start && mlt_properties_get_int64(MLT_FRAME_PROPERTIES(frame_ptr), "shotcut:render"))
+        TRACE.add(PlaybackTrace::RenderStage, mlt_properties_get_int64(MLT_FRAME_PROPERTIES(frame_ptr), "shotcut:render"), start);
+    // While paused on a cached image, drop what the consumer still delivers
+    // unless the graph changed since.
+    if (widget->m_cachedPosition >= 0 && !mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame_ptr), "_speed")
+            && widget->m_cachedRevision == widget->m_frameCache.revision())
+        return;
+    // A key frame shown for a scrubbing target is reported at the target.
+    if (widget->m_keyframePosition.load() >= 0 && !mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame_ptr), "_speed")
+            && mlt_frame_get_position(frame_ptr) == widget->m_keyframePosition.load()) {
+        mlt_frame_set_position(frame_ptr, widget->m_keyframeTarget.load());
+        mlt_properties_set_int(MLT_FRAME_PROPERTIES(frame_ptr), "shotcut_keyframe", 1);
+    }
+    // When the queue is full, give the renderer up to a frame to make room
+    // before dropping, and schedule a played frame to be presented.
+    int frameDuration = 1000 / widget->profile().fps();
+    int timeout = (widget->consumer()->get_int("real_time") > 0)? frameDuration : 1000;
+    bool isShown = false;
     if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
         Mlt::Frame frame(frame_ptr);
         if (frame.get_int("rendered")) {
-            QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+            double speed = frame.get_double("_speed");
+            qint64 presentTime = speed? widget->presentTime(frame.get_position(), speed) : 0;
+            QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection,
+                                      Q_ARG(Mlt::Frame, frame), Q_ARG(qint64, presentTime));
+            isShown = true;
+        } else {
+            widget->m_frameRenderer->semaphore()->release();
+        }
+    }
+    if (start)
+        TRACE.add(PlaybackTrace::WaitStage, start, TRACE.now());
+    // Count the frames that were dropped while playing, about each second.
+    // The renderer counts those it shows or skips.
+    if (mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame_ptr), "_speed") != 0) {
+        if (!isShown) {
+            widget->m_droppedCount.ref();
+            TRACE.addFrame(true);
+        }
+        if (widget->m_frameCount.fetchAndAddRelaxed(1) >= 25) {
+            if (widget->m_droppedCount.fetchAndStoreRelaxed(0) > 2)
+                QMetaObject::invokeMethod(widget, "onBehind", Qt::QueuedConnection);
+            widget->m_frameCount = 0;
         }
     }
 }
@@ -647,12 +958,20 @@ void RenderThread::run()
     }
 }
 
-FrameRenderer::FrameRenderer(QOpenGLContext* shareContext)
+FrameRenderer::FrameRenderer(QOpenGLContext* shareContext, int presentDelay, qint64 vsyncInterval,
+                             QAtomicInt& droppedCount)
      : QThread(0)
-     , m_semaphore(3)
+     , m_semaphore(3 + presentDelay)
+     , m_queueSize(3 + presentDelay)
+     , m_presentDelay(presentDelay)
+     , m_vsyncInterval(vsyncInterval)
+     , m_lastVsync(0)
+     , m_droppedCount(droppedCount)
      , m_frame()
      , m_context(0)
      , m_surface(0)
+     , m_isTextureRg(false)
+     , m_isTexture16(false)
      , m_gl32(0)
 {
     Q_ASSERT(shareContext);
@@ -662,10 +981,15 @@ FrameRenderer::FrameRenderer(QOpenGLContext* shareContext)
     m_context->setFormat(shareContext->format());
     m_context->setShareContext(shareContext);
     m_context->create();
+    bool isOpenGLES = m_context->format().renderableType() == QSurfaceFormat::OpenGLES;
+    m_isTextureRg = m_context->format().majorVersion() >= 3;
+    m_isTexture16 = m_isTextureRg && !isOpenGLES;
     m_surface = new QOffscreenSurface;
     m_surface->setFormat(m_context->format());
     m_surface->create();
     m_context->moveToThread(this);
+    if (!presentClock.isValid())
+        presentClock.start();
     setObjectName("FrameRenderer");
     moveToThread(this);
     start();
@@ -678,9 +1002,79 @@ FrameRenderer::~FrameRenderer()
     delete m_gl32;
 }
 
-void FrameRenderer::showFrame(Mlt::Frame frame)
+static void uploadTexture(GLuint texture, GLint internalFormat, int width, int height,
+                          GLenum format, GLenum type, const uint8_t* data)
+{
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture  (GL_TEXTURE_2D, texture);
+    check_error();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    check_error();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    check_error();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    check_error();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    check_error();
+    glTexImage2D   (GL_TEXTURE_2D, 0, internalFormat, width, height, 0,
+                    format, type, data);
+    check_error();
+}
+
+qint64 FrameRenderer::now()
+{
+    return presentClock.nsecsElapsed() / 1000;
+}
+
+void FrameRenderer::addVsync(qint64 time)
+{
+    QMutexLocker locker(&m_vsyncMutex);
+    // Swaps are a whole number of refreshes apart when the display is not
+    // drawn every refresh.
+    qint64 delta = time - m_lastVsync;
+    int n = qRound(double(delta) / m_vsyncInterval);
+    if (m_lastVsync && n >= 1 && n <= 4 && qAbs(delta - n * m_vsyncInterval) < m_vsyncInterval / 4)
+        m_vsyncInterval = (m_vsyncInterval * 7 + delta / n) / 8;
+    m_lastVsync = time;
+}
+
+void FrameRenderer::waitForPresentTime(qint64 presentTime)
+{
+    if (!presentTime)
+        return;
+    qint64 frameDuration = 1000000 / MLT.profile().fps();
+    m_vsyncMutex.lock();
+    qint64 interval = m_vsyncInterval;
+    qint64 lastVsync = m_lastVsync;
+    m_vsyncMutex.unlock();
+    // Hand the frame over just after the vsync before the one nearest its
+    // present time so that it is drawn in time for that one. Without a
+    // measured vsync, aim half a refresh early.
+    qint64 wakeTime = presentTime - interval / 2;
+    if (lastVsync)
+        wakeTime = lastVsync + qRound64(double(presentTime - lastVsync) / interval) * interval - interval;
+    qint64 wait = wakeTime - now();
+    if (wait > 0)
+        QThread::usleep(qMin(wait, frameDuration * m_queueSize));
+    if (now() > presentTime + frameDuration / 2)
+        TRACE.addLate();
+}
+
+void FrameRenderer::showFrame(Mlt::Frame frame, qint64 presentTime)
 {
     if (m_context->isValid()) {
+        // Skip a frame that is already too late when a newer one is waiting.
+        if (presentTime && m_queueSize - m_semaphore.available() > 1
+                && now() > presentTime + 1000000 / MLT.profile().fps()) {
+            if (frame.get_double("_speed") != 0) {
+                m_droppedCount.ref();
+                TRACE.addFrame(true);
+            }
+            m_semaphore.release();
+            return;
+        }
+        qint64 start = TRACE.isEnabled()? TRACE.now() : 0;
         int width = 0;
         int height = 0;
 
@@ -715,74 +1109,89 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
 #else
             glFinish();
 #endif // USE_GL_FENCE
+            if (start)
+                TRACE.add(PlaybackTrace::UploadStage, start, TRACE.now());
+            waitForPresentTime(presentTime);
             emit textureReady(*textureId);
         }
         else {
-            mlt_image_format format = mlt_image_yuv420p;
+            // Upload the image in the format the consumer already rendered
+            // so that it is not converted again; the shader handles each.
+            mlt_image_format format = (mlt_image_format) frame.get_int("format");
+            if (format != mlt_image_yuv422 && format != mlt_image_yuv420p
+#ifdef SHOTCUT_HAVE_YUV422P16
+                    && format != mlt_image_yuv422p16
+#endif
+                    )
+                format = mlt_image_yuv422;
+            // Without the texture formats these need, use the 8-bit planar path.
+#ifdef SHOTCUT_HAVE_YUV422P16
+            if (format == mlt_image_yuv422p16 && !m_isTexture16)
+                format = mlt_image_yuv422;
+#endif
+            if (format == mlt_image_yuv422 && !m_isTextureRg)
+                format = mlt_image_yuv420p;
             const uint8_t* image = frame.get_image(format, width, height);
 
-            // Upload each plane of YUV to a texture.
             if (m_renderTexture[0] && m_renderTexture[1] && m_renderTexture[2])
                 glDeleteTextures(3, m_renderTexture);
             glGenTextures(3, m_renderTexture);
             check_error();
-            glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
 
-            glBindTexture  (GL_TEXTURE_2D, m_renderTexture[0]);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexImage2D   (GL_TEXTURE_2D, 0, GL_RED, width, height, 0,
-                            GL_RED, GL_UNSIGNED_BYTE, image);
-            check_error();
-
-            glBindTexture  (GL_TEXTURE_2D, m_renderTexture[1]);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexImage2D   (GL_TEXTURE_2D, 0, GL_RED, width/2, height/4, 0,
-                            GL_RED, GL_UNSIGNED_BYTE, image + width * height);
-            check_error();
-
-            glBindTexture  (GL_TEXTURE_2D, m_renderTexture[2]);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            check_error();
-            glTexImage2D   (GL_TEXTURE_2D, 0, GL_RED, width/2, height/4, 0,
-                            GL_RED, GL_UNSIGNED_BYTE, image + width * height + width/2 * height/2);
-            check_error();
+            if (format == mlt_image_yuv422) {
+                // Packed YUYV: luma from a two channel texture, and chroma
+                // from a half width RGBA texture of the same data.
+                uploadTexture(m_renderTexture[0], GL_RG, width, height,
+                              GL_RG, GL_UNSIGNED_BYTE, image);
+                uploadTexture(m_renderTexture[1], GL_RGBA, width / 2, height,
+                              GL_RGBA, GL_UNSIGNED_BYTE, image);
+            }
+#ifdef SHOTCUT_HAVE_YUV422P16
+            else if (format == mlt_image_yuv422p16) {
+                uploadTexture(m_renderTexture[0], GL_R16, width, height,
+                              GL_RED, GL_UNSIGNED_SHORT, image);
+                uploadTexture(m_renderTexture[1], GL_R16, width / 2, height,
+                              GL_RED, GL_UNSIGNED_SHORT, image + width * height * 2);
+                uploadTexture(m_renderTexture[2], GL_R16, width / 2, height,
+                              GL_RED, GL_UNSIGNED_SHORT, image + width * height * 3);
+            }
+#endif
+            else {
+                uploadTexture(m_renderTexture[0], GL_RED, width, height,
+                              GL_RED, GL_UNSIGNED_BYTE, image);
+                uploadTexture(m_renderTexture[1], GL_RED, width / 2, height / 2,
+                              GL_RED, GL_UNSIGNED_BYTE, image + width * height);
+                uploadTexture(m_renderTexture[2], GL_RED, width / 2, height / 2,
+                              GL_RED, GL_UNSIGNED_BYTE, image + width * height + width / 2 * height / 2);
+            }
 
             glBindTexture(GL_TEXTURE_2D, 0);
             check_error();
             glFinish();
+            if (start)
+                TRACE.add(PlaybackTrace::UploadStage, start, TRACE.now());
+            waitForPresentTime(presentTime);
 
             for (int i = 0; i < 3; ++i)
                 qSwap(m_renderTexture[i], m_displayTexture[i]);
-            emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
+            emit textureReady(m_displayTexture[0], m_displayTexture[1],
+                              format == mlt_image_yuv422? 0 : m_displayTexture[2], format);
         }
         m_context->doneCurrent();
 
         // Save this frame for future use and to keep a reference to the GL Texture.
         m_frame = SharedFrame(frame);
 
+        // Keep a copy of paused frames to show again without rendering, but
+        // not one rendered at a preview scale.
+        if (!Settings.playerGPU() && frame.get_double("_speed") == 0.0
+                && !frame.get_int("shotcut_cached") && !frame.get_int("shotcut_keyframe")
+                && width == MLT.profile().width() && height == MLT.profile().height())
+            MLT.frameCache().insert(SharedFrame(m_frame.clone(false, true)));
+
+        if (frame.get_double("_speed") != 0)
+            TRACE.addFrame(false);
+
         // The frame is now done being modified and can be shared with the rest
         // of the application.
         emit frameDisplayed(m_frame);
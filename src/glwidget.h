@@ -28,6 +28,9 @@
 #include <QMutex>
 #include <QThread>
 #include <QRect>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "mltcontroller.h"
 #include "sharedframe.h"
 
@@ -36,6 +39,7 @@ class QOffscreenSurface;
 class QOpenGLTexture;
 class QmlFilter;
 class QmlMetadata;
+class AudioScrubber;
 
 namespace Mlt {
 
@@ -62,19 +66,9 @@ public:
     int setProducer(Mlt::Producer*, bool isMulti = false);
     int reconfigure(bool isMulti);
 
-    void play(double speed = 1.0) {
-        Controller::play(speed);
-        if (speed == 0) emit paused();
-        else emit playing();
-    }
-    void seek(int position) {
-        Controller::seek(position);
-        emit paused();
-    }
-    void pause() {
-        Controller::pause();
-        emit paused();
-    }
+    void play(double speed = 1.0);
+    void seek(int position);
+    void pause();
     int displayWidth() const { return m_rect.width(); }
     int displayHeight() const { return m_rect.height(); }
 
@@ -91,6 +85,7 @@ public slots:
     void setOffsetY(int y);
     void setBlankScene();
     void setCurrentFilter(QmlFilter* filter, QmlMetadata* meta);
+    void resetAudioScrubber();
 
 signals:
     void frameDisplayed(const SharedFrame& frame);
@@ -123,16 +118,53 @@ private:
     int m_vertexLocation;
     int m_texCoordLocation;
     int m_colorspaceLocation;
+    int m_isPackedLocation;
+    int m_textureFormat;
     int m_textureLocation[3];
     float m_zoom;
     QPoint m_offset;
+    int m_cachedPosition; // shown from the frame cache, or -1
+    uint m_cachedRevision;
+    int m_previewScale;
+    QAtomicInt m_frameCount;
+    QAtomicInt m_droppedCount;
+    QTimer m_scrubTimer;
+    int m_scrubTarget;
+    QString m_lastResource;
+    int m_lastFrame;
+    // The key frame sought instead of the target while scrubbing, or -1.
+    QAtomicInt m_keyframePosition;
+    QAtomicInt m_keyframeTarget;
+    QElapsedTimer m_seekTime;
+    int m_seekPosition;
+    int m_presentDelay;
+    qint64 m_vsyncInterval;
+    // The schedule of presenting played frames, used on the consumer thread.
+    QAtomicInt m_isAnchorReset;
+    qint64 m_anchorTime;
+    int m_anchorPosition;
+    double m_anchorSpeed;
+    AudioScrubber* m_audioScrubber;
+    uint m_scrubberRevision;
+
+    int playbackScale() const;
+    int scrubPosition(int position);
+    void updateAudioScrubber(int position);
+
+    void paintStatistics();
+    qint64 presentTime(int position, double speed);
 
     static void on_frame_show(mlt_consumer, void* self, mlt_frame frame);
+    static void on_frame_render(mlt_consumer, void* self, mlt_frame frame);
 
 private slots:
     void initializeGL();
+    void onBehind();
+    void onScrubTimeout();
+    void onFrameDisplayed(const SharedFrame& frame);
+    void onFrameSwapped();
     void resizeGL(int width, int height);
-    void updateTexture(GLuint yName, GLuint uName, GLuint vName);
+    void updateTexture(GLuint yName, GLuint uName, GLuint vName, int format);
     void paintGL();
 
 protected:
@@ -163,25 +195,42 @@ class FrameRenderer : public QThread
 {
     Q_OBJECT
 public:
-    FrameRenderer(QOpenGLContext* shareContext);
+    // Frames skipped for being late are added to the dropped count.
+    FrameRenderer(QOpenGLContext* shareContext, int presentDelay, qint64 vsyncInterval,
+                  QAtomicInt& droppedCount);
     ~FrameRenderer();
     QSemaphore* semaphore() { return &m_semaphore; }
     QOpenGLContext* context() const { return m_context; }
     SharedFrame getDisplayFrame();
-    Q_INVOKABLE void showFrame(Mlt::Frame frame);
+    // The present time is from now(), or 0 to present as soon as possible.
+    Q_INVOKABLE void showFrame(Mlt::Frame frame, qint64 presentTime = 0);
+    // Measures the refresh of the display from when frames are swapped.
+    void addVsync(qint64 time);
+    static qint64 now();
 
 public slots:
     void cleanup();
 
 signals:
-    void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0);
+    void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0,
+                      int format = mlt_image_yuv420p);
     void frameDisplayed(const SharedFrame& frame);
 
 private:
+    void waitForPresentTime(qint64 presentTime);
+
     QSemaphore m_semaphore;
+    int m_queueSize;
+    int m_presentDelay; // in frames
+    QMutex m_vsyncMutex;
+    qint64 m_vsyncInterval; // in microseconds
+    qint64 m_lastVsync;
+    QAtomicInt& m_droppedCount;
     SharedFrame m_frame;
     QOpenGLContext* m_context;
     QOffscreenSurface* m_surface;
+    bool m_isTextureRg; // GL_RG textures need OpenGL 3 or OpenGL ES 3
+    bool m_isTexture16; // GL_R16 textures need OpenGL 3
 public:
     GLuint m_renderTexture[3];
     GLuint m_displayTexture[3];
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "headlessbenchmark.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <Mlt.h>
+#include "mltcontroller.h"
+#include "proxymanager.h"
+#include "settings.h"
+#include "snapshotbenchmark.h"
+#include "threadbenchmark.h"
+
+HeadlessBenchmark::HeadlessBenchmark(QObject* parent)
+    : QObject(parent)
+    , m_isApplied(false)
+    , m_out(stdout)
+    , m_err(stderr)
+{
+}
+
+bool HeadlessBenchmark::isRequested(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!qstrcmp(argv[i], "--benchmark"))
+            return true;
+    }
+    return false;
+}
+
+int HeadlessBenchmark::exec(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Measure the performance of Shotcut without the user interface."));
+    parser.addHelpOption();
+    QCommandLineOption benchmarkOption("benchmark", tr("The benchmark to run: snapshot, threads or proxy."), tr("name"));
+    parser.addOption(benchmarkOption);
+    QCommandLineOption clipsOption("clips", tr("The number of clips in the snapshot benchmark project."),
+                                   tr("count"), "5000");
+    parser.addOption(clipsOption);
+    QCommandLineOption inOption("in", tr("The frame of the project to start measuring the threads at."),
+                                tr("frame"), "0");
+    parser.addOption(inOption);
+    QCommandLineOption applyOption("apply", tr("Use the fastest number of threads for the preview."));
+    parser.addOption(applyOption);
+    parser.addPositionalArgument("project", tr("The project to measure the threads with or the media to check the proxy of."),
+                                 tr("[project]"));
+    parser.process(arguments);
+
+    // The benchmarks run here instead of on the thread pool, so their
+    // signals are delivered as they are emitted.
+    Mlt::Factory::init();
+    QString name = parser.value(benchmarkOption);
+    if (name == "snapshot") {
+        SnapshotBenchmark* benchmark = new SnapshotBenchmark(qMax(1, parser.value(clipsOption).toInt()));
+        connect(benchmark, SIGNAL(progressed(QString)), SLOT(onProgressed(QString)));
+        connect(benchmark, SIGNAL(finished(QString)), SLOT(onFinished(QString)));
+        benchmark->run();
+        return EXIT_SUCCESS;
+    } else if (name == "threads") {
+        if (parser.positionalArguments().count() != 1) {
+            m_err << tr("The threads benchmark requires one project.") << endl;
+            return EXIT_FAILURE;
+        }
+        m_isApplied = parser.isSet(applyOption);
+        return benchmarkThreads(parser.positionalArguments().first(), qMax(0, parser.value(inOption).toInt()));
+    } else if (name == "proxy") {
+        if (parser.positionalArguments().count() != 1) {
+            m_err << tr("The proxy check requires one media file.") << endl;
+            return EXIT_FAILURE;
+        }
+        return checkProxy(parser.positionalArguments().first());
+    }
+    m_err << tr("Unknown benchmark: %1").arg(name) << endl;
+    return EXIT_FAILURE;
+}
+
+int HeadlessBenchmark::benchmarkThreads(const QString& project, int in)
+{
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "xml", project.toUtf8().constData());
+    if (!producer.is_valid()) {
+        m_err << tr("Failed to open %1").arg(project) << endl;
+        return EXIT_FAILURE;
+    }
+    // Measure a few seconds from the given frame.
+    int length = qMin(qRound(profile.fps() * 5), producer.get_length() - in);
+    if (length < 1) {
+        in = 0;
+        length = qMin(qRound(profile.fps() * 5), producer.get_length());
+    }
+    ThreadBenchmark benchmark(profile, Mlt::Controller::XML(profile, producer), in, length);
+    connect(&benchmark, SIGNAL(progressed(QString)), SLOT(onProgressed(QString)));
+    connect(&benchmark, SIGNAL(finished(QString,int,int)), SLOT(onThreadsFinished(QString,int,int)));
+    benchmark.run();
+    return EXIT_SUCCESS;
+}
+
+// Checks that a timeline clip of the media plays from its proxy both when it
+// is added and when its project is loaded, and that saving restores the media.
+int HeadlessBenchmark::checkProxy(const QString& media)
+{
+    QString proxy = ProxyManager::proxyPath(media);
+    if (!Settings.proxyEnabled()) {
+        m_err << tr("Proxies are turned off.") << endl;
+        return EXIT_FAILURE;
+    }
+    if (!QFile::exists(proxy)) {
+        m_err << tr("No proxy is ready for %1").arg(media) << endl;
+        return EXIT_FAILURE;
+    }
+    Mlt::Profile profile;
+    Mlt::Producer clip(profile, media.toUtf8().constData());
+    if (!clip.is_valid()) {
+        m_err << tr("Failed to open %1").arg(media) << endl;
+        return EXIT_FAILURE;
+    }
+    int failures = 0;
+
+    // Adding the clip to the timeline.
+    QScopedPointer<Mlt::Producer> proxied(ProxyManager::proxied(profile, clip));
+    bool isPassed = proxied && QString::fromUtf8(proxied->get("resource")) == proxy;
+    m_out << (isPassed? tr("PASS") : tr("FAIL")) << " " << tr("adding a clip uses the proxy") << endl;
+    failures += isPassed? 0 : 1;
+
+    // Loading a project with the clip on a track.
+    Mlt::Tractor tractor(profile);
+    Mlt::Playlist playlist;
+    playlist.append(clip, 0, qMin(clip.get_length(), 25) - 1);
+    tractor.set_track(playlist, 0);
+    int count = 0;
+    QString xml = ProxyManager::proxyXML(Mlt::Controller::XML(profile, tractor), QString(), count);
+    Mlt::Producer loaded(profile, "xml-string", xml.toUtf8().constData());
+    Mlt::Tractor timeline(loaded);
+    QScopedPointer<Mlt::Producer> track(timeline.is_valid()? timeline.track(0) : 0);
+    QScopedPointer<Mlt::Producer> cut(track? Mlt::Playlist(*track).get_clip(0) : 0);
+    isPassed = count == 1 && cut && QString::fromUtf8(cut->parent().get("resource")) == proxy;
+    m_out << (isPassed? tr("PASS") : tr("FAIL")) << " " << tr("loading a project uses the proxy") << endl;
+    failures += isPassed? 0 : 1;
+
+    // Playing the loaded timeline.
+    QScopedPointer<Mlt::Frame> frame(loaded.is_valid()? loaded.get_frame() : 0);
+    mlt_image_format format = mlt_image_yuv422;
+    int width = profile.width();
+    int height = profile.height();
+    isPassed = frame && frame->get_image(format, width, height);
+    m_out << (isPassed? tr("PASS") : tr("FAIL")) << " " << tr("the timeline plays from the proxy") << endl;
+    failures += isPassed? 0 : 1;
+
+    // Saving the loaded timeline.
+    xml = ProxyManager::originalXML(Mlt::Controller::XML(profile, loaded));
+    isPassed = !xml.contains(QFileInfo(proxy).fileName()) && xml.contains(QFileInfo(media).fileName());
+    m_out << (isPassed? tr("PASS") : tr("FAIL")) << " " << tr("saving restores the media") << endl;
+    failures += isPassed? 0 : 1;
+
+    return failures? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void HeadlessBenchmark::onProgressed(const QString& message)
+{
+    m_err << message << endl;
+}
+
+void HeadlessBenchmark::onFinished(const QString& report)
+{
+    m_out << report;
+    m_out.flush();
+}
+
+void HeadlessBenchmark::onThreadsFinished(const QString& report, int renderThreads, int decodeThreads)
+{
+    m_out << report;
+    m_out << tr("The fastest is %1 render and %2 decoding threads.").arg(renderThreads).arg(decodeThreads) << endl;
+    if (m_isApplied) {
+        Settings.setPlayerRenderThreads(renderThreads);
+        Settings.setPlayerDecodeThreads(decodeThreads);
+        m_out << tr("The preview will use them.") << endl;
+    }
+}
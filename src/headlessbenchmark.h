@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HEADLESSBENCHMARK_H
+#define HEADLESSBENCHMARK_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+
+// Runs a benchmark or check without creating the main window and prints its report:
+//   shotcut --benchmark snapshot [--clips <n>]
+//   shotcut --benchmark threads [--in <frame>] [--apply] <project>
+//   shotcut --benchmark proxy <media>
+class HeadlessBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessBenchmark(QObject* parent = 0);
+    static bool isRequested(int argc, char** argv);
+    int exec(const QStringList& arguments);
+
+private slots:
+    void onProgressed(const QString& message);
+    void onFinished(const QString& report);
+    void onThreadsFinished(const QString& report, int renderThreads, int decodeThreads);
+
+private:
+    int benchmarkThreads(const QString& project, int in);
+    int checkProxy(const QString& media);
+
+    bool m_isApplied;
+    QTextStream m_out;
+    QTextStream m_err;
+};
+
+#endif // HEADLESSBENCHMARK_H
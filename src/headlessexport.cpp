@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "headlessexport.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QDir>
+#include <QDebug>
+#include <Mlt.h>
+#include "mltcontroller.h"
+#include "jobqueue.h"
+#include "jobs/encodejob.h"
+#include "docks/encodedock.h"
+#include "proxymanager.h"
+
+HeadlessExport::HeadlessExport(QObject* parent)
+    : QObject(parent)
+    , m_preset(0)
+    , m_out(stdout)
+    , m_err(stderr)
+    , m_pending(0)
+    , m_failed(0)
+{
+}
+
+HeadlessExport::~HeadlessExport()
+{
+    delete m_preset;
+}
+
+bool HeadlessExport::isRequested(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!qstrcmp(argv[i], "--export"))
+            return true;
+    }
+    return false;
+}
+
+int HeadlessExport::exec(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Export projects without the user interface."));
+    parser.addHelpOption();
+    QCommandLineOption exportOption("export", tr("Export the projects and exit."));
+    parser.addOption(exportOption);
+    QCommandLineOption presetOption("preset", tr("The name of the encode preset."), tr("name"));
+    parser.addOption(presetOption);
+    QCommandLineOption outputOption("output", tr("The output file when exporting one project."), tr("file"));
+    parser.addOption(outputOption);
+    QCommandLineOption dualPassOption("dual-pass", tr("Encode video in two passes."));
+    parser.addOption(dualPassOption);
+    QCommandLineOption jobsOption("jobs", tr("The number of exports to run at once."), tr("count"), "1");
+    parser.addOption(jobsOption);
+    parser.addPositionalArgument("project", tr("The project files to export."), tr("project..."));
+    parser.process(arguments);
+
+    QStringList projects = parser.positionalArguments();
+    if (projects.isEmpty() || !parser.isSet(presetOption)) {
+        m_err << tr("A preset and at least one project are required.") << endl;
+        return EXIT_FAILURE;
+    }
+    if (parser.isSet(outputOption) && projects.count() > 1) {
+        m_err << tr("--output can only be used with one project.") << endl;
+        return EXIT_FAILURE;
+    }
+    Mlt::Factory::init();
+    if (!loadPreset(parser.value(presetOption))) {
+        m_err << tr("Preset not found: %1").arg(parser.value(presetOption)) << endl;
+        return EXIT_FAILURE;
+    }
+    int concurrency = qMax(1, parser.value(jobsOption).toInt());
+    int threads = qMax(1, QThread::idealThreadCount() / concurrency);
+
+    JOBS.setPersistent(false);
+    JOBS.setConcurrency(concurrency);
+    connect(&JOBS, SIGNAL(dataChanged(QModelIndex,QModelIndex)), SLOT(onDataChanged(QModelIndex,QModelIndex)));
+    foreach (QString project, projects) {
+        QString target = parser.value(outputOption);
+        if (target.isEmpty()) {
+            QFileInfo info(project);
+            target = info.absoluteDir().filePath(info.completeBaseName() + "." + m_extension);
+        }
+        if (!addJobs(project, target, parser.isSet(dualPassOption), threads))
+            ++m_failed;
+    }
+    int result = EXIT_FAILURE;
+    if (m_pending > 0)
+        result = QCoreApplication::exec();
+    JOBS.cleanup();
+    return m_failed? EXIT_FAILURE : result;
+}
+
+bool HeadlessExport::loadPreset(const QString& name)
+{
+    // Custom presets are files in the data folder; stock ones come from MLT.
+    Mlt::Properties* preset = 0;
+    QString key;
+    QDir dir(QStandardPaths::standardLocations(QStandardPaths::DataLocation).first());
+    if (dir.cd("presets") && dir.cd("encode") && dir.exists(name)) {
+        preset = new Mlt::Properties;
+        preset->load(dir.absoluteFilePath(name).toLatin1().constData());
+    } else {
+        QString prefix("consumer/avformat/");
+        Mlt::Properties* presets = Mlt::Repository::presets();
+        for (int j = 0; presets && j < presets->count() && !preset; j++) {
+            QString presetKey(presets->get_name(j));
+            if (!presetKey.startsWith(prefix))
+                continue;
+            Mlt::Properties p((mlt_properties) presets->get_data(presetKey.toLatin1().constData()));
+            if (presetKey == name || presetKey.mid(prefix.length()) == name
+                    || QString::fromUtf8(p.get("meta.preset.name")) == name) {
+                preset = new Mlt::Properties((mlt_properties) presets->get_data(presetKey.toLatin1().constData()));
+                key = presetKey;
+            }
+        }
+        delete presets;
+    }
+    if (!preset || !preset->is_valid()) {
+        delete preset;
+        return false;
+    }
+
+    m_preset = new Mlt::Properties;
+    m_extension = preset->get("meta.preset.extension")? QString::fromUtf8(preset->get("meta.preset.extension")) : "mp4";
+    for (int i = 0; i < preset->count(); i++) {
+        QString property(preset->get_name(i));
+        if (!property.startsWith('_') && !property.startsWith("meta.preset."))
+            m_preset->set(preset->get_name(i), preset->get(i));
+    }
+    delete preset;
+
+    // A stock preset in a profile folder also sets the video format.
+    QStringList textParts = key.split('/');
+    if (textParts.count() > 3) {
+        Mlt::Properties* profiles = Mlt::Profile::list();
+        if (profiles && profiles->get_data(textParts.at(2).toLatin1().constData())) {
+            Mlt::Profile p(textParts.at(2).toLatin1().constData());
+            m_preset->set("width", p.width());
+            m_preset->set("height", p.height());
+            m_preset->set("aspect", p.dar());
+            m_preset->set("progressive", p.progressive());
+            m_preset->set("frame_rate_num", p.frame_rate_num());
+            m_preset->set("frame_rate_den", p.frame_rate_den());
+        }
+        delete profiles;
+    }
+    return true;
+}
+
+bool HeadlessExport::addJobs(const QString& project, const QString& target, bool isDualPass, int threads)
+{
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "xml", project.toUtf8().constData());
+    if (!producer.is_valid()) {
+        m_err << tr("Failed to open %1").arg(project) << endl;
+        return false;
+    }
+    QString xml = ProxyManager::originalXML(Mlt::Controller::XML(profile, producer, QDir::tempPath()));
+
+    QList<AbstractJob*> jobs;
+    int pass = isDualPass? 1 : 0;
+    do {
+        Mlt::Properties consumer;
+        consumer.inherit(*m_preset);
+        consumer.set("mlt_service", "avformat");
+        consumer.set("target", target.toUtf8().constData());
+        consumer.set("real_time", -threads);
+        if (!consumer.get("f") && !consumer.get("acodec") &&
+                (target.endsWith(".mp4") || target.endsWith(".mov")))
+            consumer.set("strict", "experimental");
+        EncodeDock::setPassProperties(consumer, target, pass);
+
+        QTemporaryFile tmp(QDir::tempPath().append("/shotcut-XXXXXX"));
+        tmp.open();
+        QString tmpName = tmp.fileName();
+        tmp.close();
+        tmpName.append(".mlt");
+        EncodeJob* job = new EncodeJob(target, tmpName);
+        if (!Mlt::Controller::writeXML(tmpName, xml, &consumer)) {
+            m_err << tr("Failed to write %1").arg(tmpName) << endl;
+            delete job;
+            qDeleteAll(jobs);
+            return false;
+        }
+        if (!jobs.isEmpty())
+            job->addDependency(jobs.last());
+        jobs << job;
+    } while (pass && ++pass <= 2);
+
+    foreach (AbstractJob* job, jobs) {
+        connect(job, SIGNAL(finished(AbstractJob*,bool)), SLOT(onFinished(AbstractJob*,bool)));
+        ++m_pending;
+        JOBS.add(job);
+    }
+    return true;
+}
+
+void HeadlessExport::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight)
+{
+    // Print the status column when it changes.
+    for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+        QString status = JOBS.index(row, 1).data().toString();
+        if (m_status.value(row) != status) {
+            m_status[row] = status;
+            m_out << JOBS.index(row, 0).data().toString() << ": " << status << endl;
+        }
+    }
+}
+
+void HeadlessExport::onFinished(AbstractJob* job, bool isSuccess)
+{
+    if (!isSuccess) {
+        ++m_failed;
+        m_err << job->log();
+        m_err.flush();
+    }
+    // Jobs blocked by a failed dependency never finish.
+    if (--m_pending == 0 || !JOBS.hasIncomplete())
+        QCoreApplication::exit(m_failed? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HEADLESSEXPORT_H
+#define HEADLESSEXPORT_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QModelIndex>
+#include <QHash>
+
+class AbstractJob;
+namespace Mlt {
+    class Properties;
+}
+
+// Exports projects through the job queue without creating the main window:
+//   shotcut --export --preset <name> [--output <file>] [--dual-pass] [--jobs <n>] <project>...
+class HeadlessExport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessExport(QObject* parent = 0);
+    ~HeadlessExport();
+    static bool isRequested(int argc, char** argv);
+    int exec(const QStringList& arguments);
+
+private slots:
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+    void onFinished(AbstractJob* job, bool isSuccess);
+
+private:
+    bool loadPreset(const QString& name);
+    bool addJobs(const QString& project, const QString& target, bool isDualPass, int threads);
+
+    Mlt::Properties* m_preset;
+    QString m_extension;
+    QTextStream m_out;
+    QTextStream m_err;
+    QHash<int, QString> m_status;
+    int m_pending;
+    int m_failed;
+};
+
+#endif // HEADLESSEXPORT_H
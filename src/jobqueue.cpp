@@ -19,13 +19,28 @@
 #include "jobqueue.h"
 #include <QtWidgets>
 #include <QDebug>
+#include <QJsonDocument>
+#include <QJsonArray>
 #include "mainwindow.h"
 #include "settings.h"
+#include "jobs/encodejob.h"
+#include "jobs/smartrenderjob.h"
+#include "jobs/videoqualityjob.h"
+#include "jobs/proxyjob.h"
+
+static QString savedQueuePath()
+{
+    QDir dir(QStandardPaths::standardLocations(QStandardPaths::DataLocation).first());
+    return dir.filePath("jobs.json");
+}
 
 JobQueue::JobQueue(QObject *parent) :
     QStandardItemModel(0, COLUMN_COUNT, parent),
-    m_paused(false)
+    m_paused(false),
+    m_concurrency(0),
+    m_isPersistent(true)
 {
+    qRegisterMetaType<AbstractJob*>("AbstractJob*");
 }
 
 JobQueue& JobQueue::singleton(QObject* parent)
@@ -40,6 +55,9 @@ void JobQueue::cleanup()
 {
     QMutexLocker locker(&m_mutex);
     qDeleteAll(m_jobs);
+    // The user chose to exit, and the jobs' files are gone now.
+    if (m_isPersistent)
+        QFile::remove(savedQueuePath());
 }
 
 AbstractJob* JobQueue::add(AbstractJob* job)
@@ -52,6 +70,7 @@ AbstractJob* JobQueue::add(AbstractJob* job)
     job->setParent(this);
     job->setModelIndex(index(row, COLUMN_STATUS));
     connect(job, SIGNAL(messageAvailable(AbstractJob*)), this, SLOT(onMessageAvailable(AbstractJob*)));
+    connect(job, SIGNAL(progressUpdated(AbstractJob*, uint)), this, SLOT(onProgressUpdated(AbstractJob*, uint)));
     connect(job, SIGNAL(finished(AbstractJob*, bool)), this, SLOT(onFinished(AbstractJob*, bool)));
     m_mutex.lock();
     m_jobs.append(job);
@@ -67,17 +86,21 @@ void JobQueue::onMessageAvailable(AbstractJob* job)
     QString msg = job->readLine();
 //    qDebug() << msg;
     if (msg.contains("percentage:")) {
-        QStandardItem* item = itemFromIndex(job->modelIndex());
-        if (item) {
-            uint percent = msg.mid(msg.indexOf("percentage:") + 11).toUInt();
-            item->setText(QString("%1%").arg(percent));
-        }
+        uint percent = msg.mid(msg.indexOf("percentage:") + 11).toUInt();
+        onProgressUpdated(job, job->jobPercent(percent));
     }
     else {
         job->appendToLog(msg);
     }
 }
 
+void JobQueue::onProgressUpdated(AbstractJob* job, uint percent)
+{
+    QStandardItem* item = itemFromIndex(job->modelIndex());
+    if (item)
+        item->setText(QString("%1%").arg(percent));
+}
+
 void JobQueue::onFinished(AbstractJob* job, bool isSuccess)
 {
     QStandardItem* item = itemFromIndex(job->modelIndex());
@@ -89,25 +112,161 @@ void JobQueue::onFinished(AbstractJob* job, bool isSuccess)
         else
             item->setText(tr("failed"));
     }
+    if (!isSuccess) {
+        m_mutex.lock();
+        foreach (AbstractJob* other, m_jobs) {
+            if (!other->ran() && other->isBlocked()) {
+                item = itemFromIndex(other->modelIndex());
+                if (item)
+                    item->setText(tr("blocked"));
+            }
+        }
+        m_mutex.unlock();
+    }
     startNextJob();
 }
 
 void JobQueue::startNextJob()
 {
-    if (m_paused) return;
     QMutexLocker locker(&m_mutex);
-    if (!m_jobs.isEmpty()) {
-        foreach(AbstractJob* job, m_jobs) {
-            // if there is already a job started or running, then exit
+    if (!m_paused && !m_jobs.isEmpty()) {
+        // Start jobs whose dependencies are done, in order, up to the limit.
+        int limit = qMax(1, m_concurrency? m_concurrency : Settings.jobsConcurrency());
+        int running = 0;
+        foreach (AbstractJob* job, m_jobs) {
             if (job->ran() && job->state() != QProcess::NotRunning)
+                ++running;
+        }
+        foreach (AbstractJob* job, m_jobs) {
+            if (running >= limit)
                 break;
-            // otherwise, start first non-started job and exit
-            if (!job->ran()) {
+            if (!job->ran() && job->isReady()) {
                 job->start();
-                break;
+                ++running;
             }
         }
     }
+    save();
+}
+
+void JobQueue::save()
+{
+    // Save the jobs that are not finished. Dependencies are stored as indices
+    // into the saved list; those that are already done are left out.
+    if (!m_isPersistent)
+        return;
+    QList<AbstractJob*> saved;
+    foreach (AbstractJob* job, m_jobs) {
+        bool isIncomplete = !job->ran() || job->state() != QProcess::NotRunning;
+        if (isIncomplete && !job->type().isEmpty() && !job->isBlocked())
+            saved << job;
+    }
+    QString path = savedQueuePath();
+    if (saved.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+    QJsonArray jobs;
+    foreach (AbstractJob* job, saved) {
+        QJsonObject json;
+        job->save(json);
+        json["state"] = job->ran()? "running" : "pending";
+        QJsonArray dependencies;
+        foreach (AbstractJob* dependency, job->dependencies()) {
+            if (saved.contains(dependency))
+                dependencies.append(saved.indexOf(dependency));
+        }
+        json["dependencies"] = dependencies;
+        jobs.append(json);
+    }
+    QJsonObject root;
+    root["version"] = 1;
+    root["jobs"] = jobs;
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile f(path);
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(root).toJson());
+        if (!f.commit())
+            qWarning() << "failed to save jobs" << path;
+    }
+}
+
+static MeltJob* createJob(const QJsonObject& json)
+{
+    QString type = json["type"].toString();
+    QString name = json["name"].toString();
+    QString xml = json["xml"].toString();
+    MeltJob* job = 0;
+    if (!QFile::exists(xml))
+        return 0;
+    if (type == "encode")
+        job = new EncodeJob(name, xml);
+    else if (type == "smartrender")
+        job = SmartRenderJob::fromJson(json);
+    else if (type == "vqm")
+        job = new VideoQualityJob(name, xml, json["output"].toString());
+    else if (type == "proxy")
+        job = new ProxyJob(name, xml);
+    if (job) {
+        job->setLabel(json["label"].toString());
+        foreach (QJsonValue value, json["tempFiles"].toArray())
+            job->addTempFile(value.toString());
+    }
+    return job;
+}
+
+bool JobQueue::hasSaved() const
+{
+    return m_isPersistent && QFile::exists(savedQueuePath());
+}
+
+void JobQueue::restore(bool resume)
+{
+    QFile f(savedQueuePath());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+    QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+    f.close();
+    f.remove();
+
+    QList<MeltJob*> jobs;
+    foreach (QJsonValue value, doc.object()["jobs"].toArray()) {
+        QJsonObject json = value.toObject();
+        MeltJob* job = resume? createJob(json) : 0;
+        if (job) {
+            foreach (QJsonValue index, json["dependencies"].toArray()) {
+                MeltJob* dependency = jobs.value(index.toInt());
+                if (dependency) {
+                    job->addDependency(dependency);
+                } else {
+                    // A job this one needs could not be restored.
+                    delete job;
+                    job = 0;
+                    break;
+                }
+            }
+        }
+        if (!job) {
+            qWarning() << "discarding job" << json["label"].toString();
+            QFile::remove(json["xml"].toString());
+            foreach (QJsonValue path, json["tempFiles"].toArray())
+                QFile::remove(path.toString());
+        } else if (json["state"].toString() == "running") {
+            // The previous session ended while this job was writing its output,
+            // so whatever it left is incomplete.
+            QString output = json["output"].toString();
+            if (!output.isEmpty() && QFile::exists(output)) {
+                qDebug() << "removing partial output" << output;
+                QFile::remove(output);
+                job->appendToLog(tr("Removed the partial output of the previous session: %1\n").arg(output));
+            }
+        }
+        jobs << job;
+    }
+    foreach (MeltJob* job, jobs) {
+        if (job)
+            add(job);
+    }
 }
 
 AbstractJob* JobQueue::jobFromIndex(const QModelIndex& index) const
@@ -131,10 +290,23 @@ bool JobQueue::isPaused() const
     return m_paused;
 }
 
+void JobQueue::setConcurrency(int count)
+{
+    m_concurrency = count;
+    startNextJob();
+}
+
+// A queue that is not persistent leaves the saved queue of the application
+// alone, such as when exporting from the command line.
+void JobQueue::setPersistent(bool isPersistent)
+{
+    m_isPersistent = isPersistent;
+}
+
 bool JobQueue::hasIncomplete() const
 {
     foreach (AbstractJob* job, m_jobs) {
-        if (!job->ran() || job->state() == QProcess::Running)
+        if ((!job->ran() && !job->isBlocked()) || job->state() == QProcess::Running)
             return true;
     }
     return false;
@@ -34,28 +34,36 @@ protected:
     };
     JobQueue(QObject *parent);
     void startNextJob();
+    void save();
 
 public:
     static JobQueue& singleton(QObject* parent = 0);
     void cleanup();
-    AbstractJob* add(AbstractJob *job);
+    Q_INVOKABLE AbstractJob* add(AbstractJob *job);
     AbstractJob* jobFromIndex(const QModelIndex& index) const;
     void pause();
     void resume();
     bool isPaused() const;
+    void setConcurrency(int count);
+    void setPersistent(bool isPersistent);
     bool hasIncomplete() const;
+    bool hasSaved() const;
+    void restore(bool resume);
 
 signals:
     void jobAdded();
 
 public slots:
     void onMessageAvailable(AbstractJob* job);
+    void onProgressUpdated(AbstractJob* job, uint percent);
     void onFinished(AbstractJob* job, bool isSuccess);
 
 private:
     QList<AbstractJob*> m_jobs;
     QMutex m_mutex; // protects m_jobs
     bool m_paused;
+    int m_concurrency; // 0 to use the setting
+    bool m_isPersistent;
 };
 
 #define JOBS JobQueue::singleton()
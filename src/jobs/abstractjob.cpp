@@ -25,6 +25,7 @@ AbstractJob::AbstractJob(const QString& name)
     : QProcess(0)
     , m_ran(false)
     , m_killed(false)
+    , m_succeeded(false)
     , m_label(name)
 {
     setObjectName(name);
@@ -35,6 +36,7 @@ AbstractJob::AbstractJob(const QString& name)
 void AbstractJob::start()
 {
     m_ran = true;
+    m_succeeded = false;
 }
 
 void AbstractJob::setModelIndex(const QModelIndex& index)
@@ -72,6 +74,44 @@ void AbstractJob::setLabel(const QString &label)
     m_label = label;
 }
 
+void AbstractJob::addDependency(AbstractJob* job)
+{
+    if (job && job != this && !m_dependencies.contains(job))
+        m_dependencies << job;
+}
+
+bool AbstractJob::succeeded() const
+{
+    return m_ran && state() == QProcess::NotRunning && m_succeeded;
+}
+
+bool AbstractJob::isReady() const
+{
+    foreach (AbstractJob* job, m_dependencies) {
+        if (!job->succeeded())
+            return false;
+    }
+    return true;
+}
+
+bool AbstractJob::isBlocked() const
+{
+    // A dependency that finished without success never will.
+    foreach (AbstractJob* job, m_dependencies) {
+        if ((job->ran() && job->state() == QProcess::NotRunning && !job->succeeded())
+                || job->isBlocked())
+            return true;
+    }
+    return false;
+}
+
+void AbstractJob::save(QJsonObject& json) const
+{
+    json["type"] = type();
+    json["name"] = objectName();
+    json["label"] = m_label;
+}
+
 void AbstractJob::stop()
 {
     terminate();
@@ -83,6 +123,7 @@ void AbstractJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
     if (exitStatus == QProcess::NormalExit && exitCode == 0) {
         qDebug() << "job succeeeded";
+        m_succeeded = true;
         emit finished(this, true);
     } else {
         qDebug() << "job failed with" << exitCode;
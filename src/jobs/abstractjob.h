@@ -22,6 +22,7 @@
 #include <QProcess>
 #include <QModelIndex>
 #include <QList>
+#include <QJsonObject>
 
 class QAction;
 
@@ -41,6 +42,16 @@ public:
     void setLabel(const QString& label);
     QList<QAction*> standardActions() const { return m_standardActions; }
     QList<QAction*> successActions() const { return m_successActions; }
+    void addDependency(AbstractJob* job);
+    QList<AbstractJob*> dependencies() const { return m_dependencies; }
+    bool succeeded() const;
+    bool isReady() const;
+    bool isBlocked() const;
+    // Jobs that return a type are saved with the queue to resume after a crash.
+    virtual QString type() const { return QString(); }
+    virtual void save(QJsonObject& json) const;
+    // Maps the percentage the running program reports to that of the job.
+    virtual uint jobPercent(uint percent) const { return percent; }
 
 public slots:
     virtual void start();
@@ -49,21 +60,24 @@ public slots:
 signals:
     void messageAvailable(AbstractJob* job);
     void finished(AbstractJob* job, bool isSuccess);
+    void progressUpdated(AbstractJob* job, uint percent);
 
 protected:
     QList<QAction*> m_standardActions;
     QList<QAction*> m_successActions;
 
 protected slots:
-    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    virtual void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onReadyRead();
 
 private:
     QModelIndex m_index;
     bool m_ran;
     bool m_killed;
+    bool m_succeeded;
     QString m_log;
     QString m_label;
+    QList<AbstractJob*> m_dependencies;
 };
 
 #endif // ABSTRACTJOB_H
@@ -24,8 +24,7 @@
 #include <QFileDialog>
 #include <QTemporaryFile>
 #include <QDir>
-#include <QDomDocument>
-#include <QTextStream>
+#include <QThreadPool>
 #include "mainwindow.h"
 #include "settings.h"
 #include "jobqueue.h"
@@ -61,6 +60,12 @@ void EncodeJob::onShowFolderTriggered()
     QDesktopServices::openUrl(url);
 }
 
+void EncodeJob::save(QJsonObject& json) const
+{
+    MeltJob::save(json);
+    json["output"] = objectName();
+}
+
 void EncodeJob::onVideoQualityTriggered()
 {
     // Get the location and file name for the report.
@@ -89,33 +94,16 @@ void EncodeJob::onVideoQualityTriggered()
             tractor.set_track(encoded, 1);
             tractor.plant_transition(vqm);
             vqm.set("render", 0);
-            MLT.saveXML(tmpName, &tractor);
-
-            // Add consumer element to XML.
-            QFile f1(tmpName);
-            f1.open(QIODevice::ReadOnly);
-            QDomDocument dom(tmpName);
-            dom.setContent(&f1);
-            f1.close();
-
-            QDomElement consumerNode = dom.createElement("consumer");
-            QDomNodeList profiles = dom.elementsByTagName("profile");
-            if (profiles.isEmpty())
-                dom.documentElement().insertAfter(consumerNode, dom.documentElement());
-            else
-                dom.documentElement().insertAfter(consumerNode, profiles.at(profiles.length() - 1));
-            consumerNode.setAttribute("mlt_service", "null");
-            consumerNode.setAttribute("real_time", -1);
-            consumerNode.setAttribute("terminate_on_pause", 1);
-
-            // Save the new XML.
-            f1.open(QIODevice::WriteOnly);
-            QTextStream ts(&f1);
-            dom.save(ts, 2);
-            f1.close();
+            QString xml = MLT.XML(&tractor, QDir::tempPath());
 
-            // Create job and add it to the queue.
-            JOBS.add(new VideoQualityJob(objectName(), tmpName, reportPath));
+            // Write the XML with a consumer element and add the job to the queue.
+            Mlt::Properties* consumer = new Mlt::Properties;
+            consumer->set("mlt_service", "null");
+            consumer->set("real_time", -1);
+            consumer->set("terminate_on_pause", 1);
+            MeltXmlTask* task = new MeltXmlTask;
+            task->add(new VideoQualityJob(objectName(), tmpName, reportPath), xml, consumer);
+            QThreadPool::globalInstance()->start(task);
         }
     }
 }
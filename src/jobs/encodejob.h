@@ -25,6 +25,8 @@ class EncodeJob : public MeltJob
 {
 public:
     EncodeJob(const QString& name, const QString& xml);
+    QString type() const { return "encode"; }
+    void save(QJsonObject& json) const;
 
 private slots:
     void onOpenTiggered();
@@ -24,8 +24,12 @@
 #include <QApplication>
 #include <QAction>
 #include <QDialog>
+#include <QJsonArray>
 #include <QDebug>
 #include "mainwindow.h"
+#include "mltcontroller.h"
+#include "jobqueue.h"
+#include "proxymanager.h"
 #include "dialogs/textviewerdialog.h"
 
 MeltJob::MeltJob(const QString& name, const QString& xml)
@@ -42,6 +46,8 @@ MeltJob::~MeltJob()
 {
     qDebug();
     QFile::remove(m_xml);
+    foreach (QString path, m_tempFiles)
+        QFile::remove(path);
 }
 
 void MeltJob::start()
@@ -66,6 +72,24 @@ void MeltJob::start()
     AbstractJob::start();
 }
 
+void MeltJob::save(QJsonObject& json) const
+{
+    AbstractJob::save(json);
+    json["xml"] = m_xml;
+    json["tempFiles"] = QJsonArray::fromStringList(m_tempFiles);
+}
+
+void MeltJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    // Keep them after a failure to run it again; they go with the job.
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        foreach (QString path, m_tempFiles)
+            QFile::remove(path);
+        m_tempFiles.clear();
+    }
+    AbstractJob::onFinished(exitCode, exitStatus);
+}
+
 QString MeltJob::xml() const
 {
     QFile f(m_xml);
@@ -82,3 +106,32 @@ void MeltJob::onViewXmlTriggered()
     dialog.setText(xml());
     dialog.exec();
 }
+
+MeltXmlTask::~MeltXmlTask()
+{
+    qDeleteAll(m_consumers);
+}
+
+void MeltXmlTask::add(MeltJob* job, const QString& xml, Mlt::Properties* consumer)
+{
+    m_jobs << job;
+    m_xml << xml;
+    m_consumers << consumer;
+}
+
+void MeltXmlTask::run()
+{
+    for (int i = 0; i < m_jobs.count(); i++) {
+        MeltJob* job = m_jobs.at(i);
+        // Jobs always use the original media instead of proxies.
+        QString xml = ProxyManager::originalXML(m_xml.at(i));
+        if (Mlt::Controller::writeXML(job->xmlPath(), xml, m_consumers.at(i))) {
+            QMetaObject::invokeMethod(&JOBS, "add", Qt::QueuedConnection, Q_ARG(AbstractJob*, job));
+        } else {
+            // The jobs that follow may depend on this one.
+            for (int j = i; j < m_jobs.count(); j++)
+                m_jobs.at(j)->deleteLater();
+            break;
+        }
+    }
+}
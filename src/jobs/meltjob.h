@@ -20,6 +20,12 @@
 #define MELTJOB_H
 
 #include "abstractjob.h"
+#include <QStringList>
+#include <QRunnable>
+
+namespace Mlt {
+    class Properties;
+}
 
 class MeltJob : public AbstractJob
 {
@@ -29,13 +35,34 @@ public:
     void start();
     QString xml() const;
     QString xmlPath() const { return m_xml; }
+    void addTempFile(const QString& path) { m_tempFiles << path; }
+    void save(QJsonObject& json) const;
 
 public slots:
     void onViewXmlTriggered();
 
+protected:
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
 private:
     QString m_xml;
+    QStringList m_tempFiles;
+
+};
 
+// Writes the XML for jobs in the background and adds them to the job
+// queue, in order, once their XML is on disk.
+class MeltXmlTask : public QRunnable
+{
+public:
+    ~MeltXmlTask();
+    void add(MeltJob* job, const QString& xml, Mlt::Properties* consumer);
+    void run();
+
+private:
+    QList<MeltJob*> m_jobs;
+    QStringList m_xml;
+    QList<Mlt::Properties*> m_consumers;
 };
 
 #endif // MELTJOB_H
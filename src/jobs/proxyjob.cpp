@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "proxyjob.h"
+#include <QFile>
+#include <QDebug>
+
+ProxyJob::ProxyJob(const QString& name, const QString& xml)
+    : MeltJob(name, xml)
+{
+}
+
+void ProxyJob::save(QJsonObject& json) const
+{
+    MeltJob::save(json);
+    json["output"] = partialPath();
+}
+
+QString ProxyJob::partialPath() const
+{
+    return objectName() + ".part";
+}
+
+void ProxyJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        QFile::remove(objectName());
+        if (!QFile::rename(partialPath(), objectName())) {
+            qWarning() << "failed to move the proxy into place" << objectName();
+            exitCode = 1;
+        }
+    } else {
+        QFile::remove(partialPath());
+    }
+    MeltJob::onFinished(exitCode, exitStatus);
+}
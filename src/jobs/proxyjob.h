@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROXYJOB_H
+#define PROXYJOB_H
+
+#include "meltjob.h"
+
+// Renders a proxy to a partial file and moves it into place when done, so
+// that a proxy that exists is always complete.
+class ProxyJob : public MeltJob
+{
+public:
+    ProxyJob(const QString& name, const QString& xml);
+    QString type() const { return "proxy"; }
+    void save(QJsonObject& json) const;
+    QString partialPath() const;
+
+protected:
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+};
+
+#endif // PROXYJOB_H
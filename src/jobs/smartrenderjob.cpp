@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "smartrenderjob.h"
+#include <QApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDomDocument>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QDebug>
+#include "mainwindow.h"
+#include "mltcontroller.h"
+#include "seekindex.h"
+
+// The parameters of a video stream that must match for copied and encoded
+// pieces to join: the bitstream, its profile and level, and the frames.
+static const char* kStreamEntries = "codec_name,profile,level,pix_fmt,field_order,width,height,has_b_frames,refs";
+// The shares of the job's progress that probing and joining take, and how
+// much more encoding a frame takes than copying it.
+static const int kProbePercent = 5;
+static const int kConcatPercent = 5;
+static const int kEncodeWeight = 20;
+
+SmartRenderJob::SmartRenderJob(const QString& name, const QString& xml, int length,
+                               const QList<Segment>& candidates, bool hasAudio)
+    : EncodeJob(name, xml)
+    , m_length(length)
+    , m_hasAudio(hasAudio)
+    , m_fps(MLT.profile().fps())
+    , m_state(ProbeState)
+    , m_step(0)
+    , m_candidates(candidates)
+    , m_reference(-1)
+    , m_isChecked(false)
+    , m_doneWeight(0)
+    , m_totalWeight(0)
+    , m_tempDir(QFileInfo(name).absolutePath() + "/.shotcut-XXXXXX")
+    , m_copiedFrames(0)
+    , m_encodedFrames(0)
+{
+    setLabel(tr("%1 (smart)").arg(name));
+}
+
+SmartRenderJob* SmartRenderJob::fromJson(const QJsonObject& json)
+{
+    QList<Segment> candidates;
+    foreach (QJsonValue value, json["segments"].toArray()) {
+        QJsonObject o = value.toObject();
+        Segment segment;
+        segment.start = o["start"].toInt();
+        segment.length = o["length"].toInt();
+        segment.resource = o["resource"].toString();
+        segment.in = o["in"].toInt();
+        segment.videoIndex = o["videoIndex"].toInt(-1);
+        segment.audioIndex = o["audioIndex"].toInt(-1);
+        candidates << segment;
+    }
+    return new SmartRenderJob(json["name"].toString(), json["xml"].toString(),
+                              json["length"].toInt(), candidates, json["hasAudio"].toBool());
+}
+
+void SmartRenderJob::save(QJsonObject& json) const
+{
+    EncodeJob::save(json);
+    QJsonArray segments;
+    foreach (Segment segment, m_candidates) {
+        QJsonObject o;
+        o["start"] = segment.start;
+        o["length"] = segment.length;
+        o["resource"] = segment.resource;
+        o["in"] = segment.in;
+        o["videoIndex"] = segment.videoIndex;
+        o["audioIndex"] = segment.audioIndex;
+        segments.append(o);
+    }
+    json["segments"] = segments;
+    json["length"] = m_length;
+    json["hasAudio"] = m_hasAudio;
+}
+
+void SmartRenderJob::start()
+{
+    AbstractJob::start();
+    setReadChannel(QProcess::StandardError);
+    m_state = ProbeState;
+    m_step = 0;
+    m_copies.clear();
+    m_segments.clear();
+    m_parameters.clear();
+    m_reference = -1;
+    m_isChecked = false;
+    m_doneWeight = 0;
+    m_totalWeight = 0;
+    m_copiedFrames = 0;
+    m_encodedFrames = 0;
+    if (m_candidates.isEmpty() || !m_tempDir.isValid()) {
+        // Nothing to copy; fall back to a normal encode.
+        m_state = ConcatState;
+        m_encodedFrames = m_length;
+        MeltJob::start();
+    } else {
+        probe(m_candidates.first());
+    }
+}
+
+void SmartRenderJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (exitStatus != QProcess::NormalExit || exitCode != 0 || stopped()) {
+        MeltJob::onFinished(exitCode, exitStatus);
+        return;
+    }
+    switch (m_state) {
+    case ProbeState:
+        addCopySegment(m_candidates.at(m_step), readKeyframes(m_candidates.at(m_step)));
+        if (++m_step < m_candidates.count()) {
+            probe(m_candidates.at(m_step));
+            return;
+        }
+        buildSegments();
+        if (m_copies.isEmpty()) {
+            // No whole GOPs fit inside the candidates.
+            m_segments.clear();
+            m_state = ConcatState;
+            setStandardOutputFile(QProcess::nullDevice());
+            MeltJob::start();
+            return;
+        }
+        m_state = RenderState;
+        for (int i = 0; i < m_segments.count() && m_reference < 0; i++) {
+            if (m_segments.at(i).resource.isEmpty())
+                m_reference = i;
+        }
+        if (m_reference >= 0) {
+            // Encode a piece first to learn what the export makes.
+            m_step = m_reference;
+            renderSegment(m_step);
+        } else {
+            // Everything is copied, so the copies need only match each other.
+            applyReference(m_parameters.value(m_copies.first().resource));
+            m_step = -1;
+            renderNext();
+        }
+        return;
+    case RenderState:
+        m_doneWeight += weight(m_segments.at(m_step));
+        if (m_step == m_reference && !m_isChecked) {
+            m_state = CheckState;
+            check(m_step);
+        } else {
+            renderNext();
+        }
+        return;
+    case CheckState: {
+        QFile f(m_tempDir.path() + "/probe.txt");
+        QString parameters;
+        if (f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            parameters = readParameters(f);
+            f.close();
+        }
+        applyReference(parameters);
+        m_isChecked = true;
+        m_state = RenderState;
+        m_step = -1;
+        renderNext();
+        return;
+    }
+    case ConcatState:
+        break;
+    }
+    QString msg = tr("Smart render: %1 frames copied, %2 frames encoded")
+            .arg(m_copiedFrames).arg(m_encodedFrames);
+    qDebug() << msg;
+    appendToLog(msg + '\n');
+    MAIN.showStatusMessage(msg);
+    MeltJob::onFinished(exitCode, exitStatus);
+}
+
+void SmartRenderJob::startProgram(const QString& program, QStringList args)
+{
+    QString shotcutPath = qApp->applicationDirPath();
+#ifdef Q_OS_WIN
+    QFileInfo path(shotcutPath, program + ".exe");
+#else
+    QFileInfo path(shotcutPath, program);
+#endif
+    qDebug() << path.absoluteFilePath() << args;
+#ifdef Q_OS_WIN
+    QProcess::start(path.absoluteFilePath(), args);
+#else
+    args.prepend(path.absoluteFilePath());
+    QProcess::start("/usr/bin/nice", args);
+#endif
+}
+
+uint SmartRenderJob::jobPercent(uint percent) const
+{
+    switch (m_state) {
+    case ProbeState:
+        return (m_step * 100 + percent) * kProbePercent / (100 * qMax(1, m_candidates.count()));
+    case RenderState:
+    case CheckState: {
+        qint64 done = m_doneWeight;
+        if (m_state == RenderState && m_step >= 0 && m_step < m_segments.count())
+            done += weight(m_segments.at(m_step)) * qint64(percent) / 100;
+        return kProbePercent + done * (100 - kProbePercent - kConcatPercent) / qMax(1, m_totalWeight);
+    }
+    case ConcatState:
+        // Without segments it is a normal encode.
+        if (m_segments.isEmpty())
+            return percent;
+        return 100 - kConcatPercent + percent * kConcatPercent / 100;
+    }
+    return percent;
+}
+
+void SmartRenderJob::probe(const Segment& candidate)
+{
+    emit progressUpdated(this, jobPercent(0));
+    setStandardOutputFile(m_tempDir.path() + "/probe.txt");
+    startProgram("ffprobe", SeekIndex::probeArguments(candidate.resource, candidate.videoIndex,
+                                                      QString(kStreamEntries)));
+}
+
+QList<int> SmartRenderJob::readKeyframes(const Segment& candidate)
+{
+    QList<int> result;
+    QVector<double> times;
+    QFile f(m_tempDir.path() + "/probe.txt");
+    if (f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        times = SeekIndex::readKeyframes(f);
+        f.seek(0);
+        m_parameters[candidate.resource] = readParameters(f);
+        f.close();
+    }
+    // Convert to frames relative to the start of the segment.
+    foreach (double t, times) {
+        int frame = qRound(t * m_fps) - candidate.in;
+        if (frame >= 0 && frame <= candidate.length && !result.contains(frame))
+            result << frame;
+    }
+    return result;
+}
+
+QString SmartRenderJob::readParameters(QIODevice& device)
+{
+    QStringList names = QString(kStreamEntries).split(',');
+    QStringList result;
+    while (!device.atEnd()) {
+        QString line = QString::fromUtf8(device.readLine()).trimmed();
+        int i = line.indexOf('=');
+        if (i > 0 && names.contains(line.left(i)))
+            result << line;
+    }
+    result.sort();
+    return result.join(' ');
+}
+
+void SmartRenderJob::addCopySegment(const Segment& candidate, const QList<int>& keyframes)
+{
+    // Only copy whole GOPs: from the first key frame to the last one.
+    // The partial GOPs at each end are left for the encoder.
+    if (keyframes.count() < 2)
+        return;
+    Segment copy = candidate;
+    copy.start = candidate.start + keyframes.first();
+    copy.in = candidate.in + keyframes.first();
+    copy.length = keyframes.last() - keyframes.first();
+    m_copies << copy;
+}
+
+void SmartRenderJob::buildSegments()
+{
+    int position = 0;
+    foreach (Segment copy, m_copies) {
+        if (copy.start > position) {
+            Segment encode;
+            encode.start = position;
+            encode.length = copy.start - position;
+            encode.in = position;
+            m_segments << encode;
+            m_encodedFrames += encode.length;
+        }
+        m_segments << copy;
+        m_copiedFrames += copy.length;
+        position = copy.start + copy.length;
+    }
+    if (position < m_length) {
+        Segment encode;
+        encode.start = position;
+        encode.length = m_length - position;
+        encode.in = position;
+        m_segments << encode;
+        m_encodedFrames += encode.length;
+    }
+    foreach (Segment segment, m_segments)
+        m_totalWeight += weight(segment);
+}
+
+void SmartRenderJob::check(int index)
+{
+    setStandardOutputFile(m_tempDir.path() + "/probe.txt");
+    QStringList args;
+    args << "-v" << "error";
+    args << "-select_streams" << "v:0";
+    args << "-show_entries" << QString("stream=%1").arg(kStreamEntries);
+    args << "-of" << "default=nw=1";
+    args << segmentFileName(index);
+    startProgram("ffprobe", args);
+}
+
+void SmartRenderJob::applyReference(const QString& parameters)
+{
+    // Encode the copies that would not join the other pieces.
+    for (int i = 0; i < m_segments.count(); i++) {
+        Segment& segment = m_segments[i];
+        if (segment.resource.isEmpty())
+            continue;
+        QString source = m_parameters.value(segment.resource);
+        if (source.isEmpty() || source != parameters) {
+            QString msg = tr("Smart render: encoding %1 instead of copying it: %2 differs from %3")
+                    .arg(segment.resource).arg(source).arg(parameters);
+            qDebug() << msg;
+            appendToLog(msg + '\n');
+            m_totalWeight += kEncodeWeight * segment.length - weight(segment);
+            m_copiedFrames -= segment.length;
+            m_encodedFrames += segment.length;
+            segment.resource.clear();
+            segment.in = segment.start;
+        }
+    }
+}
+
+QString SmartRenderJob::segmentFileName(int index) const
+{
+    return QString("%1/segment-%2.ts").arg(m_tempDir.path()).arg(index, 5, 10, QChar('0'));
+}
+
+int SmartRenderJob::weight(const Segment& segment) const
+{
+    return segment.resource.isEmpty()? kEncodeWeight * segment.length : segment.length;
+}
+
+void SmartRenderJob::renderSegment(int index)
+{
+    const Segment& segment = m_segments.at(index);
+    QString fileName = segmentFileName(index);
+    emit progressUpdated(this, jobPercent(0));
+    setStandardOutputFile(QProcess::nullDevice());
+
+    if (segment.resource.isEmpty()) {
+        // Encode this range of the timeline with the job's consumer.
+        QFile f(xmlPath());
+        f.open(QIODevice::ReadOnly);
+        QDomDocument dom(xmlPath());
+        dom.setContent(&f);
+        f.close();
+
+        QDomElement consumerNode = dom.documentElement().firstChildElement("consumer");
+        consumerNode.setAttribute("target", fileName);
+        consumerNode.setAttribute("f", "mpegts");
+        QDomElement tractorNode = dom.documentElement().lastChildElement("tractor");
+        tractorNode.setAttribute("in", segment.start);
+        tractorNode.setAttribute("out", segment.start + segment.length - 1);
+
+        QString xmlName = fileName + ".mlt";
+        f.setFileName(xmlName);
+        f.open(QIODevice::WriteOnly);
+        QTextStream ts(&f);
+        dom.save(ts, 2);
+        f.close();
+
+        QStringList args;
+        args << "-progress2" << xmlName;
+        startProgram("qmelt", args);
+    } else {
+        // Copy the GOPs from the source. Seek half a frame past the key frame
+        // so that rounding cannot land on the previous one.
+        QStringList args;
+        args << "-v" << "error" << "-y";
+        args << "-ss" << QString::number((segment.in + 0.5) / m_fps, 'f', 6);
+        args << "-i" << segment.resource;
+        args << "-t" << QString::number(segment.length / m_fps, 'f', 6);
+        args << "-map" << (segment.videoIndex >= 0? QString("0:%1").arg(segment.videoIndex) : QString("0:v:0"));
+        if (m_hasAudio && segment.audioIndex >= 0)
+            args << "-map" << QString("0:%1").arg(segment.audioIndex);
+        args << "-c" << "copy";
+        args << "-f" << "mpegts";
+        args << fileName;
+        startProgram("ffmpeg", args);
+    }
+}
+
+void SmartRenderJob::renderNext()
+{
+    // The reference segment was rendered first.
+    if (++m_step == m_reference)
+        ++m_step;
+    if (m_step < m_segments.count()) {
+        renderSegment(m_step);
+    } else {
+        m_state = ConcatState;
+        concat();
+    }
+}
+
+void SmartRenderJob::concat()
+{
+    emit progressUpdated(this, jobPercent(0));
+    QString listName = m_tempDir.path() + "/segments.txt";
+    QFile f(listName);
+    if (f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QTextStream ts(&f);
+        for (int i = 0; i < m_segments.count(); i++)
+            ts << "file '" << segmentFileName(i).replace("'", "'\\''") << "'\n";
+        f.close();
+    }
+    QStringList args;
+    args << "-v" << "error" << "-y";
+    args << "-f" << "concat" << "-safe" << "0";
+    args << "-i" << listName;
+    args << "-map" << "0" << "-c" << "copy";
+    args << objectName();
+    setStandardOutputFile(QProcess::nullDevice());
+    startProgram("ffmpeg", args);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SMARTRENDERJOB_H
+#define SMARTRENDERJOB_H
+
+#include "encodejob.h"
+#include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QTemporaryDir>
+
+class QIODevice;
+
+class SmartRenderJob : public EncodeJob
+{
+public:
+    struct Segment {
+        int start;          // timeline position
+        int length;         // number of frames
+        QString resource;   // source file to copy; empty to encode the timeline
+        int in;             // source frame at start
+        int videoIndex;     // stream to copy, or -1 for the first video one
+        int audioIndex;     // stream to copy, or -1 for none
+    };
+
+    SmartRenderJob(const QString& name, const QString& xml, int length,
+                   const QList<Segment>& candidates, bool hasAudio);
+    static SmartRenderJob* fromJson(const QJsonObject& json);
+    void start();
+    QString type() const { return "smartrender"; }
+    void save(QJsonObject& json) const;
+    int copiedFrames() const { return m_copiedFrames; }
+    int encodedFrames() const { return m_encodedFrames; }
+    uint jobPercent(uint percent) const;
+
+protected:
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    enum State {
+        ProbeState,
+        RenderState,
+        CheckState,
+        ConcatState
+    };
+
+    void startProgram(const QString& program, QStringList args);
+    void probe(const Segment& candidate);
+    QList<int> readKeyframes(const Segment& candidate);
+    static QString readParameters(QIODevice& device);
+    void addCopySegment(const Segment& candidate, const QList<int>& keyframes);
+    void buildSegments();
+    void check(int index);
+    void applyReference(const QString& parameters);
+    QString segmentFileName(int index) const;
+    int weight(const Segment& segment) const;
+    void renderSegment(int index);
+    void renderNext();
+    void concat();
+
+    int m_length;
+    bool m_hasAudio;
+    double m_fps;
+    State m_state;
+    int m_step;
+    QList<Segment> m_candidates;
+    QList<Segment> m_copies;
+    QList<Segment> m_segments;
+    QHash<QString, QString> m_parameters; // of the video stream by resource
+    int m_reference; // the encoded segment the copies are compared with
+    bool m_isChecked;
+    int m_doneWeight;
+    int m_totalWeight;
+    QTemporaryDir m_tempDir;
+    int m_copiedFrames;
+    int m_encodedFrames;
+};
+
+#endif // SMARTRENDERJOB_H
@@ -49,6 +49,12 @@ VideoQualityJob::VideoQualityJob(const QString& name, const QString& xmlPath,
     setStandardOutputFile(reportPath);
 }
 
+void VideoQualityJob::save(QJsonObject& json) const
+{
+    MeltJob::save(json);
+    json["output"] = m_reportPath;
+}
+
 void VideoQualityJob::onOpenTiggered()
 {
     // Parse the XML.
@@ -26,6 +26,9 @@ class VideoQualityJob : public MeltJob
 public:
     VideoQualityJob(const QString& name, const QString& xmlPath,
                     const QString& reportPath);
+    QString type() const { return "vqm"; }
+    void save(QJsonObject& json) const;
+    QString reportPath() const { return m_reportPath; }
 
 private slots:
     void onOpenTiggered();
@@ -19,6 +19,8 @@
 #include <QtWidgets>
 #include "mainwindow.h"
 #include "settings.h"
+#include "headlessexport.h"
+#include "headlessbenchmark.h"
 #include <Logger.h>
 #include <FileAppender.h>
 #include <ConsoleAppender.h>
@@ -85,6 +87,7 @@ public:
 
     Application(int &argc, char **argv)
         : QApplication(argc, argv)
+        , mainWindow(0)
     {
         QDir dir(applicationDirPath());
         dir.cd("lib");
@@ -186,7 +189,19 @@ int main(int argc, char **argv)
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
     QCoreApplication::setAttribute(Qt::AA_X11InitThreads);
 #endif
+    // Batch export and benchmarks need no display, so do not open one.
+    bool isExport = HeadlessExport::isRequested(argc, argv);
+    bool isBenchmark = HeadlessBenchmark::isRequested(argc, argv);
+    if ((isExport || isBenchmark) && qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "minimal");
     Application a(argc, argv);
+    if (isExport) {
+        HeadlessExport exporter;
+        return exporter.exec(a.arguments());
+    } else if (isBenchmark) {
+        HeadlessBenchmark benchmark;
+        return benchmark.exec(a.arguments());
+    }
     QSplashScreen splash(QPixmap(":/icons/shotcut-logo-640.png"));
     splash.showMessage(QCoreApplication::translate("", "Loading plugins..."), Qt::AlignHCenter | Qt::AlignBottom);
     splash.show();
@@ -197,6 +212,7 @@ int main(int argc, char **argv)
     a.mainWindow = &MAIN;
     a.mainWindow->show();
     splash.finish(a.mainWindow);
+    a.mainWindow->recoverJobs();
     if (!a.resourceArg.isEmpty())
         a.mainWindow->open(a.resourceArg);
     int result = a.exec();
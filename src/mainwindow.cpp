@@ -65,12 +65,19 @@
 #include "qmltypes/qmlutilities.h"
 #include "qmltypes/qmlapplication.h"
 #include "autosavefile.h"
+#include "autosavejournal.h"
+#include "previewrender.h"
+#include "proxymanager.h"
+#include "playbacktrace.h"
+#include "mediaimporter.h"
+#include "projectsaver.h"
+#include "projectsnapshot.h"
 #include "commands/playlistcommands.h"
+#include "commands/undohistory.h"
 
 #include <QtWidgets>
 #include <QDebug>
 #include <QThreadPool>
-#include <QtConcurrent/QtConcurrentRun>
 #include <QMutexLocker>
 
 static const int STATUS_TIMEOUT_MS = 5000;
@@ -85,6 +92,10 @@ MainWindow::MainWindow()
     , m_isPlaylistLoaded(false)
     , m_htmlEditor(0)
     , m_autosaveFile(0)
+    , m_autosaveJournal(0)
+    , m_previewRender(0)
+    , m_projectSaver(0)
+    , m_autosaveSaver(0)
     , m_exitCode(EXIT_SUCCESS)
 {
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
@@ -232,6 +243,16 @@ MainWindow::MainWindow()
     connect(m_timelineDock->model(), SIGNAL(closed()), SLOT(onMultitrackClosed()));
     connect(m_timelineDock->model(), SIGNAL(modified()), SLOT(onMultitrackModified()));
     connect(m_timelineDock->model(), SIGNAL(modified()), SLOT(updateAutoSave()));
+    // Only timeline edits go to the autosave journal.
+    m_autosaveJournal = new AutosaveJournal(*m_timelineDock->model(), this);
+    connect(m_playlistDock->model(), SIGNAL(cleared()), m_autosaveJournal, SLOT(invalidate()));
+    connect(m_playlistDock->model(), SIGNAL(modified()), m_autosaveJournal, SLOT(invalidate()));
+    m_projectSaver = new ProjectSaver(this);
+    m_autosaveSaver = new ProjectSaver(this);
+    connect(m_projectSaver, SIGNAL(progressed(QString)), SLOT(showStatusMessage(QString)));
+    connect(m_projectSaver, SIGNAL(saved(QString,bool)), SLOT(onProjectSaved(QString,bool)));
+    m_previewRender = new PreviewRender(*m_timelineDock->model(), this);
+    m_previewRender->setEnabled(Settings.playerRenderAhead());
     connect(m_timelineDock, SIGNAL(clipOpened(void*)), SLOT(openCut(void*)));
     connect(m_timelineDock->model(), SIGNAL(seeked(int)), SLOT(seekTimeline(int)));
     connect(m_playlistDock, SIGNAL(addAllTimeline(Mlt::Playlist*)), SLOT(onTimelineDockTriggered()));
@@ -267,11 +288,19 @@ MainWindow::MainWindow()
     ui->menuView->addAction(m_historyDock->toggleViewAction());
     connect(m_historyDock->toggleViewAction(), SIGNAL(triggered(bool)), this, SLOT(onHistoryDockTriggered(bool)));
     connect(ui->actionHistory, SIGNAL(triggered()), this, SLOT(onHistoryDockTriggered()));
-    QUndoView* undoView = new QUndoView(m_undoStack, m_historyDock);
+    QWidget* historyWidget = new QWidget(m_historyDock);
+    QVBoxLayout* historyLayout = new QVBoxLayout(historyWidget);
+    historyLayout->setContentsMargins(0, 0, 0, 0);
+    QUndoView* undoView = new QUndoView(m_undoStack, historyWidget);
     undoView->setObjectName("historyView");
     undoView->setAlternatingRowColors(true);
     undoView->setSpacing(2);
-    m_historyDock->setWidget(undoView);
+    historyLayout->addWidget(undoView);
+    m_historyLabel = new QLabel(historyWidget);
+    historyLayout->addWidget(m_historyLabel);
+    m_historyDock->setWidget(historyWidget);
+    onUndoHistoryUsageChanged(UNDOHISTORY.memoryUsed(), UNDOHISTORY.diskUsed());
+    connect(&UNDOHISTORY, SIGNAL(usageChanged(qint64,qint64)), SLOT(onUndoHistoryUsageChanged(qint64,qint64)));
     ui->actionUndo->setDisabled(true);
     ui->actionRedo->setDisabled(true);
 
@@ -385,11 +414,14 @@ MainWindow& MainWindow::singleton()
 MainWindow::~MainWindow()
 {
     m_autosaveMutex.lock();
+    m_autosaveSaver->waitForDone();
+    m_autosaveJournal->waitForDone();
     delete m_autosaveFile;
     m_autosaveFile = 0;
     m_autosaveMutex.unlock();
 
     delete m_htmlEditor;
+    delete m_previewRender;
     delete ui;
     Mlt::Controller::destroy();
 }
@@ -414,6 +446,11 @@ void MainWindow::setupSettingsMenu()
     } else {
         delete ui->menuGamma;
     }
+    group = new QActionGroup(this);
+    group->addAction(ui->actionPreviewScaleAutomatic);
+    group->addAction(ui->actionPreviewScaleFull);
+    group->addAction(ui->actionPreviewScaleHalf);
+    group->addAction(ui->actionPreviewScaleQuarter);
     m_profileGroup = new QActionGroup(this);
     m_profileGroup->addAction(ui->actionProfileAutomatic);
     ui->actionProfileAutomatic->setData(QString());
@@ -526,6 +563,43 @@ void MainWindow::setupSettingsMenu()
     connect(m_externalGroup, SIGNAL(triggered(QAction*)), this, SLOT(onExternalTriggered(QAction*)));
     connect(m_profileGroup, SIGNAL(triggered(QAction*)), this, SLOT(onProfileTriggered(QAction*)));
 
+    // Setup the preview threads menus; 0 is automatic.
+    m_renderThreadsGroup = new QActionGroup(this);
+    m_decodeThreadsGroup = new QActionGroup(this);
+    QList<int> threadCounts;
+    threadCounts << 0;
+    for (int n = 1; n <= QThread::idealThreadCount(); n *= 2)
+        threadCounts << n;
+    foreach (int n, threadCounts) {
+        QAction* action = new QAction(n? QString::number(n) : tr("Automatic"), m_renderThreadsGroup);
+        action->setCheckable(true);
+        action->setData(n);
+        action->setChecked(Settings.playerRenderThreads() == n);
+        if (n <= 4) {
+            action = new QAction(n? QString::number(n) : tr("Automatic"), m_decodeThreadsGroup);
+            action->setCheckable(true);
+            action->setData(n);
+            action->setChecked(Settings.playerDecodeThreads() == n);
+        }
+    }
+    ui->menuRenderThreads->addActions(m_renderThreadsGroup->actions());
+    ui->menuDecodeThreads->addActions(m_decodeThreadsGroup->actions());
+    connect(m_renderThreadsGroup, SIGNAL(triggered(QAction*)), this, SLOT(onRenderThreadsTriggered(QAction*)));
+    connect(m_decodeThreadsGroup, SIGNAL(triggered(QAction*)), this, SLOT(onDecodeThreadsTriggered(QAction*)));
+
+    // Setup the present delay menu, in frames.
+    m_presentDelayGroup = new QActionGroup(this);
+    QList<int> delays;
+    delays << 0 << 1 << 2 << 4 << 8;
+    foreach (int n, delays) {
+        QAction* action = new QAction(n? tr("%n frame(s)", 0, n) : tr("None"), m_presentDelayGroup);
+        action->setCheckable(true);
+        action->setData(n);
+        action->setChecked(Settings.playerPresentDelay() == n);
+    }
+    ui->menuPresentDelay->addActions(m_presentDelayGroup->actions());
+    connect(m_presentDelayGroup, SIGNAL(triggered(QAction*)), this, SLOT(onPresentDelayTriggered(QAction*)));
+
     // Setup the language menu actions
     m_languagesGroup = new QActionGroup(this);
     QAction* a = new QAction(QLocale::languageToString(QLocale::Catalan), m_languagesGroup);
@@ -654,6 +728,8 @@ bool MainWindow::isCompatibleWithGpuMode(const QString &url)
 bool MainWindow::checkAutoSave(QString &url)
 {
     QMutexLocker locker(&m_autosaveMutex);
+    m_autosaveSaver->waitForDone();
+    m_autosaveJournal->waitForDone();
 
     // check whether autosave files exist:
     AutoSaveFile* stale = AutoSaveFile::getFile(url);
@@ -666,6 +742,8 @@ bool MainWindow::checkAutoSave(QString &url)
         dialog.setEscapeButton(QMessageBox::No);
         int r = dialog.exec();
         if (r == QMessageBox::Yes) {
+            if (!AutosaveJournal::replay(stale->fileName()))
+                qWarning() << "failed to replay the autosave journal" << url;
             if (!stale->open(QIODevice::ReadWrite)) {
                 qWarning() << "failed to recover autosave file" << url;
                 delete stale;
@@ -690,10 +768,23 @@ bool MainWindow::checkAutoSave(QString &url)
 
 void MainWindow::doAutosave()
 {
+    // This runs on the GUI thread so that nothing changes the project while
+    // it is copied. Timeline edits only append the tracks they changed to the
+    // journal, and anything else is written on another thread.
     m_autosaveMutex.lock();
-    if (m_autosaveFile) {
+    if (m_autosaveFile && m_autosaveSaver->isSaving()) {
+        // The journal follows the file it is replayed on.
+        m_autosaveTimer.start();
+    } else if (m_autosaveFile) {
         if (m_autosaveFile->isOpen() || m_autosaveFile->open(QIODevice::ReadWrite)) {
-            saveXML(m_autosaveFile->fileName());
+            QString fileName = m_autosaveFile->fileName();
+            if (!multitrack() || !m_autosaveJournal->canAppend(fileName)
+                    || !m_autosaveJournal->append(fileName)) {
+                // Opening it only chose its name; it is replaced when saved.
+                m_autosaveFile->close();
+                m_autosaveSaver->save(fileName, XML(QFileInfo(fileName).absolutePath()));
+                m_autosaveJournal->reset(fileName);
+            }
         } else {
             qWarning() << "failed to open autosave file for writing" << m_autosaveFile->fileName();
         }
@@ -701,16 +792,10 @@ void MainWindow::doAutosave()
     m_autosaveMutex.unlock();
 }
 
-static void autosaveTask(MainWindow* p)
-{
-    qDebug() << "running";
-    p->doAutosave();
-}
-
 void MainWindow::onAutosaveTimeout()
 {
     if (isWindowModified())
-        QtConcurrent::run(autosaveTask, this);
+        doAutosave();
 }
 
 void MainWindow::updateAutoSave()
@@ -750,6 +835,7 @@ void MainWindow::open(QString url, const Mlt::Properties* properties)
         if (props && props->is_valid())
             mlt_properties_inherit(MLT.producer()->get_properties(), props->get_properties());
         m_player->setPauseAfterOpen(!MLT.isClip());
+        ProxyManager::generate(*MLT.producer());
         open(MLT.producer());
         m_recentDock->add(m_autosaveFile? m_autosaveFile->managedFileName() : url);
     }
@@ -837,6 +923,12 @@ void MainWindow::readPlayerSettings()
 {
     qDebug() << "begin";
     ui->actionRealtime->setChecked(Settings.playerRealtime());
+    ui->actionRenderAhead->setChecked(Settings.playerRenderAhead());
+    ui->actionAudioScrubber->setChecked(Settings.playerAudioScrubber());
+    ui->actionAudioScrubber->setEnabled(!Settings.playerGPU());
+    ui->actionProxy->setChecked(Settings.proxyEnabled());
+    ui->actionLazyLoad->setChecked(Settings.projectLazyLoad());
+    ui->actionProjectSnapshot->setChecked(Settings.projectSnapshot());
     ui->actionProgressive->setChecked(Settings.playerProgressive());
     ui->actionJack->setChecked(Settings.playerJACK());
     ui->actionGPU->setChecked(Settings.playerGPU());
@@ -904,6 +996,21 @@ void MainWindow::readPlayerSettings()
     else
         ui->actionGammaSRGB->setChecked(true);
 
+    switch (Settings.playerPreviewScale()) {
+    case 1:
+        ui->actionPreviewScaleFull->setChecked(true);
+        break;
+    case 2:
+        ui->actionPreviewScaleHalf->setChecked(true);
+        break;
+    case 4:
+        ui->actionPreviewScaleQuarter->setChecked(true);
+        break;
+    default:
+        ui->actionPreviewScaleAutomatic->setChecked(true);
+        break;
+    }
+
     qDebug() << "end";
 }
 
@@ -1304,6 +1411,7 @@ void MainWindow::closeEvent(QCloseEvent* event)
 {
     if (continueJobsRunning() && continueModified()) {
         if (!m_htmlEditor || m_htmlEditor->close()) {
+            m_projectSaver->waitForDone();
             writeSettings();
             event->accept();
             QApplication::exit(m_exitCode);
@@ -1386,11 +1494,9 @@ bool MainWindow::on_actionSave_triggered()
     if (m_currentFile.isEmpty()) {
         return on_actionSave_As_triggered();
     } else {
-        saveXML(m_currentFile);
+        saveProject(m_currentFile);
         setCurrentFile(m_currentFile);
-        setWindowModified(false);
-        showStatusMessage(tr("Saved %1").arg(m_currentFile));
-        m_undoStack->setClean();
+        showStatusMessage(tr("Saving %1").arg(m_currentFile));
         return true;
     }
 }
@@ -1407,20 +1513,49 @@ bool MainWindow::on_actionSave_As_triggered()
         Settings.setSavePath(fi.path());
         if (fi.suffix() != "mlt")
             filename += ".mlt";
-        saveXML(filename);
+        saveProject(filename);
+        m_autosaveSaver->waitForDone();
+        m_autosaveJournal->waitForDone();
         if (m_autosaveFile)
             m_autosaveFile->changeManagedFile(filename);
         else
             m_autosaveFile = new AutoSaveFile(filename);
         setCurrentFile(filename);
-        setWindowModified(false);
-        showStatusMessage(tr("Saved %1").arg(m_currentFile));
-        m_undoStack->setClean();
+        showStatusMessage(tr("Saving %1").arg(m_currentFile));
         m_recentDock->add(filename);
     }
     return filename.isEmpty();
 }
 
+// The project is clean once it is on disk, unless it was edited meanwhile.
+void MainWindow::saveProject(const QString& fileName)
+{
+    m_savingIndexes << m_undoStack->index();
+    m_projectSaver->save(fileName, XML(QFileInfo(fileName).absolutePath()), snapshot());
+}
+
+void MainWindow::onProjectSaved(const QString& fileName, bool isSuccess)
+{
+    int index = m_savingIndexes.isEmpty()? -1 : m_savingIndexes.takeFirst();
+    if (isSuccess) {
+        if (fileName == QFileInfo(m_currentFile).absoluteFilePath() && index == m_undoStack->index()) {
+            m_undoStack->setClean();
+            setWindowModified(false);
+        }
+        showStatusMessage(tr("Saved %1").arg(fileName));
+    } else {
+        // The previous version of the file is still there.
+        showStatusMessage(tr("Failed to save %1").arg(fileName));
+        QMessageBox dialog(QMessageBox::Critical,
+                           qApp->applicationName(),
+                           tr("The project could not be saved to\n%1").arg(fileName),
+                           QMessageBox::Ok,
+                           this);
+        dialog.setWindowModality(QmlApplication::dialogModality());
+        dialog.exec();
+    }
+}
+
 bool MainWindow::continueModified()
 {
     if (isWindowModified()) {
@@ -1437,7 +1572,8 @@ bool MainWindow::continueModified()
         dialog.setEscapeButton(QMessageBox::Cancel);
         int r = dialog.exec();
         if (r == QMessageBox::Yes) {
-            return on_actionSave_triggered();
+            // The caller is about to close the project.
+            return on_actionSave_triggered() && m_projectSaver->waitForDone();
         } else if (r == QMessageBox::Cancel) {
             return false;
         }
@@ -1463,6 +1599,20 @@ bool MainWindow::continueJobsRunning()
     return true;
 }
 
+void MainWindow::recoverJobs()
+{
+    if (JOBS.hasSaved()) {
+        QMessageBox dialog(QMessageBox::Question, qApp->applicationName(),
+           tr("There are unfinished jobs from a previous session.\n"
+              "Do you want to resume them now?"),
+           QMessageBox::No | QMessageBox::Yes, this);
+        dialog.setWindowModality(QmlApplication::dialogModality());
+        dialog.setDefaultButton(QMessageBox::Yes);
+        dialog.setEscapeButton(QMessageBox::No);
+        JOBS.restore(dialog.exec() == QMessageBox::Yes);
+    }
+}
+
 QUndoStack* MainWindow::undoStack() const
 {
     return m_undoStack;
@@ -1531,6 +1681,14 @@ void MainWindow::onHistoryDockTriggered(bool checked)
     }
 }
 
+void MainWindow::onUndoHistoryUsageChanged(qint64 memory, qint64 disk)
+{
+    QString text = tr("Memory: %1 MiB").arg(memory / 1048576.0, 0, 'f', 1);
+    if (disk > 0)
+        text += "  " + tr("Disk: %1 MiB").arg(disk / 1048576.0, 0, 'f', 1);
+    m_historyLabel->setText(text);
+}
+
 void MainWindow::onFiltersDockTriggered(bool checked)
 {
     if (checked) {
@@ -1572,6 +1730,7 @@ void MainWindow::onPlaylistClosed()
 
 void MainWindow::onPlaylistModified()
 {
+    MLT.frameCache().invalidate();
     setWindowModified(true);
     if ((void*) MLT.producer()->get_producer() == (void*) playlist()->get_playlist())
         m_player->onProducerModified();
@@ -1598,6 +1757,7 @@ void MainWindow::onMultitrackClosed()
 
 void MainWindow::onMultitrackModified()
 {
+    MLT.frameCache().invalidate();
     setWindowModified(true);
     if (MLT.producer() && (void*) MLT.producer()->get_producer() == (void*) multitrack()->get_producer())
         m_player->onProducerModified();
@@ -1616,6 +1776,8 @@ void MainWindow::onCutModified()
 
 void MainWindow::onFilterModelChanged()
 {
+    m_autosaveJournal->invalidate();
+    MLT.frameCache().invalidate();
     setWindowModified(true);
     updateAutoSave();
     if (playlist())
@@ -1674,6 +1836,31 @@ void MainWindow::saveXML(const QString &filename)
     }
 }
 
+// Only timelines are large enough to need one.
+QByteArray MainWindow::snapshot()
+{
+    if (Settings.projectSnapshot() && multitrack())
+        return ProjectSnapshot::write(MLT.profile(), *multitrack());
+    return QByteArray();
+}
+
+QString MainWindow::XML(const QString& root)
+{
+    QString result;
+    if (multitrack()) {
+        result = MLT.XML(multitrack(), root);
+    } else if (playlist()) {
+        int in = MLT.producer()->get_in();
+        int out = MLT.producer()->get_out();
+        MLT.producer()->set_in_and_out(0, MLT.producer()->get_length() - 1);
+        result = MLT.XML(playlist(), root);
+        MLT.producer()->set_in_and_out(in, out);
+    } else {
+        result = MLT.XML(0, root);
+    }
+    return result;
+}
+
 void MainWindow::changeTheme(const QString &theme)
 {
     qDebug() << "begin";
@@ -1898,6 +2085,41 @@ void MainWindow::onShuttle(float x)
     }
 }
 
+void MainWindow::on_actionRenderAhead_triggered(bool checked)
+{
+    Settings.setPlayerRenderAhead(checked);
+    m_previewRender->setEnabled(checked);
+}
+
+void MainWindow::on_actionAudioScrubber_triggered(bool checked)
+{
+    Settings.setPlayerAudioScrubber(checked);
+    if (!checked)
+        ((Mlt::GLWidget*) &(MLT))->resetAudioScrubber();
+}
+
+void MainWindow::on_actionProxy_triggered(bool checked)
+{
+    Settings.setProxyEnabled(checked);
+    // Put the original of a proxy back in the player.
+    if (!checked && MLT.producer() && MLT.isClip() && ProxyManager::isProxy(*MLT.producer())) {
+        int position = MLT.producer()->position();
+        QString xml = ProxyManager::originalXML(MLT.XML());
+        open(new Mlt::Producer(MLT.profile(), "xml-string", xml.toUtf8().constData()));
+        MLT.seek(position);
+    }
+}
+
+void MainWindow::on_actionLazyLoad_triggered(bool checked)
+{
+    Settings.setProjectLazyLoad(checked);
+}
+
+void MainWindow::on_actionProjectSnapshot_triggered(bool checked)
+{
+    Settings.setProjectSnapshot(checked);
+}
+
 void MainWindow::on_actionRealtime_triggered(bool checked)
 {
     Settings.setPlayerRealtime(checked);
@@ -1963,37 +2185,15 @@ void MainWindow::changeInterpolation(bool checked, const char* method)
     Settings.setPlayerInterpolation(method);
 }
 
-class AppendTask : public QRunnable
-{
-public:
-    AppendTask(PlaylistModel* model, const QStringList& filenames)
-        : QRunnable()
-        , model(model)
-        , filenames(filenames)
-    {
-    }
-    void run()
-    {
-        foreach (QString filename, filenames) {
-            Mlt::Producer p(MLT.profile(), filename.toUtf8().constData());
-            if (p.is_valid()) {
-                MLT.setImageDurationFromDefault(&p);
-                MAIN.undoStack()->push(new Playlist::AppendCommand(*model, MLT.XML(&p)));
-            }
-        }
-    }
-private:
-    PlaylistModel* model;
-    const QStringList& filenames;
-};
-
 void MainWindow::processMultipleFiles()
 {
     if (m_multipleFiles.length() > 0) {
         PlaylistModel* model = m_playlistDock->model();
         m_playlistDock->show();
         m_playlistDock->raise();
-        QThreadPool::globalInstance()->start(new AppendTask(model, m_multipleFiles));
+        MediaImporter* importer = new MediaImporter(*model, m_multipleFiles, this);
+        connect(importer, SIGNAL(progressed(QString)), SLOT(showStatusMessage(QString)));
+        importer->start();
         foreach (QString filename, m_multipleFiles)
             m_recentDock->add(filename.toUtf8().constData());
         m_multipleFiles.clear();
@@ -2022,6 +2222,19 @@ void MainWindow::onLanguageTriggered(QAction* action)
     }
 }
 
+void MainWindow::onRenderThreadsTriggered(QAction* action)
+{
+    Settings.setPlayerRenderThreads(action->data().toInt());
+    if (MLT.consumer())
+        MLT.restart();
+}
+
+void MainWindow::onDecodeThreadsTriggered(QAction* action)
+{
+    // This applies to video files as they are opened.
+    Settings.setPlayerDecodeThreads(action->data().toInt());
+}
+
 void MainWindow::on_actionNearest_triggered(bool checked)
 {
     changeInterpolation(checked, "nearest");
@@ -2053,6 +2266,25 @@ void MainWindow::on_actionJack_triggered(bool checked)
     }
 }
 
+void MainWindow::onPresentDelayTriggered(QAction* action)
+{
+    // The renderer sizes its queue for it when it starts.
+    Settings.setPlayerPresentDelay(action->data().toInt());
+    QMessageBox dialog(QMessageBox::Information,
+                       qApp->applicationName(),
+                       tr("You must restart Shotcut to change the present delay.\n"
+                          "Do you want to restart now?"),
+                       QMessageBox::No | QMessageBox::Yes,
+                       this);
+    dialog.setDefaultButton(QMessageBox::Yes);
+    dialog.setEscapeButton(QMessageBox::No);
+    dialog.setWindowModality(QmlApplication::dialogModality());
+    if (dialog.exec() == QMessageBox::Yes) {
+        m_exitCode = EXIT_RESTART;
+        QApplication::closeAllWindows();
+    }
+}
+
 void MainWindow::on_actionGPU_triggered(bool checked)
 {
     Settings.setPlayerGPU(checked);
@@ -2203,6 +2435,25 @@ void MainWindow::on_actionShowToolbar_triggered(bool checked)
     ui->mainToolBar->setVisible(checked);
 }
 
+void MainWindow::on_actionPlaybackStatistics_triggered(bool checked)
+{
+    TRACE.setEnabled(checked);
+    ui->actionExportPlaybackTrace->setEnabled(checked);
+}
+
+void MainWindow::on_actionExportPlaybackTrace_triggered()
+{
+    QString path = Settings.savePath();
+    path.append("/shotcut-trace.json");
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export Playback Trace"), path, tr("Trace (*.json)"));
+    if (!filename.isEmpty()) {
+        if (TRACE.save(filename))
+            showStatusMessage(tr("Saved %1").arg(filename));
+        else
+            showStatusMessage(tr("Failed to save %1").arg(filename));
+    }
+}
+
 void MainWindow::onToolbarVisibilityChanged(bool visible)
 {
     ui->actionShowToolbar->setChecked(visible);
@@ -2260,6 +2511,30 @@ void MainWindow::on_actionOpenXML_triggered()
     }
 }
 
+void MainWindow::on_actionPreviewScaleAutomatic_triggered(bool checked)
+{
+    if (checked)
+        Settings.setPlayerPreviewScale(0);
+}
+
+void MainWindow::on_actionPreviewScaleFull_triggered(bool checked)
+{
+    if (checked)
+        Settings.setPlayerPreviewScale(1);
+}
+
+void MainWindow::on_actionPreviewScaleHalf_triggered(bool checked)
+{
+    if (checked)
+        Settings.setPlayerPreviewScale(2);
+}
+
+void MainWindow::on_actionPreviewScaleQuarter_triggered(bool checked)
+{
+    if (checked)
+        Settings.setPlayerPreviewScale(4);
+}
+
 void MainWindow::on_actionGammaSRGB_triggered(bool checked)
 {
     Q_UNUSED(checked)
@@ -38,12 +38,16 @@ class QUndoStack;
 class MeltedPlaylistDock;
 class MeltedServerDock;
 class QActionGroup;
+class QLabel;
 class FilterController;
 class ScopeController;
 class FiltersDock;
 class HtmlEditor;
 class TimelineDock;
 class AutoSaveFile;
+class AutosaveJournal;
+class PreviewRender;
+class ProjectSaver;
 
 class MainWindow : public QMainWindow
 {
@@ -55,8 +59,10 @@ public:
     void open(Mlt::Producer* producer);
     bool continueModified();
     bool continueJobsRunning();
+    void recoverJobs();
     QUndoStack* undoStack() const;
     void saveXML(const QString& filename);
+    QString XML(const QString& root);
     static void changeTheme(const QString& theme);
     PlaylistDock* playlistDock() const { return m_playlistDock; }
     FilterController* filterController() const { return m_filterController; }
@@ -93,6 +99,8 @@ private:
     void changeDeinterlacer(bool checked, const char* method);
     void changeInterpolation(bool checked, const char* method);
     bool checkAutoSave(QString &url);
+    QByteArray snapshot();
+    void saveProject(const QString& fileName);
 
     Ui::MainWindow* ui;
     Player* m_player;
@@ -106,6 +114,7 @@ private:
     bool m_isKKeyPressed;
     QUndoStack* m_undoStack;
     QDockWidget* m_historyDock;
+    QLabel* m_historyLabel;
     MeltedServerDock* m_meltedServerDock;
     MeltedPlaylistDock* m_meltedPlaylistDock;
     QActionGroup* m_profileGroup;
@@ -119,8 +128,16 @@ private:
     QStringList m_multipleFiles;
     bool m_isPlaylistLoaded;
     QActionGroup* m_languagesGroup;
+    QActionGroup* m_renderThreadsGroup;
+    QActionGroup* m_decodeThreadsGroup;
+    QActionGroup* m_presentDelayGroup;
     HtmlEditor* m_htmlEditor;
     AutoSaveFile* m_autosaveFile;
+    AutosaveJournal* m_autosaveJournal;
+    PreviewRender* m_previewRender;
+    ProjectSaver* m_projectSaver;
+    QList<int> m_savingIndexes;
+    ProjectSaver* m_autosaveSaver;
     QMutex m_autosaveMutex;
     QTimer m_autosaveTimer;
     int m_exitCode;
@@ -156,6 +173,7 @@ private slots:
     void onProducerChanged();
     bool on_actionSave_triggered();
     bool on_actionSave_As_triggered();
+    void onProjectSaved(const QString& fileName, bool isSuccess);
     void onEncodeTriggered(bool checked = true);
     void onCaptureStateChanged(bool started);
     void onJobsDockTriggered(bool);
@@ -164,6 +182,7 @@ private slots:
     void onPlaylistDockTriggered(bool checked = true);
     void onTimelineDockTriggered(bool checked = true);
     void onHistoryDockTriggered(bool checked = true);
+    void onUndoHistoryUsageChanged(qint64 memory, qint64 disk);
     void onFiltersDockTriggered(bool checked = true);
     void onPlaylistCreated();
     void onPlaylistLoaded();
@@ -185,6 +204,15 @@ private slots:
     void onMeltedUnitActivated();
     void on_actionEnter_Full_Screen_triggered();
     void on_actionRealtime_triggered(bool checked);
+    void on_actionRenderAhead_triggered(bool checked);
+    void on_actionAudioScrubber_triggered(bool checked);
+    void on_actionProxy_triggered(bool checked);
+    void on_actionLazyLoad_triggered(bool checked);
+    void on_actionProjectSnapshot_triggered(bool checked);
+    void on_actionPreviewScaleAutomatic_triggered(bool checked);
+    void on_actionPreviewScaleFull_triggered(bool checked);
+    void on_actionPreviewScaleHalf_triggered(bool checked);
+    void on_actionPreviewScaleQuarter_triggered(bool checked);
     void on_actionProgressive_triggered(bool checked);
     void on_actionOneField_triggered(bool checked);
     void on_actionLinearBlend_triggered(bool checked);
@@ -202,6 +230,9 @@ private slots:
     void on_actionAddCustomProfile_triggered();
     void processMultipleFiles();
     void onLanguageTriggered(QAction*);
+    void onRenderThreadsTriggered(QAction*);
+    void onDecodeThreadsTriggered(QAction*);
+    void onPresentDelayTriggered(QAction*);
     void on_actionSystemTheme_triggered();
     void on_actionFusionDark_triggered();
     void on_actionFusionLight_triggered();
@@ -209,6 +240,8 @@ private slots:
     void on_actionRestoreLayout_triggered();
     void on_actionShowTitleBars_triggered(bool checked);
     void on_actionShowToolbar_triggered(bool checked);
+    void on_actionPlaybackStatistics_triggered(bool checked);
+    void on_actionExportPlaybackTrace_triggered();
     void onToolbarVisibilityChanged(bool visible);
     void on_menuExternal_aboutToShow();
     void on_actionUpgrade_triggered();
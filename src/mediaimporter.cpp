@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mediaimporter.h"
+#include "mltcontroller.h"
+#include "mainwindow.h"
+#include "models/playlistmodel.h"
+#include "commands/playlistcommands.h"
+#include "mediainfocache.h"
+#include <QRunnable>
+#include <QUndoStack>
+#include <QThread>
+#include <QDebug>
+
+class ProbeTask : public QRunnable
+{
+public:
+    ProbeTask(QObject* receiver, const QString& fileName, MediaImporter::Probe* probe)
+        : QRunnable()
+        , receiver(receiver)
+        , fileName(fileName)
+        , probe(probe)
+    {
+    }
+    void run()
+    {
+        Mlt::Producer* p = new Mlt::Producer(MLT.profile(), fileName.toUtf8().constData());
+        if (p->is_valid()) {
+            MLT.setImageDurationFromDefault(p);
+            probe->xml = MLT.XML(p);
+            probe->producer = p;
+        } else {
+            qWarning() << "failed to open" << fileName;
+            delete p;
+        }
+        QMetaObject::invokeMethod(receiver, "onProbed", Qt::QueuedConnection);
+    }
+private:
+    QObject* receiver;
+    QString fileName;
+    MediaImporter::Probe* probe;
+};
+
+MediaImporter::MediaImporter(PlaylistModel& model, const QStringList& fileNames, QObject* parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_fileNames(fileNames)
+    , m_probes(fileNames.size())
+    , m_done(0)
+{
+    // Opening a file is mostly waiting on the disk, but too many at once
+    // only make them compete for it.
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+    for (int i = 0; i < m_probes.size(); i++)
+        m_probes[i].producer = 0;
+}
+
+MediaImporter::~MediaImporter()
+{
+    m_pool.waitForDone();
+    foreach (Probe probe, m_probes)
+        delete probe.producer;
+}
+
+void MediaImporter::start()
+{
+    // Each task writes only its own entry, which is read after it reports.
+    Probe* probes = m_probes.data();
+    for (int i = 0; i < m_fileNames.size(); i++)
+        m_pool.start(new ProbeTask(this, m_fileNames.at(i), &probes[i]));
+    if (m_fileNames.isEmpty())
+        deleteLater();
+}
+
+void MediaImporter::onProbed()
+{
+    ++m_done;
+    emit progressed(tr("Opening %1 of %2 files").arg(m_done).arg(m_fileNames.size()));
+    if (m_done < m_fileNames.size())
+        return;
+
+    int count = 0;
+    foreach (Probe probe, m_probes) {
+        if (probe.producer)
+            ++count;
+    }
+    QUndoCommand* parent = 0;
+    if (count > 1)
+        parent = new QUndoCommand(tr("Append %1 playlist items").arg(count));
+    QUndoCommand* command = 0;
+    for (int i = 0; i < m_probes.size(); i++) {
+        if (m_probes[i].producer) {
+            if (!qstrcmp(m_probes[i].producer->get("mlt_service"), "avformat"))
+                MediaInfoCache::store(m_fileNames.at(i), *m_probes[i].producer);
+            command = new Playlist::AppendCommand(m_model, m_probes[i].producer, m_probes[i].xml, parent);
+            m_probes[i].producer = 0;
+            m_probes[i].xml.clear();
+        }
+    }
+    if (parent)
+        MAIN.undoStack()->push(parent);
+    else if (command)
+        MAIN.undoStack()->push(command);
+    emit progressed(tr("Added %1 of %2 files").arg(count).arg(m_fileNames.size()));
+    deleteLater();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEDIAIMPORTER_H
+#define MEDIAIMPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QThreadPool>
+
+class PlaylistModel;
+namespace Mlt {
+    class Producer;
+}
+
+// Opens many files at once on its own bounded thread pool and appends them
+// to the playlist in the order given as one undo command. It deletes itself
+// when done.
+class MediaImporter : public QObject
+{
+    Q_OBJECT
+public:
+    MediaImporter(PlaylistModel& model, const QStringList& fileNames, QObject* parent = 0);
+    ~MediaImporter();
+    void start();
+
+    struct Probe {
+        Mlt::Producer* producer;
+        QString xml;
+    };
+
+signals:
+    void progressed(const QString& message);
+
+private slots:
+    void onProbed();
+
+private:
+    PlaylistModel& m_model;
+    QStringList m_fileNames;
+    QVector<Probe> m_probes;
+    QThreadPool m_pool;
+    int m_done;
+};
+
+#endif // MEDIAIMPORTER_H
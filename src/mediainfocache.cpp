@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mediainfocache.h"
+#include "database.h"
+#include <Mlt.h>
+#include <QDebug>
+
+static const char* kProfilePrefix = "_profile.";
+
+static bool isMediaProperty(const QString& name)
+{
+    return name.startsWith("meta.media.") || name == "length" || name == "seekable"
+        || name == "audio_index" || name == "video_index";
+}
+
+void MediaInfoCache::store(const QString& fileName, Mlt::Producer& producer, Mlt::Profile* profile)
+{
+    QString hash = Database::fingerprint(fileName);
+    if (hash.isEmpty())
+        return;
+    QMap<QString, QString> info;
+    for (int i = 0; i < producer.count(); i++) {
+        QString name = QString::fromUtf8(producer.get_name(i));
+        if (isMediaProperty(name) && producer.get(i))
+            info[name] = QString::fromUtf8(producer.get(i));
+    }
+    if (profile) {
+        QString prefix(kProfilePrefix);
+        info[prefix + "width"] = QString::number(profile->width());
+        info[prefix + "height"] = QString::number(profile->height());
+        info[prefix + "progressive"] = QString::number(profile->progressive());
+        info[prefix + "colorspace"] = QString::number(profile->colorspace());
+        info[prefix + "frame_rate_num"] = QString::number(profile->frame_rate_num());
+        info[prefix + "frame_rate_den"] = QString::number(profile->frame_rate_den());
+        info[prefix + "sample_aspect_num"] = QString::number(profile->sample_aspect_num());
+        info[prefix + "sample_aspect_den"] = QString::number(profile->sample_aspect_den());
+        info[prefix + "display_aspect_num"] = QString::number(profile->display_aspect_num());
+        info[prefix + "display_aspect_den"] = QString::number(profile->display_aspect_den());
+    }
+    DB.putMediaInfo(hash, info);
+}
+
+bool MediaInfoCache::restoreProfile(const QString& fileName, Mlt::Profile& profile)
+{
+    QString hash = Database::fingerprint(fileName);
+    QMap<QString, QString> info;
+    QString prefix(kProfilePrefix);
+    if (hash.isEmpty() || !DB.getMediaInfo(hash, info) || !info.contains(prefix + "frame_rate_den"))
+        return false;
+    int frameRateDen = info.value(prefix + "frame_rate_den").toInt();
+    int sampleAspectDen = info.value(prefix + "sample_aspect_den").toInt();
+    int displayAspectDen = info.value(prefix + "display_aspect_den").toInt();
+    if (frameRateDen <= 0 || sampleAspectDen <= 0 || displayAspectDen <= 0)
+        return false;
+    profile.set_width(info.value(prefix + "width").toInt());
+    profile.set_height(info.value(prefix + "height").toInt());
+    profile.set_progressive(info.value(prefix + "progressive").toInt());
+    profile.set_colorspace(info.value(prefix + "colorspace").toInt());
+    profile.set_frame_rate(info.value(prefix + "frame_rate_num").toInt(), frameRateDen);
+    profile.set_sample_aspect(info.value(prefix + "sample_aspect_num").toInt(), sampleAspectDen);
+    profile.set_display_aspect(info.value(prefix + "display_aspect_num").toInt(), displayAspectDen);
+    qDebug() << "video mode from the cache" << fileName << profile.width() << profile.height() << profile.fps();
+    return true;
+}
+
+QMap<QString, QString> MediaInfoCache::properties(const QString& fileName)
+{
+    QMap<QString, QString> info;
+    QString hash = Database::fingerprint(fileName);
+    if (!hash.isEmpty() && DB.getMediaInfo(hash, info)) {
+        foreach (QString name, info.keys()) {
+            if (name.startsWith(kProfilePrefix))
+                info.remove(name);
+        }
+    }
+    return info;
+}
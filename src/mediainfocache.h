@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEDIAINFOCACHE_H
+#define MEDIAINFOCACHE_H
+
+#include <QString>
+#include <QMap>
+
+namespace Mlt {
+    class Producer;
+    class Profile;
+}
+
+// Remembers what opening a media file found out about it: its streams,
+// duration, frame rate, size, codecs, and the video mode chosen for it. It
+// is kept in the database by the fingerprint of the file. Opening the file
+// again then does not need to open it once more to choose the video mode,
+// and clips of a project opened lazily describe their media without opening
+// it.
+class MediaInfoCache
+{
+public:
+    static void store(const QString& fileName, Mlt::Producer& producer, Mlt::Profile* profile = 0);
+    static bool restoreProfile(const QString& fileName, Mlt::Profile& profile);
+    static QMap<QString, QString> properties(const QString& fileName);
+};
+
+#endif // MEDIAINFOCACHE_H
@@ -21,10 +21,19 @@
 #include <QPalette>
 #include <QMetaType>
 #include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QElapsedTimer>
 #include <QDebug>
 #include <Mlt.h>
 #include "glwidget.h"
 #include "settings.h"
+#include "proxymanager.h"
+#include "mediainfocache.h"
+#include "projectsnapshot.h"
 
 namespace Mlt {
 
@@ -37,12 +46,131 @@ static int alignWidth(int width)
     return (width + 7) / 8 * 8;
 }
 
+// Copies a project, changing its avformat producers to avformat-novalidate,
+// which opens the file only when a frame is first requested. Until then, the
+// producer is described by what the media info cache knows about the file.
+// The root keeps relative paths resolving against the folder of the project.
+static QString lazyXML(const QString& fileName, int& count)
+{
+    QString result;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+    QXmlStreamReader reader(&file);
+    QXmlStreamWriter writer(&result);
+    QDir root(QFileInfo(fileName).absolutePath());
+    bool isProducer = false;
+    bool isLazy = false;
+    QString property;
+    QMap<QString, QString> properties; // of the current producer
+    count = 0;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement() && (reader.name() == QLatin1String("mlt")
+                || reader.name() == QLatin1String("producer"))) {
+            QXmlStreamAttributes attributes = reader.attributes();
+            writer.writeStartElement(reader.qualifiedName().toString());
+            isLazy = false;
+            foreach (QXmlStreamAttribute a, attributes) {
+                if (a.name() == QLatin1String("mlt_service") && a.value() == QLatin1String("avformat")) {
+                    writer.writeAttribute(a.qualifiedName().toString(), "avformat-novalidate");
+                    isLazy = true;
+                    ++count;
+                } else {
+                    writer.writeAttribute(a);
+                }
+            }
+            if (reader.name() == QLatin1String("mlt")) {
+                if (attributes.hasAttribute("root"))
+                    root.setPath(attributes.value("root").toString());
+                else
+                    writer.writeAttribute("root", root.absolutePath());
+            } else {
+                isProducer = true;
+                properties.clear();
+            }
+            continue;
+        }
+        if (isProducer && reader.isStartElement() && reader.name() == QLatin1String("property")) {
+            property = reader.attributes().value("name").toString();
+            properties[property] = QString();
+        } else if (reader.isEndElement() && reader.name() == QLatin1String("property")) {
+            property.clear();
+        } else if (isProducer && reader.isCharacters() && !property.isEmpty()) {
+            if (property == "mlt_service" && reader.text().toString().trimmed() == "avformat") {
+                writer.writeCharacters("avformat-novalidate");
+                isLazy = true;
+                ++count;
+                continue;
+            }
+            properties[property] += reader.text().toString();
+        } else if (isProducer && reader.isEndElement() && reader.name() == QLatin1String("producer")) {
+            if (isLazy) {
+                QString resource = root.absoluteFilePath(properties.value("resource"));
+                QMap<QString, QString> info = MediaInfoCache::properties(resource);
+                foreach (QString name, info.keys()) {
+                    if (!properties.contains(name)) {
+                        writer.writeStartElement("property");
+                        writer.writeAttribute("name", name);
+                        writer.writeCharacters(info.value(name));
+                        writer.writeEndElement();
+                    }
+                }
+            }
+            isProducer = false;
+        }
+        writer.writeCurrentToken(reader);
+    }
+    if (reader.hasError()) {
+        qWarning() << "failed to read" << fileName << reader.errorString();
+        result.clear();
+    }
+    return result;
+}
+
+static Producer* openProducer(Profile& profile, const QString& url, bool isLazy)
+{
+    QString xml;
+    if (isLazy) {
+        int count = 0;
+        xml = lazyXML(url, count);
+        if (!xml.isEmpty())
+            qDebug() << "deferred opening" << count << "media files";
+    }
+    // Edit a project with the proxies of its files that have one.
+    if (Settings.proxyEnabled() && (url.endsWith(".mlt") || url.endsWith(".xml"))) {
+        int count = 0;
+        QString proxied;
+        if (!xml.isEmpty()) {
+            proxied = ProxyManager::proxyXML(xml, QFileInfo(url).absolutePath(), count);
+        } else {
+            QFile file(url);
+            if (file.open(QIODevice::ReadOnly))
+                proxied = ProxyManager::proxyXML(QString::fromUtf8(file.readAll()), QFileInfo(url).absolutePath(), count);
+        }
+        if (count > 0) {
+            xml = proxied;
+            qDebug() << "editing with" << count << "proxies";
+        }
+    }
+    if (!xml.isEmpty()) {
+        Producer* producer = new Producer(profile, "xml-string", xml.toUtf8().constData());
+        producer->set("resource", url.toUtf8().constData());
+        return producer;
+    }
+    return new Producer(profile, url.toUtf8().constData());
+}
+
 Controller::Controller()
     : m_producer(0)
     , m_consumer(0)
     , m_jackFilter(0)
     , m_volume(1.0)
     , m_savedProducer(0)
+    , m_frameCache(Settings.playerFrameCache())
+    , m_preview(0)
+    , m_previewSource(0)
+    , m_isPreviewing(false)
 {
     qDebug() << "begin";
     m_repo = Mlt::Factory::init();
@@ -94,29 +222,52 @@ int Controller::setProducer(Mlt::Producer* producer, bool)
 int Controller::open(const QString &url)
 {
     int error = 0;
+    bool isLazy = Settings.projectLazyLoad() && (url.endsWith(".mlt") || url.endsWith(".xml"));
+    QElapsedTimer timer;
+    timer.start();
 
     close();
-    if (Settings.playerGPU() && !profile().is_explicit())
+    // The video mode of a file opened before is in the cache, which saves
+    // opening it twice to find it.
+    bool isDetecting = !profile().is_explicit();
+    // A snapshot saved with a project builds it without parsing the XML, and
+    // it has the video mode of the project.
+    Producer* snapshot = url.endsWith(".mlt")? ProjectSnapshot::open(profile(), url, isLazy) : 0;
+    if (snapshot)
+        isDetecting = false;
+    else if (isDetecting && !isLazy && MediaInfoCache::restoreProfile(url, profile()))
+        isDetecting = false;
+    if (snapshot)
+        m_producer = snapshot;
+    else if (Settings.playerGPU() && isDetecting)
         // Prevent loading normalizing filters, which might be Movit ones that
         // may not have a proper OpenGL context when requesting a sample frame.
         m_producer = new Mlt::Producer(profile(), "abnormal", url.toUtf8().constData());
     else
-        m_producer = new Mlt::Producer(profile(), url.toUtf8().constData());
+        m_producer = openProducer(profile(), url, isLazy);
     if (m_producer->is_valid()) {
         double fps = profile().fps();
-        if (!profile().is_explicit()) {
+        if (isDetecting) {
             profile().from_producer(*m_producer);
             profile().set_width(alignWidth(profile().width()));
         }
-        if (profile().fps() != fps || (Settings.playerGPU() && !profile().is_explicit())) {
+        if (profile().fps() != fps || (Settings.playerGPU() && isDetecting)) {
             // Reload with correct FPS or with Movit normalizing filters attached.
             delete m_producer;
-            m_producer = new Mlt::Producer(profile(), url.toUtf8().constData());
+            m_producer = openProducer(profile(), url, isLazy);
         }
         // Convert avformat to avformat-novalidate so that XML loads faster.
         if (!qstrcmp(m_producer->get("mlt_service"), "avformat")) {
+            MediaInfoCache::store(url, *m_producer, profile().is_explicit()? 0 : &profile());
             m_producer->set("mlt_service", "avformat-novalidate");
             m_producer->set("mute_on_pause", 0);
+            // Edit with a proxy of the file when there is one.
+            Mlt::Producer* proxy = ProxyManager::open(profile(), url);
+            if (proxy) {
+                delete m_producer;
+                m_producer = proxy;
+            }
+            setDecodeThreads(*m_producer);
         }
         if (m_url.isEmpty() && QString(m_producer->get("xml")) == "was here") {
             if (m_producer->get_int("_original_type") != tractor_type ||
@@ -124,6 +275,8 @@ int Controller::open(const QString &url)
                 m_url = url;
         }
         setImageDurationFromDefault(m_producer);
+        qDebug() << "opened" << url << "in" << timer.elapsed() << "ms" << (isLazy? "lazily" : "")
+                 << (snapshot? "from its snapshot" : "");
     }
     else {
         delete m_producer;
@@ -136,8 +289,10 @@ int Controller::open(const QString &url)
 bool Controller::openXML(const QString &filename)
 {
     bool error = true;
+    bool isLazy = Settings.projectLazyLoad();
     close();
-    Producer* producer = new Mlt::Producer(profile(), "xml", filename.toUtf8().constData());
+    Producer* producer = isLazy? openProducer(profile(), filename, true)
+                               : new Mlt::Producer(profile(), "xml", filename.toUtf8().constData());
     if (producer->is_valid()) {
         double fps = profile().fps();
         if (!profile().is_explicit()) {
@@ -147,7 +302,8 @@ bool Controller::openXML(const QString &filename)
         if (profile().fps() != fps) {
             // reopen with the correct fps
             delete producer;
-            producer = new Mlt::Producer(profile(), "xml", filename.toUtf8().constData());
+            producer = isLazy? openProducer(profile(), filename, true)
+                             : new Mlt::Producer(profile(), "xml", filename.toUtf8().constData());
         }
         producer->set(kShotcutVirtualClip, 1);
         producer->set("resource", filename.toUtf8().constData());
@@ -169,8 +325,11 @@ void Controller::close()
         delete m_savedProducer;
         m_savedProducer = new Mlt::Producer(m_producer);
     }
+    connectPreview(false);
+    setPreview(0, 0);
     delete m_producer;
     m_producer = 0;
+    m_frameCache.invalidate();
 }
 
 void Controller::closeConsumer()
@@ -187,13 +346,16 @@ void Controller::play(double speed)
 {
     if (m_producer)
         m_producer->set_speed(speed);
+    if (m_isPreviewing)
+        m_preview->set_speed(speed);
     if (m_consumer) {
         // Restore real_time behavior and work-ahead buffering
         m_consumer->set("real_time", realTime());
         m_consumer->set("buffer", 25);
         m_consumer->set("prefill", 1);
+        connectPreview(speed != 0);
         m_consumer->start();
-        refreshConsumer();
+        refreshConsumer(false);
     }
     if (m_jackFilter)
         m_jackFilter->fire_event("jack-start");
@@ -202,6 +364,7 @@ void Controller::play(double speed)
 
 void Controller::pause()
 {
+    connectPreview(false);
     if (m_producer && m_producer->get_speed() != 0) {
         if (m_consumer && m_consumer->is_valid()) {
             // Disable real_time behavior and buffering for frame accurate seeking.
@@ -223,6 +386,7 @@ void Controller::pause()
 
 void Controller::stop()
 {
+    connectPreview(false);
     if (m_consumer && !m_consumer->is_stopped())
         m_consumer->stop();
     if (m_producer)
@@ -242,7 +406,7 @@ void Controller::onJackStarted(int position)
     if (m_producer) {
         m_producer->set_speed(1);
         m_producer->seek(position);
-        refreshConsumer();
+        refreshConsumer(false);
     }
 }
 
@@ -266,7 +430,7 @@ void Controller::onJackStopped(int position)
     }
     if (m_consumer && m_consumer->get_int("real_time") >= -1)
         m_consumer->purge();
-    refreshConsumer();
+    refreshConsumer(false);
 }
 
 bool Controller::enableJack(bool enable)
@@ -327,11 +491,19 @@ double Controller::volume() const
 
 void Controller::onWindowResize()
 {
-    refreshConsumer();
+    refreshConsumer(false);
 }
 
 void Controller::seek(int position)
 {
+    seek(position, true);
+}
+
+// Without refresh, the consumer is left paused on the position, which is
+// for when the caller already has the image to show.
+void Controller::seek(int position, bool refresh)
+{
+    connectPreview(false);
     if (m_producer) {
         // Always pause before seeking (if not already paused).
         if (m_consumer && m_consumer->is_valid() && m_producer->get_speed() != 0) {
@@ -347,7 +519,8 @@ void Controller::seek(int position)
                 m_consumer->start();
             } else {
                 m_consumer->purge();
-                refreshConsumer();
+                if (refresh)
+                    refreshConsumer(false);
             }
         }
     }
@@ -356,37 +529,95 @@ void Controller::seek(int position)
     setVolume(m_volume, false);
 }
 
-void Controller::refreshConsumer()
+// The preview plays in place of source, the current producer, when it is the
+// same length with some ranges already rendered. Takes ownership of preview.
+void Controller::setPreview(Mlt::Producer* preview, Mlt::Producer* source)
+{
+    if (m_isPreviewing && m_producer) {
+        // Continue playing the source from where the preview was.
+        double speed = m_producer->get_speed();
+        connectPreview(false);
+        if (m_consumer && speed != 0)
+            m_consumer->start();
+    }
+    delete m_preview;
+    m_preview = preview;
+    m_previewSource = (preview && source)? source->get_producer() : 0;
+}
+
+void Controller::connectPreview(bool enable)
+{
+    if (enable == m_isPreviewing)
+        return;
+    if (enable && (!m_preview || !m_producer || !m_consumer
+                   || m_producer->get_producer() != m_previewSource))
+        return;
+    Mlt::Producer* from = enable? m_producer : m_preview;
+    Mlt::Producer* to = enable? m_preview : m_producer;
+    // The consumer reads ahead of the source, so take the position from it
+    // while playing.
+    int position = from->get_speed() != 0? m_consumer->position() + 1 : from->position();
+    if (!m_consumer->is_stopped())
+        m_consumer->stop();
+    to->set_speed(m_producer->get_speed());
+    to->seek(position);
+    m_consumer->connect(*to);
+    m_consumer->purge();
+    m_isPreviewing = enable;
+}
+
+// Renders the producer at a fraction of the profile resolution. The consumer
+// only picks up the new size when it starts.
+void Controller::setPreviewScale(int divisor)
+{
+    if (!m_consumer || !m_consumer->is_valid() || !qstrcmp(m_consumer->get("mlt_service"), "multi"))
+        return;
+    int width = profile().width();
+    int height = profile().height();
+    if (divisor > 1) {
+        width = width / divisor / 2 * 2;
+        height = height / divisor / 2 * 2;
+    }
+    if (width == m_consumer->get_int("width") && height == m_consumer->get_int("height"))
+        return;
+    qDebug() << "preview scale" << width << "x" << height;
+    m_consumer->set("width", width);
+    m_consumer->set("height", height);
+    if (!m_consumer->is_stopped()) {
+        m_consumer->stop();
+        m_consumer->start();
+    }
+}
+
+// Other than for transport changes, a refresh means the graph was edited, so
+// the frames cached for it are stale.
+void Controller::refreshConsumer(bool invalidate)
 {
+    if (invalidate)
+        m_frameCache.invalidate();
     if (m_consumer) // need to refresh consumer when paused
         m_consumer->set("refresh", 1);
 }
 
 void Controller::saveXML(const QString& filename, Service* service)
 {
-    Consumer c(profile(), "xml", filename.toUtf8().constData());
+    // Saved projects refer to the originals of proxies.
+    QFile file(filename);
+    QString xml = ProxyManager::originalXML(XML(service, QFileInfo(filename).absolutePath()));
+    if (xml.isEmpty() || !file.open(QIODevice::WriteOnly) || file.write(xml.toUtf8()) < 0)
+        qWarning() << "failed to write" << filename;
+}
+
+QString Controller::XML(Service* service, const QString& root)
+{
     Service s(service? service->get_service() : m_producer->get_service());
-    if (s.is_valid()) {
-        int ignore = s.get_int("ignore_points");
-        if (ignore)
-            s.set("ignore_points", 0);
-        c.set("time_format", "clock");
-        c.set("no_meta", 1);
-        c.set("store", "shotcut");
-        c.set("no_root", 1);
-        c.set("root", QFileInfo(filename).absolutePath().toUtf8().constData());
-        c.connect(s);
-        c.start();
-        if (ignore)
-            s.set("ignore_points", ignore);
-    }
+    return XML(profile(), s, root);
 }
 
-QString Controller::XML(Service* service)
+QString Controller::XML(Profile& profile, Service& s, const QString& root)
 {
     static const char* propertyName = "string";
-    Consumer c(profile(), "xml", propertyName);
-    Service s(service? service->get_service() : m_producer->get_service());
+    Consumer c(profile, "xml", propertyName);
     if (!s.is_valid())
         return "";
     int ignore = s.get_int("ignore_points");
@@ -394,6 +625,12 @@ QString Controller::XML(Service* service)
         s.set("ignore_points", 0);
     c.set("no_meta", 1);
     c.set("store", "shotcut");
+    if (!root.isEmpty()) {
+        // Match the output of saveXML() for the given folder.
+        c.set("time_format", "clock");
+        c.set("no_root", 1);
+        c.set("root", root.toUtf8().constData());
+    }
     c.connect(s);
     c.start();
     if (ignore)
@@ -401,6 +638,60 @@ QString Controller::XML(Service* service)
     return QString::fromUtf8(c.get(propertyName));
 }
 
+static void writeConsumer(QXmlStreamWriter& writer, Properties& consumer)
+{
+    writer.writeStartElement("consumer");
+    for (int i = 0; i < consumer.count(); i++) {
+        QString name = QString::fromUtf8(consumer.get_name(i));
+        if (!name.isEmpty() && !name.at(0).isDigit() && consumer.get(i))
+            writer.writeAttribute(name, QString::fromUtf8(consumer.get(i)));
+    }
+    // XML attribute names cannot begin with a digit, which the multi
+    // consumer uses, so write those as property elements.
+    for (int i = 0; i < consumer.count(); i++) {
+        QString name = QString::fromUtf8(consumer.get_name(i));
+        if (!name.isEmpty() && name.at(0).isDigit() && consumer.get(i)) {
+            writer.writeStartElement("property");
+            writer.writeAttribute("name", name);
+            writer.writeCharacters(QString::fromUtf8(consumer.get(i)));
+            writer.writeEndElement();
+        }
+    }
+    writer.writeEndElement();
+}
+
+bool Controller::writeXML(const QString& filename, const QString& xml, Properties* consumer)
+{
+    // Copy the XML to the file in one pass, inserting the consumer element
+    // after the profile.
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QXmlStreamReader reader(xml);
+    QXmlStreamWriter writer(&file);
+    bool isConsumerWritten = !consumer || !consumer->is_valid();
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (!isConsumerWritten && reader.isStartElement() && reader.name() != QLatin1String("profile")
+                && reader.name() != QLatin1String("mlt")) {
+            // There was no profile.
+            writeConsumer(writer, *consumer);
+            isConsumerWritten = true;
+        }
+        writer.writeCurrentToken(reader);
+        if (!isConsumerWritten && reader.isEndElement() && reader.name() == QLatin1String("profile")) {
+            writeConsumer(writer, *consumer);
+            isConsumerWritten = true;
+        }
+    }
+    file.close();
+    if (reader.hasError()) {
+        qWarning() << "failed to write" << filename << reader.errorString();
+        return false;
+    }
+    return true;
+}
+
 int Controller::consumerChanged()
 {
     int error = 0;
@@ -683,17 +974,66 @@ int Controller::realTime() const
 {
     int realtime = 1;
     if (!Settings.playerRealtime()) {
-        if (Settings.playerGPU()) {
+        if (Settings.playerGPU())
             return -1;
-        } else {
-            int threadCount = QThread::idealThreadCount();
-            threadCount = threadCount > 2? qMin(threadCount - 1, 4) : 1;
-            realtime = -threadCount;
-        }
+        else
+            realtime = -renderThreads();
+    } else if (!Settings.playerGPU() && Settings.playerRenderThreads() > 0) {
+        // Frame dropping uses one thread unless chosen otherwise.
+        realtime = renderThreads();
     }
     return realtime;
 }
 
+int Controller::renderThreads() const
+{
+    int threadCount = Settings.playerRenderThreads();
+    if (threadCount <= 0) {
+        // Leave a core for decoding and the UI, and half of them on large
+        // machines where decoding gets threads of its own.
+        threadCount = QThread::idealThreadCount();
+        threadCount = threadCount > 2? qMin(threadCount - 1, qMax(4, threadCount / 2)) : 1;
+    }
+    return threadCount;
+}
+
+// 0 leaves it to the decoder
+int Controller::decodeThreads() const
+{
+    int threadCount = Settings.playerDecodeThreads();
+    if (threadCount <= 0 && QThread::idealThreadCount() > 8)
+        threadCount = qBound(1, QThread::idealThreadCount() / renderThreads(), 4);
+    return qMax(0, threadCount);
+}
+
+// Applies to a video file or to the file of a clip, before it is decoded.
+// The decoder reads this when it opens, so set it before any frame is got.
+void Controller::setDecodeThreads(Producer& producer) const
+{
+    Producer& parent = producer.parent();
+    if (decodeThreads() > 0 && QString(parent.get("mlt_service")).startsWith("avformat"))
+        parent.set("threads", decodeThreads());
+}
+
+// Returns the file of the clip opened again with the decoding threads when
+// it was opened without them, or else 0.
+Producer* Controller::withDecodeThreads(Producer& clip)
+{
+    Producer& parent = clip.parent();
+    if (decodeThreads() <= 0 || !QString(parent.get("mlt_service")).startsWith("avformat")
+            || parent.get_int("threads") == decodeThreads())
+        return 0;
+    // Go through XML to keep the properties and filters of the file.
+    QString xml = XML(&parent);
+    Producer* result = new Producer(profile(), "xml-string", xml.toUtf8().constData());
+    if (!result->is_valid()) {
+        delete result;
+        return 0;
+    }
+    setDecodeThreads(*result);
+    return result;
+}
+
 void Controller::setImageDurationFromDefault(Service* service) const
 {
     if (service && service->is_valid()) {
@@ -23,6 +23,7 @@
 #include <QString>
 #include <Mlt.h>
 #include "transportcontrol.h"
+#include "framecache.h"
 
 // forward declarations
 class QQuickView;
@@ -76,9 +77,11 @@ public:
     double volume() const;
     void onWindowResize();
     virtual void seek(int position);
-    void refreshConsumer();
+    void refreshConsumer(bool invalidate = true);
     void saveXML(const QString& filename, Service* service = 0);
-    QString XML(Service* service = 0);
+    QString XML(Service* service = 0, const QString& root = QString());
+    static QString XML(Profile& profile, Service& service, const QString& root = QString());
+    static bool writeXML(const QString& filename, const QString& xml, Properties* consumer = 0);
     int consumerChanged();
     void setProfile(const QString& profile_name);
     QString resource() const;
@@ -101,7 +104,14 @@ public:
     void updateAvformatCaching(int trackCount);
     bool isAudioFilter(const QString& name);
     int realTime() const;
+    int renderThreads() const;
+    int decodeThreads() const;
+    void setDecodeThreads(Producer& producer) const;
+    Producer* withDecodeThreads(Producer& clip);
     void setImageDurationFromDefault(Service* service) const;
+    void setPreview(Mlt::Producer* preview, Mlt::Producer* source);
+    void setPreviewScale(int divisor);
+    bool hasPreview() const { return m_preview != 0; }
 
     Mlt::Repository* repository() const {
         return m_repo;
@@ -124,12 +134,18 @@ public:
     Mlt::Producer* savedProducer() const {
         return m_savedProducer;
     }
+    FrameCache& frameCache() {
+        return m_frameCache;
+    }
 
 protected:
     Mlt::Repository* m_repo;
     Mlt::Producer* m_producer;
     Mlt::FilteredConsumer* m_consumer;
 
+    void seek(int position, bool refresh);
+    void connectPreview(bool enable);
+
 private:
     Mlt::Profile* m_profile;
     Mlt::Filter* m_jackFilter;
@@ -137,6 +153,10 @@ private:
     double m_volume;
     TransportControl m_transportControl;
     Mlt::Producer* m_savedProducer;
+    FrameCache m_frameCache;
+    Mlt::Producer* m_preview;
+    mlt_producer m_previewSource;
+    bool m_isPreviewing;
 
     static void on_jack_started(mlt_properties owner, void* object, mlt_position *position);
     void onJackStarted(int position);
@@ -23,6 +23,7 @@
 #include "settings.h"
 #include "docks/playlistdock.h"
 #include "util.h"
+#include "proxymanager.h"
 #include <QScopedPointer>
 #include <QThreadPool>
 #include <QPersistentModelIndex>
@@ -46,6 +47,7 @@ static const char* kTimelineScaleProperty = "shotcut:scaleFactor";
 static const char* kShotcutFilterProperty = "shotcut:filter";
 static const char* kShotcutTransitionProperty = "shotcut:transition";
 static const char* kShotcutDefaultTransition = "lumaMix";
+static const int kTransactionResetThreshold = 100;
 
 static void deleteQVariantList(QVariantList* list)
 {
@@ -178,6 +180,12 @@ MultitrackModel::MultitrackModel(QObject *parent)
     : QAbstractItemModel(parent)
     , m_tractor(0)
     , m_isMakingTransition(false)
+    , m_transactionDepth(0)
+    , m_transactionChanges(0)
+    , m_isResetting(false)
+    , m_isModifiedPending(false)
+    , m_pendingSeek(-1)
+    , m_isGraphValid(false)
 {
     connect(this, SIGNAL(modified()), SLOT(adjustBackgroundDuration()));
 }
@@ -388,8 +396,8 @@ void MultitrackModel::setTrackName(int row, const QString &value)
             QModelIndex modelIndex = index(row, 0);
             QVector<int> roles;
             roles << NameRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
         }
     }
 }
@@ -410,8 +418,8 @@ void MultitrackModel::setTrackMute(int row, bool mute)
             QModelIndex modelIndex = index(row, 0);
             QVector<int> roles;
             roles << IsMuteRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
         }
     }
 }
@@ -433,8 +441,8 @@ void MultitrackModel::setTrackHidden(int row, bool hidden)
             QModelIndex modelIndex = index(row, 0);
             QVector<int> roles;
             roles << IsHiddenRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
         }
     }
 }
@@ -456,8 +464,8 @@ void MultitrackModel::setTrackComposite(int row, Qt::CheckState composite)
         QModelIndex modelIndex = index(row, 0);
         QVector<int> roles;
         roles << IsCompositeRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
-        emit modified();
+        notifyDataChanged(modelIndex, modelIndex, roles);
+        notifyModified();
     }
 }
 
@@ -513,7 +521,7 @@ int MultitrackModel::trimClipIn(int trackIndex, int clipIndex, int delta)
         QVector<int> roles;
         roles << DurationRole;
         roles << InPointRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
 
         // Adjust left of the clip.
         if (clipIndex > 0 && playlist.is_blank(clipIndex - 1)) {
@@ -531,7 +539,7 @@ int MultitrackModel::trimClipIn(int trackIndex, int clipIndex, int delta)
                 QModelIndex index = createIndex(clipIndex - 1, 0, trackIndex);
                 QVector<int> roles;
                 roles << DurationRole;
-                emit dataChanged(index, index, roles);
+                notifyDataChanged(index, index, roles);
             }
         } else if (delta > 0) {
 //            qDebug() << "add blank on left duration" << delta - 1;
@@ -540,7 +548,7 @@ int MultitrackModel::trimClipIn(int trackIndex, int clipIndex, int delta)
             endInsertRows();
             ++result;
         }
-        emit modified();
+        notifyModified();
     }
     return result;
 }
@@ -551,7 +559,7 @@ void MultitrackModel::notifyClipIn(int trackIndex, int clipIndex)
         QModelIndex index = createIndex(clipIndex, 0, trackIndex);
         QVector<int> roles;
         roles << AudioLevelsRole;
-        emit dataChanged(index, index, roles);
+        notifyDataChanged(index, index, roles);
     }
     m_isMakingTransition = false;
 }
@@ -629,7 +637,7 @@ int MultitrackModel::trimClipOut(int trackIndex, int clipIndex, int delta)
                 QModelIndex index = createIndex(clipIndex + 1, 0, trackIndex);
                 QVector<int> roles;
                 roles << DurationRole;
-                emit dataChanged(index, index, roles);
+                notifyDataChanged(index, index, roles);
             }
         } else if (delta > 0 && (clipIndex + 1) < playlist.count())  {
             // Add blank to right.
@@ -658,8 +666,8 @@ int MultitrackModel::trimClipOut(int trackIndex, int clipIndex, int delta)
         QVector<int> roles;
         roles << DurationRole;
         roles << OutPointRole;
-        emit dataChanged(index, index, roles);
-        emit modified();
+        notifyDataChanged(index, index, roles);
+        notifyModified();
     }
     return result;
 }
@@ -670,7 +678,7 @@ void MultitrackModel::notifyClipOut(int trackIndex, int clipIndex)
         QModelIndex index = createIndex(clipIndex, 0, trackIndex);
         QVector<int> roles;
         roles << AudioLevelsRole;
-        emit dataChanged(index, index, roles);
+        notifyDataChanged(index, index, roles);
     }
     m_isMakingTransition = false;
 }
@@ -772,7 +780,7 @@ bool MultitrackModel::moveClip(int fromTrack, int toTrack, int clipIndex, int po
                     QVector<int> roles;
                     roles << DurationRole;
                     roles << InPointRole;
-                    emit dataChanged(idx, idx, roles);
+                    notifyDataChanged(idx, idx, roles);
                     if (clipIndex > 0) {
                         QModelIndex parentIndex = index(toTrack);
                         beginMoveRows(parentIndex, clipIndex, clipIndex, parentIndex, 0);
@@ -789,12 +797,15 @@ bool MultitrackModel::moveClip(int fromTrack, int toTrack, int clipIndex, int po
         }
     }
     if (result)
-        emit modified();
+        notifyModified();
     return result;
 }
 
 int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int position)
 {
+    QScopedPointer<Mlt::Producer> producer(editProducer(clip));
+    if (producer)
+        return overwriteClip(trackIndex, *producer, position);
     createIfNeeded();
     int result = -1;
     int i = m_trackList.at(trackIndex).mlt_index;
@@ -836,7 +847,7 @@ int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int posi
                 QModelIndex modelIndex = createIndex(targetIndex, 0, trackIndex);
                 QVector<int> roles;
                 roles << DurationRole;
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
                 QThreadPool::globalInstance()->start(
                     new AudioLevelsTask(clip.parent(), this, modelIndex));
                 ++targetIndex;
@@ -847,7 +858,7 @@ int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int posi
                 QVector<int> roles;
                 roles << InPointRole;
                 roles << DurationRole;
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
             }
         
             // Adjust clip on right.
@@ -859,7 +870,7 @@ int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int posi
                 // Notify clip on right was adjusted.
                 QVector<int> roles;
                 roles << DurationRole;
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
                 QThreadPool::globalInstance()->start(
                     new AudioLevelsTask(clip.parent(), this, modelIndex));
             } else {
@@ -881,17 +892,17 @@ int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int posi
             QModelIndex index = createIndex(result, 0, trackIndex);
             QThreadPool::globalInstance()->start(
                 new AudioLevelsTask(clip.parent(), this, index));
-            emit modified();
-            emit seeked(playlist.clip_start(result) + playlist.clip_length(result));
+            notifyModified();
+            notifySeeked(playlist.clip_start(result) + playlist.clip_length(result));
         }
     }
     return result;
 }
 
-QString MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int position)
+// The clips that were replaced are appended to replaced to restore them.
+void MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int position, Mlt::Playlist& replaced)
 {
     createIfNeeded();
-    Mlt::Playlist result;
     int i = m_trackList.at(trackIndex).mlt_index;
     QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
     if (track) {
@@ -931,7 +942,7 @@ QString MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int posi
             for (; i <= lastIndex; i++) {
                 Mlt::Producer* producer = playlist.get_clip(i);
                 if (producer)
-                    result.append(*producer);
+                    replaced.append(*producer);
                 delete producer;
             }
 
@@ -946,7 +957,7 @@ QString MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int posi
                 QVector<int> roles;
                 roles << InPointRole;
                 roles << DurationRole;
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
             }
 
             int length = clip.get_playtime();
@@ -974,14 +985,16 @@ QString MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int posi
         QModelIndex index = createIndex(targetIndex, 0, trackIndex);
         QThreadPool::globalInstance()->start(
             new AudioLevelsTask(clip.parent(), this, index));
-        emit modified();
-        emit seeked(playlist.clip_start(targetIndex) + playlist.clip_length(targetIndex));
+        notifyModified();
+        notifySeeked(playlist.clip_start(targetIndex) + playlist.clip_length(targetIndex));
     }
-    return MLT.XML(&result);
 }
 
 int MultitrackModel::insertClip(int trackIndex, Mlt::Producer &clip, int position)
 {
+    QScopedPointer<Mlt::Producer> producer(editProducer(clip));
+    if (producer)
+        return insertClip(trackIndex, *producer, position);
     createIfNeeded();
     int result = -1;
     int i = m_trackList.at(trackIndex).mlt_index;
@@ -1021,14 +1034,14 @@ int MultitrackModel::insertClip(int trackIndex, Mlt::Producer &clip, int positio
                 QModelIndex modelIndex = createIndex(targetIndex, 0, trackIndex);
                 QVector<int> roles;
                 roles << DurationRole;
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
                 QThreadPool::globalInstance()->start(
                     new AudioLevelsTask(clip.parent(), this, modelIndex));
                 ++targetIndex;
 
                 // Notify item on right was adjusted.
                 modelIndex = createIndex(targetIndex, 0, trackIndex);
-                emit dataChanged(modelIndex, modelIndex, roles);
+                notifyDataChanged(modelIndex, modelIndex, roles);
                 QThreadPool::globalInstance()->start(
                     new AudioLevelsTask(clip.parent(), this, modelIndex));
             }
@@ -1050,8 +1063,8 @@ int MultitrackModel::insertClip(int trackIndex, Mlt::Producer &clip, int positio
             QModelIndex index = createIndex(result, 0, trackIndex);
             QThreadPool::globalInstance()->start(
                 new AudioLevelsTask(clip.parent(), this, index));
-            emit modified();
-            emit seeked(playlist.clip_start(result) + playlist.clip_length(result));
+            notifyModified();
+            notifySeeked(playlist.clip_start(result) + playlist.clip_length(result));
         }
     }
     return result;
@@ -1059,6 +1072,9 @@ int MultitrackModel::insertClip(int trackIndex, Mlt::Producer &clip, int positio
 
 int MultitrackModel::appendClip(int trackIndex, Mlt::Producer &clip)
 {
+    QScopedPointer<Mlt::Producer> producer(editProducer(clip));
+    if (producer)
+        return appendClip(trackIndex, *producer);
     if (!createIfNeeded()) {
         return -1;
     }
@@ -1077,8 +1093,8 @@ int MultitrackModel::appendClip(int trackIndex, Mlt::Producer &clip)
         QModelIndex index = createIndex(i, 0, trackIndex);
         QThreadPool::globalInstance()->start(
             new AudioLevelsTask(clip.parent(), this, index));
-        emit modified();
-        emit seeked(playlist.clip_start(i) + playlist.clip_length(i));
+        notifyModified();
+        notifySeeked(playlist.clip_start(i) + playlist.clip_length(i));
         return i;
     }
     return -1;
@@ -1101,7 +1117,7 @@ void MultitrackModel::removeClip(int trackIndex, int clipIndex)
             playlist.remove(clipIndex);
             endRemoveRows();
             consolidateBlanks(playlist, trackIndex);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -1127,11 +1143,11 @@ void MultitrackModel::liftClip(int trackIndex, int clipIndex)
             roles << ServiceRole;
             roles << IsBlankRole;
             roles << IsTransitionRole;
-            emit dataChanged(index, index, roles);
+            notifyDataChanged(index, index, roles);
 
             consolidateBlanks(playlist, trackIndex);
 
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -1177,7 +1193,7 @@ void MultitrackModel::splitClip(int trackIndex, int clipIndex, int position)
         roles << DurationRole;
         roles << OutPointRole;
         roles << FadeOutRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
         QThreadPool::globalInstance()->start(
             new AudioLevelsTask(clip->parent(), this, modelIndex));
 
@@ -1192,7 +1208,7 @@ void MultitrackModel::splitClip(int trackIndex, int clipIndex, int position)
             QThreadPool::globalInstance()->start(
                 new AudioLevelsTask(producer.parent(), this, modelIndex));
         }
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -1227,7 +1243,7 @@ void MultitrackModel::joinClips(int trackIndex, int clipIndex)
         roles << DurationRole;
         roles << OutPointRole;
         roles << FadeOutRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
         QThreadPool::globalInstance()->start(
             new AudioLevelsTask(clip->parent(), this, modelIndex));
 
@@ -1235,7 +1251,7 @@ void MultitrackModel::joinClips(int trackIndex, int clipIndex)
         playlist.remove(clipIndex + 1);
         endRemoveRows();
 
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -1245,6 +1261,7 @@ void MultitrackModel::appendFromPlaylist(Mlt::Playlist *from, int trackIndex)
     int i = m_trackList.at(trackIndex).mlt_index;
     QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
     if (track) {
+        beginTransaction();
         Mlt::Playlist playlist(*track);
         removeBlankPlaceholder(playlist, trackIndex);
         i = playlist.count();
@@ -1254,14 +1271,17 @@ void MultitrackModel::appendFromPlaylist(Mlt::Playlist *from, int trackIndex)
             int in = clip->get_in();
             int out = clip->get_out();
             clip->set_in_and_out(0, clip->get_length() - 1);
-            playlist.append(clip->parent(), in, out);
+            QScopedPointer<Mlt::Producer> producer(editProducer(*clip));
+            Mlt::Producer& source = producer? *producer : clip->parent();
+            playlist.append(source, in, out);
             QModelIndex modelIndex = createIndex(i, 0, trackIndex);
             QThreadPool::globalInstance()->start(
-                new AudioLevelsTask(clip->parent(), this, modelIndex));
+                new AudioLevelsTask(source, this, modelIndex));
         }
         endInsertRows();
-        emit modified();
-        emit seeked(playlist.get_playtime());
+        notifyModified();
+        notifySeeked(playlist.get_playtime());
+        commitTransaction();
     }
 }
 
@@ -1270,6 +1290,7 @@ void MultitrackModel::overwriteFromPlaylist(Mlt::Playlist& from, int trackIndex,
     int i = m_trackList.at(trackIndex).mlt_index;
     QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
     if (track) {
+        beginTransaction();
         Mlt::Playlist playlist(*track);
         int targetIndex = playlist.get_clip_index_at(position);
         if (targetIndex > 0) {
@@ -1291,24 +1312,26 @@ void MultitrackModel::overwriteFromPlaylist(Mlt::Playlist& from, int trackIndex,
         if (from.count() > 0) {
             beginInsertRows(index(trackIndex), targetIndex, targetIndex + from.count() - 1);
             for (int i = 0; i < from.count(); i++) {
-                QScopedPointer<Mlt::Producer> clip(from.get_clip(i));
-                if (clip->is_blank()) {
-                    playlist.insert_blank(targetIndex, clip->get_out());
+                // The clips may share their cuts with the track, which were
+                // trimmed since, so use the in and out points of the entries.
+                QScopedPointer<Mlt::ClipInfo> info(from.clip_info(i));
+                if (info->cut->is_blank()) {
+                    playlist.insert_blank(targetIndex, info->frame_count - 1);
                 } else {
-                    playlist.insert(*clip, targetIndex);
+                    playlist.insert(*info->producer, targetIndex, info->frame_in, info->frame_out);
                     QModelIndex modelIndex = createIndex(targetIndex, 0, trackIndex);
                     QThreadPool::globalInstance()->start(
-                        new AudioLevelsTask(clip->parent(), this, modelIndex));
+                        new AudioLevelsTask(*info->producer, this, modelIndex));
                 }
                 ++targetIndex;
             }
             endInsertRows();
         }
         consolidateBlanks(playlist, trackIndex);
-        emit modified();
-        emit seeked(position + playlist.get_playtime());
+        notifyModified();
+        notifySeeked(position + playlist.get_playtime());
+        commitTransaction();
     }
-    
 }
 
 void MultitrackModel::fadeIn(int trackIndex, int clipIndex, int duration)
@@ -1380,8 +1403,8 @@ void MultitrackModel::fadeIn(int trackIndex, int clipIndex, int duration)
             QModelIndex modelIndex = createIndex(clipIndex, 0, trackIndex);
             QVector<int> roles;
             roles << FadeInRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
         }
     }
 }
@@ -1455,8 +1478,8 @@ void MultitrackModel::fadeOut(int trackIndex, int clipIndex, int duration)
             QModelIndex modelIndex = createIndex(clipIndex, 0, trackIndex);
             QVector<int> roles;
             roles << FadeOutRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
         }
     }
 }
@@ -1522,14 +1545,14 @@ int MultitrackModel::addTransition(int trackIndex, int clipIndex, int position)
             roles << StartRole;
             roles << OutPointRole;
             roles << DurationRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
+            notifyDataChanged(modelIndex, modelIndex, roles);
             modelIndex = createIndex(targetIndex + 2, 0, trackIndex);
             roles.clear();
             roles << StartRole;
             roles << InPointRole;
             roles << DurationRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
             return targetIndex + 1;
         }
     }
@@ -1552,12 +1575,12 @@ void MultitrackModel::removeTransition(int trackIndex, int clipIndex)
         QVector<int> roles;
         roles << OutPointRole;
         roles << DurationRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
         modelIndex = createIndex(clipIndex + 1, 0, trackIndex);
         roles << InPointRole;
         roles << DurationRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
-        emit modified();
+        notifyDataChanged(modelIndex, modelIndex, roles);
+        notifyModified();
     }
 }
 
@@ -1628,9 +1651,9 @@ void MultitrackModel::trimTransitionIn(int trackIndex, int clipIndex, int delta)
         QVector<int> roles;
         roles << OutPointRole;
         roles << DurationRole;
-        emit dataChanged(createIndex(clipIndex, 0, trackIndex),
-                         createIndex(clipIndex + 1, 0, trackIndex), roles);
-        emit modified();
+        notifyDataChanged(createIndex(clipIndex, 0, trackIndex),
+                          createIndex(clipIndex + 1, 0, trackIndex), roles);
+        notifyModified();
     }
 }
 
@@ -1702,14 +1725,14 @@ void MultitrackModel::trimTransitionOut(int trackIndex, int clipIndex, int delta
         QVector<int> roles;
         roles << OutPointRole;
         roles << DurationRole;
-        emit dataChanged(createIndex(clipIndex - 1, 0, trackIndex),
-                         createIndex(clipIndex - 1, 0, trackIndex), roles);
+        notifyDataChanged(createIndex(clipIndex - 1, 0, trackIndex),
+                          createIndex(clipIndex - 1, 0, trackIndex), roles);
         roles.clear();
         roles << InPointRole;
         roles << DurationRole;
-        emit dataChanged(createIndex(clipIndex, 0, trackIndex),
-                         createIndex(clipIndex, 0, trackIndex), roles);
-        emit modified();
+        notifyDataChanged(createIndex(clipIndex, 0, trackIndex),
+                          createIndex(clipIndex, 0, trackIndex), roles);
+        notifyModified();
     }
 }
 
@@ -1763,8 +1786,8 @@ void MultitrackModel::addTransitionByTrimIn(int trackIndex, int clipIndex, int d
             QVector<int> roles;
             roles << OutPointRole;
             roles << DurationRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
             m_isMakingTransition = true;
         } else if (m_isMakingTransition) {
             // Adjust a transition addition already in progress.
@@ -1825,8 +1848,8 @@ void MultitrackModel::addTransitionByTrimOut(int trackIndex, int clipIndex, int
             QVector<int> roles;
             roles << InPointRole;
             roles << DurationRole;
-            emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyDataChanged(modelIndex, modelIndex, roles);
+            notifyModified();
             m_isMakingTransition = true;
         } else if (m_isMakingTransition) {
             // Adjust a transition addition already in progress.
@@ -1886,7 +1909,7 @@ void MultitrackModel::moveClipToEnd(Mlt::Playlist& playlist, int trackIndex, int
         QModelIndex index = createIndex(clipIndex - 1, 0, trackIndex);
         QVector<int> roles;
         roles << DurationRole;
-        emit dataChanged(index, index, roles);
+        notifyDataChanged(index, index, roles);
     } else if ((clipIndex + 1) < n && playlist.is_blank(clipIndex + 1)) {
         // If there was a blank on the right adjust it.
         int duration = playlist.clip_length(clipIndex + 1) + playlist.clip_length(clipIndex);
@@ -1896,7 +1919,7 @@ void MultitrackModel::moveClipToEnd(Mlt::Playlist& playlist, int trackIndex, int
         QModelIndex index = createIndex(clipIndex + 1, 0, trackIndex);
         QVector<int> roles;
         roles << DurationRole;
-        emit dataChanged(index, index, roles);
+        notifyDataChanged(index, index, roles);
     } else {
         // Add new blank
         beginInsertRows(index(trackIndex), clipIndex, clipIndex);
@@ -1936,7 +1959,7 @@ void MultitrackModel::relocateClip(Mlt::Playlist& playlist, int trackIndex, int
         QModelIndex modelIndex = createIndex(targetIndex, 0, trackIndex);
         QVector<int> roles;
         roles << DurationRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
         ++targetIndex;
     }
 
@@ -1949,7 +1972,7 @@ void MultitrackModel::relocateClip(Mlt::Playlist& playlist, int trackIndex, int
         QModelIndex modelIndex = createIndex(targetIndex, 0, trackIndex);
         QVector<int> roles;
         roles << DurationRole;
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyDataChanged(modelIndex, modelIndex, roles);
     } else {
 //        qDebug() << "remove blank on right";
         beginRemoveRows(index(trackIndex), targetIndex, targetIndex);
@@ -1994,7 +2017,7 @@ void MultitrackModel::moveClipInBlank(Mlt::Playlist& playlist, int trackIndex, i
             QModelIndex index = createIndex(clipIndex - 1, 0, trackIndex);
             QVector<int> roles;
             roles << DurationRole;
-            emit dataChanged(index, index, roles);
+            notifyDataChanged(index, index, roles);
         } else {
 //            qDebug() << "remove blank on left";
             int i = clipIndex - 1;
@@ -2024,7 +2047,7 @@ void MultitrackModel::moveClipInBlank(Mlt::Playlist& playlist, int trackIndex, i
             QModelIndex index = createIndex(clipIndex + 1, 0, trackIndex);
             QVector<int> roles;
             roles << DurationRole;
-            emit dataChanged(index, index, roles);
+            notifyDataChanged(index, index, roles);
         } else {
 //            qDebug() << "remove blank on right";
             int i = clipIndex + 1;
@@ -2051,7 +2074,7 @@ void MultitrackModel::consolidateBlanks(Mlt::Playlist &playlist, int trackIndex)
             QModelIndex idx = createIndex(i - 1, 0, trackIndex);
             QVector<int> roles;
             roles << DurationRole;
-            emit dataChanged(idx, idx, roles);
+            notifyDataChanged(idx, idx, roles);
             beginRemoveRows(index(trackIndex), i, i);
             playlist.remove(i--);
             endRemoveRows();
@@ -2076,6 +2099,7 @@ void MultitrackModel::consolidateBlanksAllTracks()
 {
     if (!m_tractor) return;
     int i = 0;
+    beginTransaction();
     foreach (Track t, m_trackList) {
         Mlt::Producer* track = m_tractor->track(t.mlt_index);
         if (track) {
@@ -2084,13 +2108,14 @@ void MultitrackModel::consolidateBlanksAllTracks()
         }
         ++i;
     }
+    commitTransaction();
 }
 
 void MultitrackModel::audioLevelsReady(const QModelIndex& index)
 {
     QVector<int> roles;
     roles << AudioLevelsRole;
-    emit dataChanged(index, index, roles);
+    notifyDataChanged(index, index, roles);
 }
 
 bool MultitrackModel::createIfNeeded()
@@ -2264,6 +2289,255 @@ void MultitrackModel::loadPlaylist()
     retainPlaylist();
 }
 
+// Edits made until the transaction is committed are followed by one
+// modified() signal, so that the background is adjusted once. Small edits
+// still announce their rows, but once a transaction makes more changes than
+// the views can follow cheaply, the rest is announced as one reset of the
+// model. Transactions may be nested.
+void MultitrackModel::beginTransaction()
+{
+    if (m_transactionDepth++ == 0) {
+        m_transactionChanges = 0;
+        m_isResetting = false;
+        m_isModifiedPending = false;
+        m_pendingSeek = -1;
+    }
+}
+
+void MultitrackModel::commitTransaction()
+{
+    Q_ASSERT(m_transactionDepth > 0);
+    if (--m_transactionDepth == 0) {
+        if (m_isResetting) {
+            m_isResetting = false;
+            QAbstractItemModel::endResetModel();
+        }
+        if (m_isModifiedPending)
+            emit modified();
+        if (m_pendingSeek >= 0)
+            emit seeked(m_pendingSeek);
+    }
+}
+
+// Announces the rest of the transaction as one reset of the model. Nothing
+// is half done between changes, so the reset can begin at any of them.
+void MultitrackModel::resetInTransaction()
+{
+    if (m_transactionDepth && !m_isResetting) {
+        QAbstractItemModel::beginResetModel();
+        m_isResetting = true;
+    }
+}
+
+// Returns whether a change that is about to be made should be announced.
+// Any change also makes the graph of the tracks out of date.
+bool MultitrackModel::isNotifying()
+{
+    m_isGraphValid = false;
+    if (m_transactionDepth && !m_isResetting && ++m_transactionChanges > kTransactionResetThreshold)
+        resetInTransaction();
+    return !m_isResetting;
+}
+
+void MultitrackModel::beginInsertRows(const QModelIndex& parent, int first, int last)
+{
+    if (isNotifying())
+        QAbstractItemModel::beginInsertRows(parent, first, last);
+}
+
+void MultitrackModel::endInsertRows()
+{
+    if (!m_isResetting)
+        QAbstractItemModel::endInsertRows();
+}
+
+void MultitrackModel::beginRemoveRows(const QModelIndex& parent, int first, int last)
+{
+    if (isNotifying())
+        QAbstractItemModel::beginRemoveRows(parent, first, last);
+}
+
+void MultitrackModel::endRemoveRows()
+{
+    if (!m_isResetting)
+        QAbstractItemModel::endRemoveRows();
+}
+
+bool MultitrackModel::beginMoveRows(const QModelIndex& sourceParent, int sourceFirst, int sourceLast,
+                                    const QModelIndex& destinationParent, int destinationRow)
+{
+    if (!isNotifying())
+        return true;
+    return QAbstractItemModel::beginMoveRows(sourceParent, sourceFirst, sourceLast,
+                                             destinationParent, destinationRow);
+}
+
+void MultitrackModel::endMoveRows()
+{
+    if (!m_isResetting)
+        QAbstractItemModel::endMoveRows();
+}
+
+void MultitrackModel::notifyDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                        const QVector<int>& roles)
+{
+    if (isNotifying())
+        emit dataChanged(topLeft, bottomRight, roles);
+}
+
+void MultitrackModel::notifyModified()
+{
+    if (m_transactionDepth)
+        m_isModifiedPending = true;
+    else
+        emit modified();
+}
+
+void MultitrackModel::notifySeeked(int position)
+{
+    if (m_transactionDepth)
+        m_pendingSeek = position;
+    else
+        emit seeked(position);
+}
+
+TimelineGraph MultitrackModel::graph() const
+{
+    TimelineGraph result;
+    if (!m_tractor)
+        return result;
+    if (m_isGraphValid)
+        return m_graph;
+    foreach (Track t, m_trackList) {
+        TimelineGraph::ClipList clips;
+        QScopedPointer<Mlt::Producer> track(m_tractor->track(t.mlt_index));
+        if (track) {
+            Mlt::Playlist playlist(*track);
+            int n = playlist.count();
+            clips.reserve(n);
+            for (int i = 0; i < n; i++) {
+                if (playlist.is_blank(i))
+                    continue;
+                QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(i));
+                if (!info)
+                    continue;
+                TimelineGraph::Clip clip;
+                clip.index = i;
+                clip.start = info->start;
+                clip.in = info->frame_in;
+                clip.out = info->frame_out;
+                clip.length = info->length;
+                clip.isTransition = info->producer && info->producer->get(kShotcutTransitionProperty);
+                clips << clip;
+            }
+        }
+        result.appendTrack(clips);
+    }
+    m_graph = result;
+    m_isGraphValid = true;
+    return result;
+}
+
+// Changes the tracks to match graph, given that they match from now. Only the
+// tracks that differ are visited, and on those only the clips whose in or out
+// point changed are resized and the blanks between clips adjusted. The graph
+// of the result is kept for the next edit, such as the next step of a drag.
+void MultitrackModel::applyGraph(const TimelineGraph& graph, const TimelineGraph& from)
+{
+    if (!m_tractor)
+        return;
+    // Tracks that are not visited keep their entries in the current graph.
+    bool isGraphValid = m_isGraphValid;
+    TimelineGraph result(isGraphValid? m_graph : graph);
+    int trackCount = qMin(m_trackList.count(), graph.trackCount());
+    for (int trackIndex = 0; trackIndex < trackCount; trackIndex++) {
+        const TimelineGraph::ClipList& clips = graph.track(trackIndex);
+        if (trackIndex < from.trackCount() && clips == from.track(trackIndex))
+            continue;
+        int i = m_trackList.at(trackIndex).mlt_index;
+        QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
+        if (!track)
+            continue;
+        Mlt::Playlist playlist(*track);
+        TimelineGraph::ClipList entries(clips);
+        int entry = 0;
+        int position = 0;
+        for (int c = 0; c < clips.count(); c++) {
+            const TimelineGraph::Clip& clip = clips.at(c);
+            int gap = clip.start - position;
+            if (entry < playlist.count() && playlist.is_blank(entry)) {
+                while (entry + 1 < playlist.count() && playlist.is_blank(entry + 1)) {
+                    beginRemoveRows(index(trackIndex), entry + 1, entry + 1);
+                    playlist.remove(entry + 1);
+                    endRemoveRows();
+                }
+                if (gap > 0) {
+                    if (playlist.clip_length(entry) != gap) {
+                        playlist.resize_clip(entry, 0, gap - 1);
+                        QModelIndex modelIndex = createIndex(entry, 0, trackIndex);
+                        QVector<int> roles;
+                        roles << DurationRole;
+                        notifyDataChanged(modelIndex, modelIndex, roles);
+                    }
+                    ++entry;
+                } else {
+                    beginRemoveRows(index(trackIndex), entry, entry);
+                    playlist.remove(entry);
+                    endRemoveRows();
+                }
+            } else if (gap > 0) {
+                beginInsertRows(index(trackIndex), entry, entry);
+                playlist.insert_blank(entry, gap - 1);
+                endInsertRows();
+                ++entry;
+            }
+
+            QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(entry));
+            if (info && (info->frame_in != clip.in || info->frame_out != clip.out)) {
+                playlist.resize_clip(entry, clip.in, clip.out);
+
+                // Adjust all filters that have an explicit duration.
+                int n = info->producer->filter_count();
+                for (int j = 0; j < n; j++) {
+                    Mlt::Filter* filter = info->producer->filter(j);
+                    if (filter && filter->is_valid() && filter->get_length() > 0) {
+                        QString name(filter->get(kShotcutFilterProperty));
+                        if (name.startsWith("fadeIn"))
+                            filter->set_in_and_out(clip.in, clip.in + filter->get_length() - 1);
+                        else if (name.startsWith("fadeOut"))
+                            filter->set_in_and_out(clip.out - filter->get_length() + 1, clip.out);
+                    }
+                    delete filter;
+                }
+
+                QModelIndex modelIndex = createIndex(entry, 0, trackIndex);
+                QVector<int> roles;
+                roles << DurationRole;
+                roles << InPointRole;
+                roles << OutPointRole;
+                notifyDataChanged(modelIndex, modelIndex, roles);
+            }
+            entries[c].index = entry;
+            ++entry;
+            position = clip.end();
+        }
+        result.setTrack(trackIndex, entries);
+        // Nothing but blanks can follow the last clip.
+        if (!clips.isEmpty()) {
+            while (entry < playlist.count() && playlist.is_blank(entry)) {
+                beginRemoveRows(index(trackIndex), entry, entry);
+                playlist.remove(entry);
+                endRemoveRows();
+            }
+        }
+    }
+    if (isGraphValid && result.trackCount() == m_trackList.count()) {
+        m_graph = result;
+        m_isGraphValid = true;
+    }
+    notifyModified();
+}
+
 bool MultitrackModel::isTransition(Mlt::Playlist &playlist, int clipIndex) const
 {
     QScopedPointer<Mlt::Producer> producer(playlist.get_clip(clipIndex));
@@ -2279,6 +2553,7 @@ void MultitrackModel::load()
         delete m_tractor;
         m_tractor = 0;
         m_trackList.clear();
+        m_isGraphValid = false;
         endResetModel();
     }
     // In some versions of MLT, the resource property is the XML filename,
@@ -2295,18 +2570,51 @@ void MultitrackModel::load()
         return;
     }
 
+    // The tracks are listed without announcing them.
+    beginTransaction();
+    resetInTransaction();
     loadPlaylist();
     addBlackTrackIfNeeded();
     refreshTrackList();
+    setDecodeThreads();
     convertOldDoc();
     consolidateBlanksAllTracks();
     adjustBackgroundDuration();
     getAudioLevels();
-    beginInsertRows(QModelIndex(), 0, m_trackList.count() - 1);
-    endInsertRows();
+    commitTransaction();
     emit loaded();
 }
 
+// The xml producer does not apply the decoding threads setting.
+void MultitrackModel::setDecodeThreads()
+{
+    foreach (Track t, m_trackList) {
+        QScopedPointer<Mlt::Producer> track(m_tractor->track(t.mlt_index));
+        if (!track || track->type() != playlist_type)
+            continue;
+        Mlt::Playlist playlist(*track);
+        for (int i = 0; i < playlist.count(); i++) {
+            QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+            if (clip && clip->is_valid() && !clip->is_blank())
+                MLT.setDecodeThreads(*clip);
+        }
+    }
+}
+
+// Returns what to edit with instead of the clip: the proxy of its file when
+// there is one, or its file opened again with the decoding threads, or 0.
+Mlt::Producer* MultitrackModel::editProducer(Mlt::Producer& clip)
+{
+    Mlt::Producer* result = ProxyManager::proxied(MLT.profile(), clip);
+    if (result)
+        MLT.setDecodeThreads(*result);
+    else
+        result = MLT.withDecodeThreads(clip);
+    if (result)
+        result->set_in_and_out(clip.get_in(), clip.get_out());
+    return result;
+}
+
 void MultitrackModel::reload()
 {
     if (m_tractor) {
@@ -24,6 +24,7 @@
 #include <QString>
 #include <MltTractor.h>
 #include <MltPlaylist.h>
+#include "timelinegraph.h"
 
 typedef enum {
     PlaylistTrackType = 0,
@@ -98,6 +99,10 @@ public:
     double scaleFactor() const;
     void setScaleFactor(double scale);
     bool isTransition(Mlt::Playlist& playlist, int clipIndex) const;
+    void beginTransaction();
+    void commitTransaction();
+    TimelineGraph graph() const;
+    void applyGraph(const TimelineGraph& graph, const TimelineGraph& from);
 
 signals:
     void created();
@@ -121,7 +126,7 @@ public slots:
     bool moveClipValid(int fromTrack, int toTrack, int clipIndex, int position);
     bool moveClip(int fromTrack, int toTrack, int clipIndex, int position);
     int overwriteClip(int trackIndex, Mlt::Producer& clip, int position);
-    QString overwrite(int trackIndex, Mlt::Producer& clip, int position);
+    void overwrite(int trackIndex, Mlt::Producer& clip, int position, Mlt::Playlist& replaced);
     int insertClip(int trackIndex, Mlt::Producer& clip, int position);
     int appendClip(int trackIndex, Mlt::Producer &clip);
     void removeClip(int trackIndex, int clipIndex);
@@ -148,6 +153,31 @@ private:
     Mlt::Tractor* m_tractor;
     TrackList m_trackList;
     bool m_isMakingTransition;
+    int m_transactionDepth;
+    int m_transactionChanges;
+    bool m_isResetting;
+    bool m_isModifiedPending;
+    int m_pendingSeek;
+    // The graph of the tracks is kept from one edit to the next unless
+    // something else changes them.
+    mutable TimelineGraph m_graph;
+    mutable bool m_isGraphValid;
+
+    // These hold back notifications during a transaction that has become a
+    // reset of the model.
+    void resetInTransaction();
+    bool isNotifying();
+    void beginInsertRows(const QModelIndex& parent, int first, int last);
+    void endInsertRows();
+    void beginRemoveRows(const QModelIndex& parent, int first, int last);
+    void endRemoveRows();
+    bool beginMoveRows(const QModelIndex& sourceParent, int sourceFirst, int sourceLast,
+                       const QModelIndex& destinationParent, int destinationRow);
+    void endMoveRows();
+    void notifyDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                           const QVector<int>& roles = QVector<int>());
+    void notifyModified();
+    void notifySeeked(int position);
 
     bool moveClipToTrack(int fromTrack, int toTrack, int clipIndex, int position);
     void moveClipToEnd(Mlt::Playlist& playlist, int trackIndex, int clipIndex, int position);
@@ -158,6 +188,8 @@ private:
     void getAudioLevels();
     void addBlackTrackIfNeeded();
     void convertOldDoc();
+    void setDecodeThreads();
+    Mlt::Producer* editProducer(Mlt::Producer& clip);
     Mlt::Transition* getTransition(const QString& name, int trackIndex) const;
     Mlt::Filter* getFilter(const QString& name, int trackIndex) const;
     Mlt::Filter* getFilter(const QString& name, Mlt::Service* service) const;
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timelinegraph.h"
+#include <algorithm>
+
+static bool startsBefore(const TimelineGraph::Clip& clip, int position)
+{
+    return clip.start < position;
+}
+
+bool TimelineGraph::Clip::operator==(const Clip& other) const
+{
+    return start == other.start && in == other.in && out == other.out;
+}
+
+bool TimelineGraph::edit(Edit edit, int trackIndex, int clipIndex, int delta)
+{
+    switch (edit) {
+    case RippleTrimIn:
+        return rippleTrimIn(trackIndex, clipIndex, delta);
+    case RippleTrimOut:
+        return rippleTrimOut(trackIndex, clipIndex, delta);
+    case Roll:
+        return roll(trackIndex, clipIndex, delta);
+    case Slip:
+        return slip(trackIndex, clipIndex, delta);
+    case Slide:
+        return slide(trackIndex, clipIndex, delta);
+    }
+    return false;
+}
+
+// Like MultitrackModel::trimClipIn(), a positive delta makes the clip shorter.
+// Everything after the clip on all tracks moves by the same amount.
+bool TimelineGraph::rippleTrimIn(int trackIndex, int clipIndex, int delta)
+{
+    int i = find(trackIndex, clipIndex);
+    if (i < 0 || !delta || isLocked(trackIndex, i))
+        return false;
+    const Clip& clip = m_tracks.at(trackIndex).at(i);
+    int in = clip.in + delta;
+    int position = clip.end();
+    if (in < 0 || in > clip.out || !canRipple(trackIndex, position, -delta))
+        return false;
+    m_tracks[trackIndex][i].in = in;
+    ripple(position, -delta);
+    return true;
+}
+
+bool TimelineGraph::rippleTrimOut(int trackIndex, int clipIndex, int delta)
+{
+    int i = find(trackIndex, clipIndex);
+    if (i < 0 || !delta || isLocked(trackIndex, i))
+        return false;
+    const Clip& clip = m_tracks.at(trackIndex).at(i);
+    int out = clip.out - delta;
+    int position = clip.end();
+    if (out < clip.in || out >= clip.length || !canRipple(trackIndex, position, -delta))
+        return false;
+    m_tracks[trackIndex][i].out = out;
+    ripple(position, -delta);
+    return true;
+}
+
+// Moves the edit point between the clip and the one that follows it without a
+// gap. Nothing else moves.
+bool TimelineGraph::roll(int trackIndex, int clipIndex, int delta)
+{
+    int i = find(trackIndex, clipIndex);
+    if (i < 0 || i + 1 >= m_tracks.at(trackIndex).count() || !delta
+            || isLocked(trackIndex, i) || isLocked(trackIndex, i + 1))
+        return false;
+    const Clip& clip = m_tracks.at(trackIndex).at(i);
+    const Clip& next = m_tracks.at(trackIndex).at(i + 1);
+    int out = clip.out + delta;
+    int in = next.in + delta;
+    if (clip.end() != next.start || out < clip.in || out >= clip.length || in < 0 || in > next.out)
+        return false;
+    ClipList& clips = m_tracks[trackIndex];
+    clips[i].out = out;
+    clips[i + 1].in = in;
+    clips[i + 1].start += delta;
+    return true;
+}
+
+// Shows a different part of the source in the same place.
+bool TimelineGraph::slip(int trackIndex, int clipIndex, int delta)
+{
+    int i = find(trackIndex, clipIndex);
+    if (i < 0 || !delta || isLocked(trackIndex, i))
+        return false;
+    const Clip& clip = m_tracks.at(trackIndex).at(i);
+    if (clip.in + delta < 0 || clip.out + delta >= clip.length)
+        return false;
+    Clip& changed = m_tracks[trackIndex][i];
+    changed.in += delta;
+    changed.out += delta;
+    return true;
+}
+
+// Moves the clip, trimming the clips next to it to keep the track the same
+// length. A gap next to the clip is used before giving up.
+bool TimelineGraph::slide(int trackIndex, int clipIndex, int delta)
+{
+    int i = find(trackIndex, clipIndex);
+    if (i < 0 || !delta || isLocked(trackIndex, i))
+        return false;
+    const ClipList& clips = m_tracks.at(trackIndex);
+    const Clip& clip = clips.at(i);
+    if (clip.start + delta < 0)
+        return false;
+    bool isPreviousTrimmed = false;
+    bool isNextTrimmed = false;
+    if (i > 0) {
+        const Clip& previous = clips.at(i - 1);
+        if (previous.end() == clip.start) {
+            int out = previous.out + delta;
+            if (out < previous.in || out >= previous.length)
+                return false;
+            isPreviousTrimmed = true;
+        } else if (clip.start + delta < previous.end()) {
+            return false;
+        }
+    }
+    if (i + 1 < clips.count()) {
+        const Clip& next = clips.at(i + 1);
+        if (clip.end() == next.start) {
+            int in = next.in + delta;
+            if (in < 0 || in > next.out)
+                return false;
+            isNextTrimmed = true;
+        } else if (clip.end() + delta > next.start) {
+            return false;
+        }
+    }
+    ClipList& changed = m_tracks[trackIndex];
+    changed[i].start += delta;
+    if (isPreviousTrimmed)
+        changed[i - 1].out += delta;
+    if (isNextTrimmed) {
+        changed[i + 1].in += delta;
+        changed[i + 1].start += delta;
+    }
+    return true;
+}
+
+int TimelineGraph::find(int trackIndex, int clipIndex) const
+{
+    if (trackIndex < 0 || trackIndex >= m_tracks.count())
+        return -1;
+    const ClipList& clips = m_tracks.at(trackIndex);
+    int low = 0;
+    int high = clips.count() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (clips.at(middle).index < clipIndex)
+            low = middle + 1;
+        else if (clips.at(middle).index > clipIndex)
+            high = middle - 1;
+        else
+            return middle;
+    }
+    return -1;
+}
+
+// Transitions and the clips that make them up are left to the transition
+// edits of MultitrackModel.
+bool TimelineGraph::isLocked(int trackIndex, int i) const
+{
+    const ClipList& clips = m_tracks.at(trackIndex);
+    const Clip& clip = clips.at(i);
+    if (clip.isTransition)
+        return true;
+    if (i > 0 && clips.at(i - 1).isTransition && clips.at(i - 1).end() == clip.start)
+        return true;
+    if (i + 1 < clips.count() && clips.at(i + 1).isTransition && clip.end() == clips.at(i + 1).start)
+        return true;
+    return false;
+}
+
+// Time can only be removed from the other tracks where they have a gap, and
+// it can only be added between clips.
+bool TimelineGraph::canRipple(int trackIndex, int position, int delta) const
+{
+    for (int t = 0; t < m_tracks.count(); t++) {
+        if (t == trackIndex)
+            continue;
+        const ClipList& clips = m_tracks.at(t);
+        // Only the last clip to start before the position can be in the way.
+        ClipList::const_iterator it = std::lower_bound(clips.constBegin(), clips.constEnd(), position, startsBefore);
+        if (it != clips.constBegin()) {
+            const Clip& previous = *(it - 1);
+            if (previous.end() > qMin(position, position + delta))
+                return false;
+        }
+    }
+    return true;
+}
+
+void TimelineGraph::ripple(int position, int delta)
+{
+    for (int t = 0; t < m_tracks.count(); t++) {
+        ClipList& clips = m_tracks[t];
+        ClipList::iterator it = std::lower_bound(clips.begin(), clips.end(), position, startsBefore);
+        for (; it != clips.end(); ++it)
+            it->start += delta;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMELINEGRAPH_H
+#define TIMELINEGRAPH_H
+
+#include <QVector>
+
+// A copy of the timeline that keeps only where the clips are and their in and
+// out points, sorted by position on each track. Edits that change many clips
+// at once, such as a ripple across all tracks, are worked out and checked here
+// in one pass, and then MultitrackModel::applyGraph() changes only the MLT
+// playlist entries that differ. The edits never add, remove or reorder clips.
+class TimelineGraph
+{
+public:
+    struct Clip {
+        int index;  // in the playlist the graph was made from
+        int start;
+        int in;
+        int out;
+        int length; // of the source
+        bool isTransition;
+
+        int duration() const { return out - in + 1; }
+        int end() const { return start + duration(); }
+        bool operator==(const Clip& other) const;
+        bool operator!=(const Clip& other) const { return !(*this == other); }
+    };
+    typedef QVector<Clip> ClipList;
+
+    enum Edit {
+        RippleTrimIn,
+        RippleTrimOut,
+        Roll,
+        Slip,
+        Slide
+    };
+
+    int trackCount() const { return m_tracks.count(); }
+    const ClipList& track(int trackIndex) const { return m_tracks.at(trackIndex); }
+    void appendTrack(const ClipList& clips) { m_tracks.append(clips); }
+    void setTrack(int trackIndex, const ClipList& clips) { m_tracks[trackIndex] = clips; }
+
+    // The clip index is the one in the playlist the graph was made from. Each
+    // edit returns false and leaves the graph as it was if it is not possible.
+    bool edit(Edit edit, int trackIndex, int clipIndex, int delta);
+    bool rippleTrimIn(int trackIndex, int clipIndex, int delta);
+    bool rippleTrimOut(int trackIndex, int clipIndex, int delta);
+    bool roll(int trackIndex, int clipIndex, int delta);
+    bool slip(int trackIndex, int clipIndex, int delta);
+    bool slide(int trackIndex, int clipIndex, int delta);
+
+private:
+    int find(int trackIndex, int clipIndex) const;
+    bool isLocked(int trackIndex, int i) const;
+    bool canRipple(int trackIndex, int position, int delta) const;
+    void ripple(int position, int delta);
+
+    QVector<ClipList> m_tracks;
+};
+
+#endif // TIMELINEGRAPH_H
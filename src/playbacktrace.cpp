@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "playbacktrace.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSaveFile>
+#include <QThread>
+#include <QHash>
+#include <QDebug>
+
+// Keep about the last few minutes of playback.
+static const int kMaxEvents = 100000;
+static const char* kStageNames[] = { "render", "wait", "upload", "paint" };
+// The upper bounds of the seek latency histogram buckets in milliseconds.
+static const int kLatencyBuckets[] = { 10, 20, 50, 100, 200, 500 };
+static const int kLatencyBucketCount = sizeof(kLatencyBuckets) / sizeof(kLatencyBuckets[0]);
+
+PlaybackTrace::PlaybackTrace()
+    : m_isEnabled(0)
+    , m_windowStart(0)
+    , m_frames(0)
+    , m_dropped(0)
+    , m_late(0)
+    , m_seekHistogram(kLatencyBucketCount + 1, 0)
+{
+    m_clock.start();
+    for (int i = 0; i < StageCount; i++) {
+        m_stageTotal[i] = 0;
+        m_stageCount[i] = 0;
+    }
+}
+
+PlaybackTrace& PlaybackTrace::singleton()
+{
+    static PlaybackTrace instance;
+    return instance;
+}
+
+void PlaybackTrace::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_isEnabled = enabled;
+    m_events.clear();
+    m_summary.clear();
+    m_windowStart = now();
+    m_frames = m_dropped = m_late = 0;
+    for (int i = 0; i < StageCount; i++) {
+        m_stageTotal[i] = 0;
+        m_stageCount[i] = 0;
+    }
+    m_seekHistogram.fill(0);
+}
+
+void PlaybackTrace::add(Stage stage, qint64 start, qint64 end)
+{
+    if (!isEnabled())
+        return;
+    Event event;
+    event.start = start;
+    event.duration = end - start;
+    event.thread = (quint64) QThread::currentThreadId();
+    event.stage = stage;
+    QMutexLocker locker(&m_mutex);
+    if (m_events.size() >= kMaxEvents)
+        m_events.remove(0, kMaxEvents / 2);
+    m_events.append(event);
+    m_stageTotal[stage] += event.duration;
+    ++m_stageCount[stage];
+}
+
+void PlaybackTrace::addFrame(bool isDropped)
+{
+    if (!isEnabled())
+        return;
+    QMutexLocker locker(&m_mutex);
+    if (isDropped)
+        ++m_dropped;
+    else
+        ++m_frames;
+}
+
+void PlaybackTrace::addLate()
+{
+    if (!isEnabled())
+        return;
+    QMutexLocker locker(&m_mutex);
+    ++m_late;
+}
+
+void PlaybackTrace::addSeekLatency(qint64 ms)
+{
+    if (!isEnabled())
+        return;
+    int bucket = 0;
+    while (bucket < kLatencyBucketCount && ms >= kLatencyBuckets[bucket])
+        ++bucket;
+    QMutexLocker locker(&m_mutex);
+    ++m_seekHistogram[bucket];
+}
+
+QString PlaybackTrace::summary()
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 elapsed = now() - m_windowStart;
+    if (elapsed >= 1000000) {
+        m_summary = QString("%1 fps  %2 dropped  %3 late")
+                .arg(m_frames * 1000000.0 / elapsed, 0, 'f', 1)
+                .arg(m_dropped).arg(m_late);
+        for (int i = 0; i < StageCount; i++) {
+            double ms = m_stageCount[i]? m_stageTotal[i] / 1000.0 / m_stageCount[i] : 0.0;
+            m_summary += QString("  %1 %2 ms").arg(kStageNames[i]).arg(ms, 0, 'f', 1);
+            m_stageTotal[i] = 0;
+            m_stageCount[i] = 0;
+        }
+        m_windowStart += elapsed;
+        m_frames = m_dropped = m_late = 0;
+        // The seeks are counted since the trace was enabled.
+        m_summary += "\nseeks";
+        for (int i = 0; i < kLatencyBucketCount; i++)
+            m_summary += QString("  <%1 ms %2").arg(kLatencyBuckets[i]).arg(m_seekHistogram[i]);
+        m_summary += QString("  >=%1 ms %2").arg(kLatencyBuckets[kLatencyBucketCount - 1])
+                .arg(m_seekHistogram[kLatencyBucketCount]);
+    }
+    return m_summary;
+}
+
+bool PlaybackTrace::save(const QString& fileName)
+{
+    // Number the threads in order of appearance.
+    QJsonArray events;
+    QHash<quint64, int> threads;
+    m_mutex.lock();
+    foreach (Event event, m_events) {
+        if (!threads.contains(event.thread))
+            threads.insert(event.thread, threads.size() + 1);
+        QJsonObject json;
+        json["name"] = kStageNames[event.stage];
+        json["ph"] = "X";
+        json["ts"] = event.start;
+        json["dur"] = event.duration;
+        json["pid"] = 1;
+        json["tid"] = threads.value(event.thread);
+        events.append(json);
+    }
+    m_mutex.unlock();
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+    QSaveFile f(fileName);
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        if (f.commit())
+            return true;
+    }
+    qWarning() << "failed to save the playback trace" << fileName;
+    return false;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYBACKTRACE_H
+#define PLAYBACKTRACE_H
+
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+// Records how long each stage of showing a frame takes while enabled. The
+// stages run on different threads: render (decoding and filters on the
+// consumer's threads until the frame is shown), wait (for the renderer to
+// accept it), upload (to textures), and paint. It also keeps a histogram of
+// how long seeks take to show. The result is summarized for the player's
+// overlay and can be saved in the Chrome trace event format
+// (chrome://tracing).
+class PlaybackTrace
+{
+public:
+    enum Stage {
+        RenderStage,
+        WaitStage,
+        UploadStage,
+        PaintStage,
+        StageCount
+    };
+
+    static PlaybackTrace& singleton();
+    bool isEnabled() const { return m_isEnabled.load(); }
+    void setEnabled(bool enabled);
+    // Microseconds since the application started.
+    qint64 now() const { return m_clock.nsecsElapsed() / 1000; }
+    void add(Stage stage, qint64 start, qint64 end);
+    void addFrame(bool isDropped);
+    void addLate();
+    void addSeekLatency(qint64 ms);
+    QString summary();
+    bool save(const QString& fileName);
+
+private:
+    PlaybackTrace();
+
+    struct Event {
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+        Stage stage;
+    };
+
+    QMutex m_mutex;
+    QAtomicInt m_isEnabled;
+    QElapsedTimer m_clock;
+    QVector<Event> m_events;
+    // The statistics of the current one second window.
+    qint64 m_windowStart;
+    qint64 m_stageTotal[StageCount];
+    int m_stageCount[StageCount];
+    int m_frames;
+    int m_dropped;
+    int m_late;
+    QVector<int> m_seekHistogram;
+    QString m_summary;
+};
+
+#define TRACE PlaybackTrace::singleton()
+
+#endif // PLAYBACKTRACE_H
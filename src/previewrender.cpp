@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewrender.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QScopedPointer>
+#include <QFileInfo>
+#include <QThread>
+#include <QDir>
+#include <QDebug>
+#include <Mlt.h>
+#include "mltcontroller.h"
+#include "models/multitrackmodel.h"
+
+static const int kChunkSeconds = 5;
+
+static void addService(QCryptographicHash& hash, Mlt::Service& service, bool isTrack = false);
+
+static void addProperties(QCryptographicHash& hash, Mlt::Properties& properties, bool isTrack)
+{
+    for (int i = 0; i < properties.count(); i++) {
+        const char* name = properties.get_name(i);
+        const char* value = properties.get(i);
+        // Skip the internal state that changes while rendering. The extent
+        // of a track changes with edits elsewhere on it.
+        if (!name || !value || name[0] == '_')
+            continue;
+        if (isTrack && (!qstrcmp(name, "in") || !qstrcmp(name, "out") || !qstrcmp(name, "length")))
+            continue;
+        hash.addData(name);
+        hash.addData("=");
+        hash.addData(value);
+        hash.addData("\n");
+    }
+}
+
+static void addClip(QCryptographicHash& hash, Mlt::ClipInfo& info)
+{
+    hash.addData(QByteArray::number(info.start) + " " +
+                 QByteArray::number(info.frame_in) + " " +
+                 QByteArray::number(info.frame_out) + "\n");
+    if (info.cut)
+        addService(hash, *info.cut);
+    if (info.producer && info.producer->get_producer() != (info.cut? info.cut->get_producer() : 0))
+        addService(hash, *info.producer);
+}
+
+static void addTransitions(QCryptographicHash& hash, Mlt::Tractor& tractor)
+{
+    // The transitions planted in the field are chained in front of the tractor.
+    Mlt::Service* service = tractor.producer();
+    while (service && service->is_valid()
+           && (service->type() == transition_type || service->type() == filter_type)) {
+        addProperties(hash, *service, false);
+        Mlt::Service* next = service->producer();
+        delete service;
+        service = next;
+    }
+    delete service;
+}
+
+static void addService(QCryptographicHash& hash, Mlt::Service& service, bool isTrack)
+{
+    addProperties(hash, service, isTrack);
+    for (int i = 0; i < service.filter_count(); i++) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        if (filter && filter->is_valid())
+            addProperties(hash, *filter, false);
+    }
+    if (isTrack)
+        return;
+    if (service.type() == tractor_type) {
+        // A transition on the timeline is a tractor.
+        Mlt::Tractor tractor(service);
+        addTransitions(hash, tractor);
+        for (int i = 0; i < tractor.count(); i++) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(i));
+            if (track && track->is_valid())
+                addService(hash, *track);
+        }
+    } else if (service.type() == playlist_type) {
+        Mlt::Playlist playlist(service);
+        for (int i = 0; i < playlist.count(); i++) {
+            QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(i));
+            if (info)
+                addClip(hash, *info);
+        }
+    }
+}
+
+PreviewRender::PreviewRender(MultitrackModel& model, QObject* parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_chunkLength(0)
+    , m_length(0)
+    , m_revision(0)
+    , m_isDirty(true)
+    , m_isPreviewDirty(false)
+    , m_isEnabled(false)
+    , m_renderingIndex(-1)
+{
+    // Each session renders to its own folder, locked while it runs, so that
+    // another Shotcut does not remove its chunks.
+    QDir root(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/preview");
+    foreach (QString name, root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QString lockName = root.filePath(name) + "/lock";
+        QLockFile lockFile(lockName);
+        // Only a session that is no longer running leaves the lock stale.
+        lockFile.setStaleLockTime(0);
+        if (QFile::exists(lockName) && lockFile.tryLock(0)) {
+            lockFile.unlock();
+            QDir(root.filePath(name)).removeRecursively();
+        }
+    }
+    m_dir = root.filePath(QString::number(QCoreApplication::applicationPid()));
+    m_xmlName = m_dir + "/timeline.mlt";
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+    m_lockFile.reset(new QLockFile(m_dir + "/lock"));
+    m_lockFile->setStaleLockTime(0);
+    if (!m_lockFile->tryLock(0))
+        qWarning() << "failed to lock the preview folder" << m_dir;
+    m_process.setStandardOutputFile(QProcess::nullDevice());
+    m_process.setStandardErrorFile(QProcess::nullDevice());
+    m_timer.setInterval(1000);
+    connect(&m_timer, SIGNAL(timeout()), SLOT(onTimeout()));
+    connect(&m_process, SIGNAL(finished(int,QProcess::ExitStatus)), SLOT(onFinished(int,QProcess::ExitStatus)));
+    connect(&model, SIGNAL(modified()), SLOT(invalidate()));
+    connect(&model, SIGNAL(closed()), SLOT(invalidate()));
+}
+
+PreviewRender::~PreviewRender()
+{
+    stopRendering();
+    m_process.waitForFinished(3000);
+    m_lockFile.reset();
+    QDir(m_dir).removeRecursively();
+}
+
+void PreviewRender::setEnabled(bool enabled)
+{
+    m_isEnabled = enabled;
+    if (enabled) {
+        m_isDirty = true;
+        m_timer.start();
+    } else {
+        m_timer.stop();
+        clear();
+    }
+}
+
+void PreviewRender::invalidate()
+{
+    m_isDirty = true;
+}
+
+void PreviewRender::onTimeout()
+{
+    Mlt::Tractor* tractor = m_model.tractor();
+    if (!tractor || !tractor->is_valid()) {
+        if (!m_chunks.isEmpty())
+            clear();
+        return;
+    }
+    // Filter changes do not modify the model, but they do refresh the
+    // consumer, which starts a new frame cache revision.
+    if (MLT.frameCache().revision() != m_revision)
+        m_isDirty = true;
+    if (m_isDirty)
+        update(*tractor);
+
+    // Only use the idle time of the player.
+    if (MLT.producer() && MLT.producer()->get_speed() != 0)
+        return;
+    if (m_isPreviewDirty)
+        updatePreview(*tractor);
+    if (m_process.state() == QProcess::NotRunning)
+        renderNext(*tractor);
+}
+
+void PreviewRender::update(Mlt::Tractor& tractor)
+{
+    m_isDirty = false;
+    m_revision = MLT.frameCache().revision();
+    m_length = tractor.get_length();
+    m_chunkLength = qMax(1, qRound(MLT.profile().fps() * kChunkSeconds));
+    int count = (m_length + m_chunkLength - 1) / m_chunkLength;
+    for (int i = count; i < m_chunks.count(); i++) {
+        if (!m_chunks[i].renderedDigest.isEmpty())
+            QFile::remove(chunkFileName(m_chunks[i].renderedDigest));
+    }
+    bool isStale = m_chunks.count() > count;
+    m_chunks.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        Chunk& chunk = m_chunks[i];
+        int start = i * m_chunkLength;
+        chunk.digest = digest(tractor, start, qMin(start + m_chunkLength, m_length) - 1);
+        if (!chunk.renderedDigest.isEmpty() && chunk.renderedDigest != chunk.digest) {
+            QFile::remove(chunkFileName(chunk.renderedDigest));
+            chunk.renderedDigest.clear();
+            isStale = true;
+        }
+    }
+    if (m_renderingIndex >= count
+            || (m_renderingIndex >= 0 && m_chunks[m_renderingIndex].digest != m_renderingDigest))
+        stopRendering();
+    // Write the XML again before the next render.
+    QFile::remove(m_xmlName);
+    // Playback must not continue to use a stale chunk.
+    if (isStale)
+        updatePreview(tractor);
+}
+
+void PreviewRender::renderNext(Mlt::Tractor& tractor)
+{
+    if (m_chunks.isEmpty())
+        return;
+
+    // Render the range between the in and out points when the timeline has
+    // them. Start at the playhead and wrap around.
+    int first = 0;
+    int last = m_chunks.count() - 1;
+    int position = 0;
+    Mlt::Producer* producer = MLT.producer();
+    if (producer && producer->get_producer() == tractor.get_producer()) {
+        first = qMin(last, producer->get_in() / m_chunkLength);
+        last = qBound(first, producer->get_out() / m_chunkLength, last);
+        position = producer->position() / m_chunkLength;
+    }
+    int count = last - first + 1;
+    int start = qBound(first, position, last) - first;
+    int index = -1;
+    for (int n = 0; n < count && index < 0; n++) {
+        int i = first + (start + n) % count;
+        const Chunk& chunk = m_chunks.at(i);
+        if (chunk.renderedDigest.isEmpty() && chunk.failedDigest != chunk.digest)
+            index = i;
+    }
+    if (index < 0)
+        return;
+
+    if (!QFile::exists(m_xmlName)) {
+        QDir().mkpath(m_dir);
+        if (!Mlt::Controller::writeXML(m_xmlName, MLT.XML(&tractor, m_dir))) {
+            qWarning() << "failed to write" << m_xmlName;
+            return;
+        }
+    }
+    m_renderingIndex = index;
+    m_renderingDigest = m_chunks.at(index).digest;
+    int in = index * m_chunkLength;
+    int out = qMin(in + m_chunkLength, m_length) - 1;
+
+    QStringList args;
+    args << "-quiet" << m_xmlName;
+    args << QString("in=%1").arg(in) << QString("out=%1").arg(out);
+    args << "-consumer" << "avformat:" + chunkFileName(m_renderingDigest);
+    // Every frame is a key frame so that playback can start anywhere.
+    args << "f=mov" << "vcodec=mjpeg" << "qscale=2" << "acodec=pcm_s16le";
+    args << QString("real_time=-%1").arg(qMax(1, QThread::idealThreadCount() / 2));
+    args << "terminate_on_pause=1";
+
+    QString shotcutPath = qApp->applicationDirPath();
+#ifdef Q_OS_WIN
+    QFileInfo meltPath(shotcutPath, "qmelt.exe");
+    m_process.start(meltPath.absoluteFilePath(), args);
+#else
+    QFileInfo meltPath(shotcutPath, "qmelt");
+    args.prepend(meltPath.absoluteFilePath());
+    m_process.start("/usr/bin/nice", args);
+#endif
+    qDebug() << "rendering preview" << in << out;
+}
+
+void PreviewRender::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    int index = m_renderingIndex;
+    m_renderingIndex = -1;
+    if (index < 0) {
+        // Stopped because the chunk changed.
+        QFile::remove(chunkFileName(m_renderingDigest));
+    } else if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        m_chunks[index].renderedDigest = m_renderingDigest;
+        m_isPreviewDirty = true;
+    } else {
+        // Do not try again until something changes in its range.
+        qWarning() << "preview render failed with" << exitCode;
+        QFile::remove(chunkFileName(m_renderingDigest));
+        m_chunks[index].failedDigest = m_renderingDigest;
+    }
+    m_renderingDigest.clear();
+}
+
+void PreviewRender::updatePreview(Mlt::Tractor& tractor)
+{
+    m_isPreviewDirty = false;
+    bool hasRendered = false;
+    foreach (const Chunk& chunk, m_chunks)
+        hasRendered |= !chunk.renderedDigest.isEmpty();
+    if (!hasRendered) {
+        MLT.setPreview(0, 0);
+        return;
+    }
+
+    // Make a playlist of the same length with the rendered chunks and cuts of
+    // the timeline between them.
+    Mlt::Playlist* playlist = new Mlt::Playlist(MLT.profile());
+    for (int i = 0; i < m_chunks.count(); i++) {
+        const Chunk& chunk = m_chunks.at(i);
+        int in = i * m_chunkLength;
+        int out = qMin(in + m_chunkLength, m_length) - 1;
+        if (!chunk.renderedDigest.isEmpty()) {
+            Mlt::Producer clip(MLT.profile(), chunkFileName(chunk.renderedDigest).toUtf8().constData());
+            if (clip.is_valid() && clip.get_length() > out - in) {
+                playlist->append(clip, 0, out - in);
+                continue;
+            }
+        }
+        playlist->append(tractor, in, out);
+    }
+    MLT.setPreview(playlist, &tractor);
+}
+
+void PreviewRender::stopRendering()
+{
+    if (m_process.state() != QProcess::NotRunning) {
+        m_renderingIndex = -1;
+        m_process.kill();
+    }
+}
+
+void PreviewRender::clear()
+{
+    stopRendering();
+    m_chunks.clear();
+    m_isPreviewDirty = false;
+    m_isDirty = true;
+    MLT.setPreview(0, 0);
+    foreach (QString name, QDir(m_dir).entryList(QStringList("*.mov"), QDir::Files))
+        QFile::remove(QDir(m_dir).filePath(name));
+}
+
+QString PreviewRender::chunkFileName(const QByteArray& digest) const
+{
+    return QString("%1/%2.mov").arg(m_dir).arg(QString::fromLatin1(digest.toHex()));
+}
+
+QByteArray PreviewRender::digest(Mlt::Tractor& tractor, int start, int end) const
+{
+    // Everything that contributes to the frames from start to end.
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(start) + " " + QByteArray::number(end) + "\n");
+    addTransitions(hash, tractor);
+    for (int i = 0; i < tractor.count(); i++) {
+        QScopedPointer<Mlt::Producer> track(tractor.track(i));
+        if (!track || !track->is_valid())
+            continue;
+        addService(hash, *track, true);
+        Mlt::Playlist playlist(*track);
+        if (!playlist.is_valid())
+            continue;
+        int last = playlist.get_clip_index_at(end);
+        for (int j = playlist.get_clip_index_at(start); j <= last; j++) {
+            QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(j));
+            if (info)
+                addClip(hash, *info);
+        }
+    }
+    return hash.result();
+}
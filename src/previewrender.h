@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWRENDER_H
+#define PREVIEWRENDER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QVector>
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QLockFile>
+
+class MultitrackModel;
+namespace Mlt {
+    class Tractor;
+}
+
+// Renders the timeline ahead of time, while the player is idle, in chunks of
+// a few seconds to intra-only files in a cache folder of this session. Playback substitutes
+// the rendered chunks for the timeline through Mlt::Controller::setPreview().
+// Each chunk remembers a digest of everything that contributes to its range
+// and is rendered again when that changes.
+class PreviewRender : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PreviewRender(MultitrackModel& model, QObject* parent = 0);
+    ~PreviewRender();
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_isEnabled; }
+
+public slots:
+    void invalidate();
+
+private slots:
+    void onTimeout();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    struct Chunk {
+        QByteArray digest;
+        QByteArray renderedDigest; // empty unless the file is ready
+        QByteArray failedDigest;
+    };
+
+    void update(Mlt::Tractor& tractor);
+    void renderNext(Mlt::Tractor& tractor);
+    void updatePreview(Mlt::Tractor& tractor);
+    void stopRendering();
+    void clear();
+    QString chunkFileName(const QByteArray& digest) const;
+    QByteArray digest(Mlt::Tractor& tractor, int start, int end) const;
+
+    MultitrackModel& m_model;
+    QTimer m_timer;
+    QProcess m_process;
+    QVector<Chunk> m_chunks;
+    QString m_dir;
+    QScopedPointer<QLockFile> m_lockFile;
+    QString m_xmlName;
+    int m_chunkLength;
+    int m_length;
+    uint m_revision;
+    bool m_isDirty;
+    bool m_isPreviewDirty;
+    bool m_isEnabled;
+    int m_renderingIndex;
+    QByteArray m_renderingDigest;
+};
+
+#endif // PREVIEWRENDER_H
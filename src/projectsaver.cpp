@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "projectsaver.h"
+#include "projectsnapshot.h"
+#include "proxymanager.h"
+#include <QRunnable>
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDebug>
+
+// Files smaller than this are written before progress would be noticed.
+static const int kProgressThreshold = 4 * 1024 * 1024;
+static const int kChunkSize = 1024 * 1024;
+
+class SaveTask : public QRunnable
+{
+public:
+    SaveTask(ProjectSaver* saver, const QString& fileName, const QString& xml, const QByteArray& snapshot)
+        : QRunnable()
+        , saver(saver)
+        , fileName(fileName)
+        , xml(xml)
+        , snapshot(snapshot)
+    {
+    }
+    void run()
+    {
+        QByteArray data = ProxyManager::originalXML(xml).toUtf8();
+        xml.clear();
+        bool isSuccess = false;
+        bool isProgressShown = data.size() > kProgressThreshold;
+        // QSaveFile syncs the temporary file to the disk before it renames it.
+        QSaveFile file(fileName);
+        if (file.open(QIODevice::WriteOnly)) {
+            qint64 written = 0;
+            int percent = -1;
+            while (written < data.size()) {
+                qint64 n = file.write(data.constData() + written, qMin<qint64>(kChunkSize, data.size() - written));
+                if (n <= 0)
+                    break;
+                written += n;
+                if (isProgressShown && written * 100 / data.size() != percent) {
+                    percent = written * 100 / data.size();
+                    QMetaObject::invokeMethod(saver, "onProgressed", Qt::QueuedConnection,
+                                              Q_ARG(QString, fileName), Q_ARG(int, percent));
+                }
+            }
+            if (written == data.size())
+                isSuccess = file.commit();
+            else
+                file.cancelWriting();
+        }
+        if (!isSuccess) {
+            qWarning() << "failed to save" << fileName << file.errorString();
+            saver->setFailed();
+        } else if (snapshot.isEmpty() || !ProjectSnapshot::save(fileName, snapshot)) {
+            // A snapshot that does not match the XML is not used, but it is
+            // no use either.
+            ProjectSnapshot::remove(fileName);
+        }
+        QMetaObject::invokeMethod(saver, "onFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, fileName), Q_ARG(bool, isSuccess));
+    }
+private:
+    ProjectSaver* saver;
+    QString fileName;
+    QString xml;
+    QByteArray snapshot;
+};
+
+ProjectSaver::ProjectSaver(QObject* parent)
+    : QObject(parent)
+    , m_pending(0)
+    , m_isFailed(false)
+{
+    // One at a time keeps saves of the same file in order.
+    m_pool.setMaxThreadCount(1);
+}
+
+ProjectSaver::~ProjectSaver()
+{
+    m_pool.waitForDone();
+}
+
+void ProjectSaver::save(const QString& fileName, const QString& xml, const QByteArray& snapshot)
+{
+    ++m_pending;
+    m_pool.start(new SaveTask(this, QFileInfo(fileName).absoluteFilePath(), xml, snapshot));
+}
+
+bool ProjectSaver::waitForDone()
+{
+    m_pool.waitForDone();
+    // Report them now to those who track what was saved.
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    QMutexLocker locker(&m_mutex);
+    bool result = !m_isFailed;
+    m_isFailed = false;
+    return result;
+}
+
+void ProjectSaver::setFailed()
+{
+    QMutexLocker locker(&m_mutex);
+    m_isFailed = true;
+}
+
+void ProjectSaver::onProgressed(const QString& fileName, int percent)
+{
+    emit progressed(tr("Saving %1 (%2%)").arg(QFileInfo(fileName).fileName()).arg(percent));
+}
+
+void ProjectSaver::onFinished(const QString& fileName, bool isSuccess)
+{
+    --m_pending;
+    emit saved(fileName, isSuccess);
+}
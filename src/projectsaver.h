@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECTSAVER_H
+#define PROJECTSAVER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QMutex>
+
+// Writes projects to disk on another thread. The caller makes the XML on the
+// GUI thread, so the file holds the project as it was when saving began even
+// if it is edited meanwhile. Proxies in it are replaced by the original media
+// on the other thread. Each file is written to a temporary file next to it,
+// synced to the disk and then renamed over it, so a crash while saving leaves
+// the previous version intact. Saves finish in the order given. A snapshot
+// given with the XML is saved next to it after it, or else an old one is
+// removed.
+class ProjectSaver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProjectSaver(QObject* parent = 0);
+    ~ProjectSaver();
+    void save(const QString& fileName, const QString& xml, const QByteArray& snapshot = QByteArray());
+    bool isSaving() const { return m_pending > 0; }
+    // Blocks until all saves are done, emits saved() for them, and returns
+    // whether they all succeeded.
+    bool waitForDone();
+
+signals:
+    void progressed(const QString& message);
+    void saved(const QString& fileName, bool isSuccess);
+
+private slots:
+    void onProgressed(const QString& fileName, int percent);
+    void onFinished(const QString& fileName, bool isSuccess);
+
+private:
+    friend class SaveTask;
+    void setFailed();
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    int m_pending;
+    bool m_isFailed;
+};
+
+#endif // PROJECTSAVER_H
@@ -0,0 +1,594 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "projectsnapshot.h"
+#include "mediainfocache.h"
+#include "proxymanager.h"
+#include "mltcontroller.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QScopedPointer>
+#include <QDebug>
+#include <Mlt.h>
+
+static const quint32 kMagic = 0x53435053; // SCPS
+static const quint32 kVersion = 1;
+
+enum {
+    ProducerRecord,
+    PlaylistRecord,
+    TractorRecord,
+    RetainRecord,
+    RootRecord
+};
+
+enum {
+    FilterField,
+    TransitionField
+};
+
+// Like the xml consumer with no_meta, leave out what MLT sets up by itself.
+static bool isSaved(const char* name, bool isCut)
+{
+    if (!name || name[0] == '_' || !qstrcmp(name, "mlt_type") || !qstrncmp(name, "meta.", 5)
+            || !qstrncmp(name, "xml", 3))
+        return false;
+    if (isCut && (!qstrcmp(name, "mlt_service") || !qstrcmp(name, "resource") || !qstrcmp(name, "in")
+                  || !qstrcmp(name, "out") || !qstrcmp(name, "length")))
+        return false;
+    return true;
+}
+
+class SnapshotWriter
+{
+public:
+    SnapshotWriter()
+        : m_records(&m_data, QIODevice::WriteOnly)
+        , m_recordCount(0)
+    {
+        m_records.setVersion(QDataStream::Qt_5_0);
+    }
+
+    QByteArray finish(Mlt::Profile& profile, Mlt::Service& service)
+    {
+        Mlt::Producer root(service);
+        qint32 rootId = writeProducer(root);
+        // Services kept by the project that are not part of its graph, such
+        // as the playlist.
+        for (int i = 0; i < root.count(); i++) {
+            QByteArray name(root.get_name(i));
+            if (name.startsWith("xml_retain ") && root.get_data(name.constData())) {
+                Mlt::Producer retained((mlt_producer) root.get_data(name.constData()));
+                qint32 id = writeProducer(retained);
+                m_records << quint8(RetainRecord) << string(name.mid(11).constData()) << id;
+                ++m_recordCount;
+            }
+        }
+        m_records << quint8(RootRecord) << rootId;
+        ++m_recordCount;
+
+        QByteArray result;
+        QDataStream out(&result, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << qint32(profile.width()) << qint32(profile.height()) << qint32(profile.progressive())
+            << qint32(profile.colorspace())
+            << qint32(profile.frame_rate_num()) << qint32(profile.frame_rate_den())
+            << qint32(profile.sample_aspect_num()) << qint32(profile.sample_aspect_den())
+            << qint32(profile.display_aspect_num()) << qint32(profile.display_aspect_den());
+        out << quint32(m_table.count());
+        foreach (QByteArray s, m_table)
+            out << s;
+        out << m_recordCount;
+        out.writeRawData(m_data.constData(), m_data.size());
+        return result;
+    }
+
+private:
+    quint32 string(const char* value)
+    {
+        QByteArray s(value);
+        QHash<QByteArray, quint32>::const_iterator it = m_strings.constFind(s);
+        if (it != m_strings.constEnd())
+            return it.value();
+        quint32 index = m_table.count();
+        m_strings.insert(s, index);
+        m_table << s;
+        return index;
+    }
+
+    void writeProperties(QDataStream& out, Mlt::Properties& properties, bool isCut)
+    {
+        // Like the XML, a snapshot refers to the originals of proxies.
+        QByteArray original;
+        if (!isCut && ProxyManager::isProxy(properties))
+            original = ProxyManager::originalResource(properties);
+        QVector<quint32> pairs;
+        for (int i = 0; i < properties.count(); i++) {
+            const char* name = properties.get_name(i);
+            if (!original.isEmpty() && ProxyManager::isProxyProperty(QString::fromLatin1(name)))
+                continue;
+            if (isSaved(name, isCut)) {
+                const char* value = properties.get(i);
+                if (!original.isEmpty() && !qstrcmp(name, "resource"))
+                    value = original.constData();
+                if (value)
+                    pairs << string(name) << string(value);
+            }
+        }
+        out << quint32(pairs.count() / 2);
+        foreach (quint32 index, pairs)
+            out << index;
+    }
+
+    void writeFilters(QDataStream& out, Mlt::Service& service)
+    {
+        QList<Mlt::Filter*> filters;
+        for (int i = 0; i < service.filter_count(); i++) {
+            Mlt::Filter* filter = service.filter(i);
+            // Normalizing filters are added again when the producer is made.
+            if (filter && filter->is_valid() && !filter->get_int("_loader"))
+                filters << filter;
+            else
+                delete filter;
+        }
+        out << quint32(filters.count());
+        foreach (Mlt::Filter* filter, filters)
+            writeProperties(out, *filter, false);
+        qDeleteAll(filters);
+    }
+
+    void writeReference(QDataStream& out, Mlt::Producer& producer)
+    {
+        bool isCut = producer.is_cut();
+        qint32 id = writeProducer(isCut? producer.parent() : producer);
+        out << id << qint32(producer.get_in()) << qint32(producer.get_out()) << quint8(isCut);
+        if (isCut) {
+            writeProperties(out, producer, true);
+            writeFilters(out, producer);
+        }
+    }
+
+    // Writes what the producer uses before it, and returns its id.
+    qint32 writeProducer(Mlt::Producer& producer)
+    {
+        void* key = producer.get_producer();
+        if (m_ids.contains(key))
+            return m_ids.value(key);
+
+        QByteArray body;
+        QDataStream out(&body, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        quint8 type = ProducerRecord;
+        writeProperties(out, producer, false);
+        if (producer.type() == playlist_type) {
+            type = PlaylistRecord;
+            Mlt::Playlist playlist(producer);
+            out << quint32(playlist.count());
+            for (int i = 0; i < playlist.count(); i++) {
+                if (playlist.is_blank(i)) {
+                    out << qint32(-1) << qint32(0) << qint32(playlist.clip_length(i) - 1) << quint8(0);
+                } else {
+                    QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+                    writeReference(out, *clip);
+                }
+            }
+        } else if (producer.type() == tractor_type) {
+            type = TractorRecord;
+            Mlt::Tractor tractor(producer);
+            out << quint32(tractor.count());
+            for (int i = 0; i < tractor.count(); i++) {
+                QScopedPointer<Mlt::Producer> track(tractor.track(i));
+                if (track && track->is_valid())
+                    writeReference(out, *track);
+                else
+                    out << qint32(-1) << qint32(0) << qint32(0) << quint8(0);
+            }
+            // The filters and transitions planted in the field are connected
+            // in a chain from the tractor back to its tracks.
+            QList<Mlt::Service*> field;
+            Mlt::Service* service = tractor.producer();
+            while (service && service->is_valid()
+                   && (service->type() == filter_type || service->type() == transition_type)) {
+                field.prepend(service);
+                service = service->producer();
+            }
+            delete service;
+            out << quint32(field.count());
+            foreach (Mlt::Service* s, field) {
+                out << quint8(s->type() == filter_type? FilterField : TransitionField);
+                writeProperties(out, *s, false);
+            }
+            qDeleteAll(field);
+        }
+        writeFilters(out, producer);
+
+        qint32 id = m_ids.count();
+        m_ids.insert(key, id);
+        m_records << type << id;
+        m_records.writeRawData(body.constData(), body.size());
+        ++m_recordCount;
+        return id;
+    }
+
+    QHash<QByteArray, quint32> m_strings;
+    QList<QByteArray> m_table;
+    QHash<void*, qint32> m_ids;
+    QByteArray m_data;
+    QDataStream m_records;
+    quint32 m_recordCount;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(Mlt::Profile& profile, bool isLazy, bool isProxied = true)
+        : m_profile(profile)
+        , m_isLazy(isLazy)
+        , m_isProxied(isProxied)
+        , m_isValid(true)
+    {
+    }
+
+    ~SnapshotReader()
+    {
+        qDeleteAll(m_producers);
+    }
+
+    Mlt::Producer* read(QDataStream& in)
+    {
+        qint32 width, height, progressive, colorspace, frameRateNum, frameRateDen,
+               sampleAspectNum, sampleAspectDen, displayAspectNum, displayAspectDen;
+        in >> width >> height >> progressive >> colorspace >> frameRateNum >> frameRateDen
+           >> sampleAspectNum >> sampleAspectDen >> displayAspectNum >> displayAspectDen;
+        if (in.status() != QDataStream::Ok || frameRateDen <= 0 || sampleAspectDen <= 0 || displayAspectDen <= 0)
+            return 0;
+        if (!m_profile.is_explicit()) {
+            m_profile.set_width(width);
+            m_profile.set_height(height);
+            m_profile.set_progressive(progressive);
+            m_profile.set_colorspace(colorspace);
+            m_profile.set_frame_rate(frameRateNum, frameRateDen);
+            m_profile.set_sample_aspect(sampleAspectNum, sampleAspectDen);
+            m_profile.set_display_aspect(displayAspectNum, displayAspectDen);
+        }
+
+        quint32 count;
+        in >> count;
+        m_table.reserve(count);
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+            QByteArray s;
+            in >> s;
+            m_table << s;
+        }
+        in >> count;
+        qint32 rootId = -1;
+        Mlt::Properties retain;
+        for (quint32 i = 0; i < count && m_isValid && in.status() == QDataStream::Ok; i++) {
+            quint8 type;
+            qint32 id;
+            in >> type;
+            if (type == RootRecord) {
+                in >> rootId;
+            } else if (type == RetainRecord) {
+                QByteArray name = string(in);
+                in >> id;
+                Mlt::Producer* producer = producerAt(id);
+                if (producer) {
+                    producer->inc_ref();
+                    retain.set(name.constData(), producer->get_service(), 0, (mlt_destructor) mlt_service_close);
+                }
+            } else {
+                in >> id;
+                if (id != m_producers.count()) {
+                    m_isValid = false;
+                    break;
+                }
+                m_producers << readProducer(in, type);
+            }
+        }
+        Mlt::Producer* root = producerAt(rootId);
+        if (!m_isValid || in.status() != QDataStream::Ok || !root)
+            return 0;
+
+        // Look like what the xml producer returns.
+        Mlt::Producer* result = new Mlt::Producer(*root);
+        result->set("xml", "was here");
+        result->set("_original_type", root->type());
+        if (retain.count() > 0) {
+            retain.inc_ref();
+            result->set("xml_retain", retain.get_properties(), 0, (mlt_destructor) mlt_properties_close);
+        }
+        return result;
+    }
+
+private:
+    typedef QVector<QPair<quint32, quint32> > PropertyList;
+
+    QByteArray string(QDataStream& in)
+    {
+        quint32 index;
+        in >> index;
+        if (index < quint32(m_table.count()))
+            return m_table.at(index);
+        m_isValid = false;
+        return QByteArray();
+    }
+
+    Mlt::Producer* producerAt(qint32 id) const
+    {
+        return (id >= 0 && id < m_producers.count())? m_producers.at(id) : 0;
+    }
+
+    PropertyList readProperties(QDataStream& in)
+    {
+        PropertyList result;
+        quint32 count;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+            quint32 name, value;
+            in >> name >> value;
+            if (name >= quint32(m_table.count()) || value >= quint32(m_table.count())) {
+                m_isValid = false;
+                break;
+            }
+            result << qMakePair(name, value);
+        }
+        return result;
+    }
+
+    QByteArray value(const PropertyList& properties, const char* name) const
+    {
+        for (int i = 0; i < properties.count(); i++) {
+            if (m_table.at(properties.at(i).first) == name)
+                return m_table.at(properties.at(i).second);
+        }
+        return QByteArray();
+    }
+
+    // A proxy keeps its own file and what describes it.
+    void apply(Mlt::Properties& target, const PropertyList& properties, bool isProxy = false)
+    {
+        for (int i = 0; i < properties.count(); i++) {
+            const QByteArray& name = m_table.at(properties.at(i).first);
+            if (isProxy && (name == "resource"
+                    || (name != "length" && ProxyManager::isProxyProperty(QString::fromLatin1(name)))))
+                continue;
+            // The service was chosen when it was made.
+            if (name != "mlt_service")
+                target.set(name.constData(), m_table.at(properties.at(i).second).constData());
+        }
+    }
+
+    void readFilters(QDataStream& in, Mlt::Service& service)
+    {
+        quint32 count;
+        in >> count;
+        for (quint32 i = 0; i < count && m_isValid && in.status() == QDataStream::Ok; i++) {
+            PropertyList properties = readProperties(in);
+            Mlt::Filter filter(m_profile, value(properties, "mlt_service").constData());
+            if (filter.is_valid()) {
+                apply(filter, properties);
+                service.attach(filter);
+            }
+        }
+    }
+
+    // Reads the reference to a producer and the cut of it when there is one.
+    // A playlist takes the cut as its entry, with its properties and filters.
+    Mlt::Producer* readReference(QDataStream& in, int& inPoint, int& outPoint, bool& isBlank)
+    {
+        qint32 id, clipIn, clipOut;
+        quint8 isCut;
+        in >> id >> clipIn >> clipOut >> isCut;
+        inPoint = clipIn;
+        outPoint = clipOut;
+        isBlank = id < 0;
+        Mlt::Producer* parent = producerAt(id);
+        if (!isBlank && !parent)
+            m_isValid = false;
+        if (!isCut || !parent)
+            return parent? new Mlt::Producer(*parent) : 0;
+        Mlt::Producer* cut = parent->cut(clipIn, clipOut);
+        apply(*cut, readProperties(in));
+        readFilters(in, *cut);
+        return cut;
+    }
+
+    Mlt::Producer* readProducer(QDataStream& in, quint8 type)
+    {
+        PropertyList properties = readProperties(in);
+        Mlt::Producer* result = 0;
+        if (type == PlaylistRecord) {
+            Mlt::Playlist* playlist = new Mlt::Playlist(m_profile);
+            apply(*playlist, properties);
+            quint32 count;
+            in >> count;
+            for (quint32 i = 0; i < count && m_isValid && in.status() == QDataStream::Ok; i++) {
+                int inPoint, outPoint;
+                bool isBlank;
+                QScopedPointer<Mlt::Producer> clip(readReference(in, inPoint, outPoint, isBlank));
+                if (isBlank)
+                    playlist->blank(outPoint);
+                else if (clip)
+                    playlist->append(*clip, inPoint, outPoint);
+            }
+            result = playlist;
+        } else if (type == TractorRecord) {
+            Mlt::Tractor* tractor = new Mlt::Tractor(m_profile);
+            apply(*tractor, properties);
+            quint32 count;
+            in >> count;
+            for (quint32 i = 0; i < count && m_isValid && in.status() == QDataStream::Ok; i++) {
+                int inPoint, outPoint;
+                bool isBlank;
+                QScopedPointer<Mlt::Producer> track(readReference(in, inPoint, outPoint, isBlank));
+                if (track)
+                    tractor->set_track(*track, i);
+            }
+            in >> count;
+            for (quint32 i = 0; i < count && m_isValid && in.status() == QDataStream::Ok; i++) {
+                quint8 fieldType;
+                in >> fieldType;
+                PropertyList serviceProperties = readProperties(in);
+                QByteArray service = value(serviceProperties, "mlt_service");
+                if (fieldType == FilterField) {
+                    Mlt::Filter filter(m_profile, service.constData());
+                    if (filter.is_valid()) {
+                        apply(filter, serviceProperties);
+                        tractor->plant_filter(filter, filter.get_int("track"));
+                    }
+                } else {
+                    Mlt::Transition transition(m_profile, service.constData());
+                    if (transition.is_valid()) {
+                        apply(transition, serviceProperties);
+                        tractor->plant_transition(transition, transition.get_int("a_track"), transition.get_int("b_track"));
+                    }
+                }
+            }
+            result = tractor;
+        } else {
+            // Make it the way the xml producer does, through the loader.
+            QByteArray service = value(properties, "mlt_service");
+            QByteArray resource = value(properties, "resource");
+            // Edit with the proxy of a video file when there is one.
+            if (m_isProxied && service.startsWith("avformat") && !resource.isEmpty())
+                result = ProxyManager::open(m_profile, QString::fromUtf8(resource));
+            if (result) {
+                apply(*result, properties, true);
+                readFilters(in, *result);
+                return result;
+            }
+            bool isLazy = m_isLazy && service == "avformat";
+            if (isLazy)
+                service = "avformat-novalidate";
+            if (!resource.isEmpty())
+                service += ":" + resource;
+            result = new Mlt::Producer(m_profile, service.constData());
+            if (!result->is_valid()) {
+                qWarning() << "failed to make" << service;
+                // Keep the ids in step; the project is opened from XML.
+                m_isValid = false;
+            }
+            apply(*result, properties);
+            if (isLazy) {
+                QMap<QString, QString> info = MediaInfoCache::properties(QString::fromUtf8(resource));
+                foreach (QString name, info.keys()) {
+                    if (!result->get(name.toUtf8().constData()))
+                        result->set(name.toUtf8().constData(), info.value(name).toUtf8().constData());
+                }
+            }
+        }
+        readFilters(in, *result);
+        return result;
+    }
+
+    Mlt::Profile& m_profile;
+    bool m_isLazy;
+    bool m_isProxied;
+    bool m_isValid;
+    QList<QByteArray> m_table;
+    QList<Mlt::Producer*> m_producers;
+};
+
+QString ProjectSnapshot::fileName(const QString& projectFileName)
+{
+    return projectFileName + ".snapshot";
+}
+
+QByteArray ProjectSnapshot::write(Mlt::Profile& profile, Mlt::Service& service)
+{
+    if (!service.is_valid())
+        return QByteArray();
+    SnapshotWriter writer;
+    return writer.finish(profile, service);
+}
+
+QString ProjectSnapshot::toXML(const QByteArray& data)
+{
+    // The profile and the services belong to this call only. Media is not
+    // opened, and the originals of proxies stay as they were written.
+    Mlt::Profile profile;
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+    SnapshotReader reader(profile, true, false);
+    QScopedPointer<Mlt::Producer> producer(reader.read(in));
+    if (!producer)
+        return QString();
+    producer->set("xml", (char*) 0);
+    return Mlt::Controller::XML(profile, *producer);
+}
+
+bool ProjectSnapshot::save(const QString& projectFileName, const QByteArray& data)
+{
+    QFileInfo info(projectFileName);
+    QSaveFile file(fileName(projectFileName));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << kMagic << kVersion << info.absoluteFilePath() << qint64(info.size())
+        << qint64(info.lastModified().toMSecsSinceEpoch());
+    out.writeRawData(data.constData(), data.size());
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+void ProjectSnapshot::remove(const QString& projectFileName)
+{
+    QFile::remove(fileName(projectFileName));
+}
+
+Mlt::Producer* ProjectSnapshot::open(Mlt::Profile& profile, const QString& projectFileName, bool isLazy)
+{
+    QFile file(fileName(projectFileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    QByteArray data = file.readAll();
+    file.close();
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    QString path;
+    qint64 size, modified;
+    in >> magic >> version >> path >> size >> modified;
+    QFileInfo info(projectFileName);
+    // The XML was changed, moved or saved without the snapshot.
+    if (in.status() != QDataStream::Ok || magic != kMagic || version != kVersion
+            || path != info.absoluteFilePath() || size != info.size()
+            || modified != info.lastModified().toMSecsSinceEpoch()) {
+        qDebug() << "ignoring stale snapshot of" << projectFileName;
+        return 0;
+    }
+    SnapshotReader reader(profile, isLazy);
+    Mlt::Producer* result = reader.read(in);
+    if (result)
+        result->set("resource", projectFileName.toUtf8().constData());
+    else
+        qWarning() << "failed to read the snapshot of" << projectFileName;
+    return result;
+}
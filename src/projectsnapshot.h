@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECTSNAPSHOT_H
+#define PROJECTSNAPSHOT_H
+
+#include <QString>
+#include <QByteArray>
+
+namespace Mlt {
+    class Producer;
+    class Profile;
+    class Service;
+}
+
+// A binary copy of a timeline project that is kept next to its XML file and
+// opens much faster. It stores the graph of MLT services as the xml consumer
+// would, with every string stored once in a table, and builds the graph again
+// with the MLT API instead of parsing XML. It records the size and time of
+// the XML file it was saved with and is ignored when the XML changed since.
+class ProjectSnapshot
+{
+public:
+    static QString fileName(const QString& projectFileName);
+    // This walks the project, so it runs on the thread that edits it.
+    static QByteArray write(Mlt::Profile& profile, Mlt::Service& service);
+    // Makes the XML of what write() returned, on any thread.
+    static QString toXML(const QByteArray& data);
+    // This is for after the XML is written, on any thread.
+    static bool save(const QString& projectFileName, const QByteArray& data);
+    static void remove(const QString& projectFileName);
+    // Returns 0 when there is no usable snapshot for the project.
+    static Mlt::Producer* open(Mlt::Profile& profile, const QString& projectFileName, bool isLazy = false);
+};
+
+#endif // PROJECTSNAPSHOT_H
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "proxymanager.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QDir>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QHash>
+#include <QDebug>
+#include <Mlt.h>
+#include "mltcontroller.h"
+#include "settings.h"
+#include "jobqueue.h"
+#include "jobs/proxyjob.h"
+
+static const char* kProxyProperty = "shotcut:proxy";
+static const char* kOriginalProperty = "shotcut:resource";
+
+QString ProxyManager::proxyPath(const QString& resource)
+{
+    // A changed original gets a new proxy.
+    QFileInfo info(resource);
+    QByteArray key = info.absoluteFilePath().toUtf8();
+    key += '\n' + QByteArray::number(info.size());
+    key += '\n' + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+    return dir.filePath(QString("proxies/%1.mov")
+        .arg(QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex())));
+}
+
+bool ProxyManager::isEligible(Mlt::Producer& producer)
+{
+    if (!QString(producer.get("mlt_service")).startsWith("avformat") || isProxy(producer))
+        return false;
+    if (producer.get_int("video_index") < 0 || !QFile::exists(QString::fromUtf8(producer.get("resource"))))
+        return false;
+    return producer.get_int("meta.media.height") > Settings.proxyHeight() * 2;
+}
+
+bool ProxyManager::isProxy(Mlt::Properties& producer)
+{
+    return producer.get_int(kProxyProperty);
+}
+
+bool ProxyManager::isQueued(const QString& proxy)
+{
+    for (int row = 0; row < JOBS.rowCount(); row++) {
+        AbstractJob* job = JOBS.jobFromIndex(JOBS.index(row, 0));
+        if (job->objectName() == proxy && (!job->ran() || job->state() != QProcess::NotRunning))
+            return true;
+    }
+    return false;
+}
+
+bool ProxyManager::generate(Mlt::Producer& producer)
+{
+    if (!Settings.proxyEnabled() || !isEligible(producer))
+        return false;
+    QString resource = QString::fromUtf8(producer.get("resource"));
+    QString proxy = proxyPath(resource);
+    if (QFile::exists(proxy) || isQueued(proxy))
+        return false;
+    QDir().mkpath(QFileInfo(proxy).absolutePath());
+
+    // Keep the frame rate and display aspect ratio with square pixels.
+    Mlt::Profile profile;
+    profile.from_producer(producer);
+    int height = qMin(Settings.proxyHeight(), profile.height());
+    int width = qRound(height * profile.dar() / 2.0) * 2;
+    profile.set_width(width);
+    profile.set_height(height);
+    profile.set_sample_aspect(1, 1);
+    profile.set_display_aspect(width, height);
+    profile.set_explicit(1);
+    Mlt::Producer source(profile, resource.toUtf8().constData());
+    if (!source.is_valid())
+        return false;
+    QString xml = Mlt::Controller::XML(profile, source, QDir::tempPath());
+
+    QTemporaryFile tmp(QDir::tempPath().append("/shotcut-XXXXXX"));
+    tmp.open();
+    QString tmpName = tmp.fileName();
+    tmp.close();
+    tmpName.append(".mlt");
+    ProxyJob* job = new ProxyJob(proxy, tmpName);
+    job->setLabel(QObject::tr("Proxy %1").arg(QFileInfo(resource).fileName()));
+
+    // Every frame is a key frame for fast seeking and scrubbing.
+    Mlt::Properties consumer;
+    consumer.set("mlt_service", "avformat");
+    consumer.set("target", job->partialPath().toUtf8().constData());
+    consumer.set("f", "mov");
+    consumer.set("vcodec", "mjpeg");
+    consumer.set("qscale", 3);
+    consumer.set("acodec", "pcm_s16le");
+    consumer.set("real_time", -QThread::idealThreadCount());
+    consumer.set("terminate_on_pause", 1);
+    if (!Mlt::Controller::writeXML(tmpName, xml, &consumer)) {
+        qWarning() << "failed to write" << tmpName;
+        delete job;
+        return false;
+    }
+    JOBS.add(job);
+    return true;
+}
+
+Mlt::Producer* ProxyManager::open(Mlt::Profile& profile, const QString& resource)
+{
+    QString proxy = proxyPath(resource);
+    if (!Settings.proxyEnabled() || !QFile::exists(proxy))
+        return 0;
+    Mlt::Producer* producer = new Mlt::Producer(profile, "avformat-novalidate", proxy.toUtf8().constData());
+    if (!producer->is_valid()) {
+        delete producer;
+        return 0;
+    }
+    producer->set("mute_on_pause", 0);
+    producer->set(kProxyProperty, 1);
+    producer->set(kOriginalProperty, QFileInfo(resource).absoluteFilePath().toUtf8().constData());
+    return producer;
+}
+
+Mlt::Producer* ProxyManager::proxied(Mlt::Profile& profile, Mlt::Producer& clip)
+{
+    Mlt::Producer& parent = clip.parent();
+    if (!Settings.proxyEnabled() || isProxy(parent) || !QString(parent.get("mlt_service")).startsWith("avformat"))
+        return 0;
+    if (!QFile::exists(proxyPath(QString::fromUtf8(parent.get("resource")))))
+        return 0;
+    // Go through XML to keep the properties and filters of the file.
+    int count = 0;
+    QString xml = proxyXML(Mlt::Controller::XML(profile, parent), QString(), count);
+    if (!count)
+        return 0;
+    Mlt::Producer* result = new Mlt::Producer(profile, "xml-string", xml.toUtf8().constData());
+    if (!result->is_valid()) {
+        delete result;
+        return 0;
+    }
+    return result;
+}
+
+QByteArray ProxyManager::originalResource(Mlt::Properties& producer)
+{
+    return QByteArray(producer.get(kOriginalProperty));
+}
+
+// These describe the proxy file, and the original gets its own when opened.
+bool ProxyManager::isProxyProperty(const QString& name)
+{
+    return name == kProxyProperty || name == kOriginalProperty || name == "video_index"
+        || name == "audio_index" || name == "length" || name.startsWith("meta.");
+}
+
+QString ProxyManager::originalXML(const QString& xml)
+{
+    if (!xml.contains(kProxyProperty))
+        return xml;
+
+    // Find the originals of the proxy producers.
+    QHash<QString, QString> originals;
+    QXmlStreamReader reader(xml);
+    QString id;
+    QString original;
+    bool isProxy = false;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement() && reader.name() == QLatin1String("producer")) {
+            id = reader.attributes().value("id").toString();
+            original.clear();
+            isProxy = false;
+        } else if (reader.isStartElement() && reader.name() == QLatin1String("property")) {
+            QStringRef name = reader.attributes().value("name");
+            if (name == QLatin1String(kOriginalProperty))
+                original = reader.readElementText();
+            else if (name == QLatin1String(kProxyProperty))
+                isProxy = reader.readElementText().toInt();
+        } else if (reader.isEndElement() && reader.name() == QLatin1String("producer")) {
+            if (isProxy && !id.isEmpty() && !original.isEmpty())
+                originals.insert(id, original);
+        }
+    }
+    if (reader.hasError() || originals.isEmpty())
+        return xml;
+
+    // Copy the XML, changing the resource of each proxy producer back to its
+    // original and leaving out what describes the proxy.
+    QString result;
+    QXmlStreamWriter writer(&result);
+    reader.clear();
+    reader.addData(xml);
+    int depth = 0;
+    int proxyDepth = -1;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            if (proxyDepth < 0 && reader.name() == QLatin1String("producer")
+                    && originals.contains(reader.attributes().value("id").toString())) {
+                original = originals.value(reader.attributes().value("id").toString());
+                proxyDepth = depth;
+            } else if (proxyDepth == depth - 1 && reader.name() == QLatin1String("property")) {
+                QString name = reader.attributes().value("name").toString();
+                if (isProxyProperty(name)) {
+                    reader.skipCurrentElement();
+                    continue;
+                } else if (name == "resource") {
+                    writer.writeCurrentToken(reader);
+                    writer.writeCharacters(original);
+                    writer.writeEndElement();
+                    reader.skipCurrentElement();
+                    continue;
+                }
+            }
+            ++depth;
+        } else if (reader.isEndElement()) {
+            if (--depth == proxyDepth)
+                proxyDepth = -1;
+        }
+        writer.writeCurrentToken(reader);
+    }
+    if (reader.hasError()) {
+        qWarning() << "failed to restore the originals of proxies" << reader.errorString();
+        return xml;
+    }
+    return result;
+}
+
+QString ProxyManager::proxyXML(const QString& xml, const QString& root, int& count)
+{
+    // Find the video files that have a proxy ready.
+    QHash<QString, QString> originals; // by producer id
+    QDir dir(root);
+    QXmlStreamReader reader(xml);
+    QString id;
+    QString service;
+    QString resource;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement() && reader.name() == QLatin1String("mlt")) {
+            if (reader.attributes().hasAttribute("root"))
+                dir.setPath(reader.attributes().value("root").toString());
+        } else if (reader.isStartElement() && reader.name() == QLatin1String("producer")) {
+            id = reader.attributes().value("id").toString();
+            service = reader.attributes().value("mlt_service").toString();
+            resource.clear();
+        } else if (reader.isStartElement() && reader.name() == QLatin1String("property")) {
+            QStringRef name = reader.attributes().value("name");
+            if (name == QLatin1String("mlt_service"))
+                service = reader.readElementText();
+            else if (name == QLatin1String("resource"))
+                resource = reader.readElementText();
+            else if (name == QLatin1String(kProxyProperty))
+                service.clear();
+        } else if (reader.isEndElement() && reader.name() == QLatin1String("producer")) {
+            if (service.startsWith("avformat") && !id.isEmpty() && !resource.isEmpty()) {
+                QString original = dir.absoluteFilePath(resource);
+                if (QFile::exists(proxyPath(original)))
+                    originals.insert(id, original);
+            }
+        }
+    }
+    count = originals.count();
+    if (reader.hasError() || originals.isEmpty()) {
+        count = 0;
+        return xml;
+    }
+
+    // Copy the XML, changing the resource of each of those producers to its
+    // proxy and leaving out what describes the original.
+    QString result;
+    QXmlStreamWriter writer(&result);
+    reader.clear();
+    reader.addData(xml);
+    int depth = 0;
+    int proxyDepth = -1;
+    QString original;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            if (reader.name() == QLatin1String("mlt")) {
+                writer.writeCurrentToken(reader);
+                // Keep the other relative resources where they are.
+                if (!root.isEmpty() && !reader.attributes().hasAttribute("root"))
+                    writer.writeAttribute("root", dir.absolutePath());
+                ++depth;
+                continue;
+            } else if (proxyDepth < 0 && reader.name() == QLatin1String("producer")
+                    && originals.contains(reader.attributes().value("id").toString())) {
+                original = originals.value(reader.attributes().value("id").toString());
+                proxyDepth = depth;
+            } else if (proxyDepth == depth - 1 && reader.name() == QLatin1String("property")) {
+                QString name = reader.attributes().value("name").toString();
+                if (name != "length" && isProxyProperty(name)) {
+                    reader.skipCurrentElement();
+                    continue;
+                } else if (name == "resource") {
+                    writer.writeCurrentToken(reader);
+                    writer.writeCharacters(proxyPath(original));
+                    writer.writeEndElement();
+                    reader.skipCurrentElement();
+                    continue;
+                }
+            }
+            ++depth;
+        } else if (reader.isEndElement()) {
+            if (--depth == proxyDepth) {
+                proxyDepth = -1;
+                writer.writeStartElement("property");
+                writer.writeAttribute("name", kProxyProperty);
+                writer.writeCharacters("1");
+                writer.writeEndElement();
+                writer.writeStartElement("property");
+                writer.writeAttribute("name", kOriginalProperty);
+                writer.writeCharacters(original);
+                writer.writeEndElement();
+            }
+        }
+        writer.writeCurrentToken(reader);
+    }
+    if (reader.hasError()) {
+        qWarning() << "failed to use proxies" << reader.errorString();
+        count = 0;
+        return xml;
+    }
+    return result;
+}
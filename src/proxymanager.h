@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROXYMANAGER_H
+#define PROXYMANAGER_H
+
+#include <QString>
+#include <QByteArray>
+
+namespace Mlt {
+    class Profile;
+    class Producer;
+    class Properties;
+}
+
+// Proxies are smaller, intra-only copies of large video files that are used
+// for previewing in place of the originals. A proxy producer keeps the path
+// of its original so that saved and exported XML uses the original instead.
+class ProxyManager
+{
+public:
+    static QString proxyPath(const QString& resource);
+    static bool isEligible(Mlt::Producer& producer);
+    static bool isProxy(Mlt::Properties& producer);
+    static bool generate(Mlt::Producer& producer);
+    static Mlt::Producer* open(Mlt::Profile& profile, const QString& resource);
+    // Returns the file of the clip as its proxy when one is ready, or 0.
+    static Mlt::Producer* proxied(Mlt::Profile& profile, Mlt::Producer& clip);
+    static QByteArray originalResource(Mlt::Properties& producer);
+    static bool isProxyProperty(const QString& name);
+    static QString originalXML(const QString& xml);
+    // Relative resources are in root. Count is the number of proxies used.
+    static QString proxyXML(const QString& xml, const QString& root, int& count);
+
+private:
+    static bool isQueued(const QString& proxy);
+};
+
+#endif // PROXYMANAGER_H
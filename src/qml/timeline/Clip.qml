@@ -597,5 +597,33 @@ Rectangle {
             text: qsTr('Split At Playhead (S)')
             onTriggered: timeline.splitClip(trackIndex, index)
         }
+        Menu {
+            visible: !isBlank && !isTransition
+            title: qsTr('Nudge')
+            MenuItem {
+                text: qsTr('Slip Left (Alt+Left)')
+                onTriggered: timeline.slipClip(trackIndex, index, -1)
+            }
+            MenuItem {
+                text: qsTr('Slip Right (Alt+Right)')
+                onTriggered: timeline.slipClip(trackIndex, index, 1)
+            }
+            MenuItem {
+                text: qsTr('Slide Left (Ctrl+Left)')
+                onTriggered: timeline.slideClip(trackIndex, index, -1)
+            }
+            MenuItem {
+                text: qsTr('Slide Right (Ctrl+Right)')
+                onTriggered: timeline.slideClip(trackIndex, index, 1)
+            }
+            MenuItem {
+                text: qsTr('Roll Out Point Left (Shift+Left)')
+                onTriggered: timeline.rollEdit(trackIndex, index, -1)
+            }
+            MenuItem {
+                text: qsTr('Roll Out Point Right (Shift+Right)')
+                onTriggered: timeline.rollEdit(trackIndex, index, 1)
+            }
+        }
     }
 }
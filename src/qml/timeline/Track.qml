@@ -44,6 +44,26 @@ Rectangle {
             repeater.itemAt(i).generateWaveform()
     }
 
+    // Shift ripples the trim to everything after the clip, and Ctrl rolls
+    // the edit point with the clip next to it.
+    function trimIn(trackIndex, clipIndex, delta, modifiers) {
+        if (modifiers & Qt.ShiftModifier)
+            return timeline.rippleTrimClipIn(trackIndex, clipIndex, delta)
+        else if (modifiers & Qt.ControlModifier)
+            return timeline.rollEdit(trackIndex, clipIndex - 1, delta)
+        else
+            return timeline.trimClipIn(trackIndex, clipIndex, delta)
+    }
+
+    function trimOut(trackIndex, clipIndex, delta, modifiers) {
+        if (modifiers & Qt.ShiftModifier)
+            return timeline.rippleTrimClipOut(trackIndex, clipIndex, delta)
+        else if (modifiers & Qt.ControlModifier)
+            return timeline.rollEdit(trackIndex, clipIndex, -delta)
+        else
+            return timeline.trimClipOut(trackIndex, clipIndex, delta)
+    }
+
     function snapClip(clip) {
         Logic.snapClip(clip, repeater)
     }
@@ -116,8 +136,8 @@ Rectangle {
                 if (!(mouse.modifiers & Qt.AltModifier) && toolbar.snap)
                     delta = Logic.snapTrimIn(clip, delta)
                 if (delta != 0) {
-                    if (timeline.trimClipIn(trackRoot.DelegateModel.itemsIndex,
-                                            clip.DelegateModel.itemsIndex, delta)) {
+                    if (trimIn(trackRoot.DelegateModel.itemsIndex, clip.DelegateModel.itemsIndex,
+                               delta, mouse.modifiers)) {
                         // Show amount trimmed as a time in a "bubble" help.
                         var s = timeline.timecode(Math.abs(clip.originalX))
                         s = '%1%2 = %3'.arg((clip.originalX < 0)? '-' : (clip.originalX > 0)? '+' : '')
@@ -141,8 +161,8 @@ Rectangle {
                 if (!(mouse.modifiers & Qt.AltModifier) && toolbar.snap)
                     delta = Logic.snapTrimOut(clip, delta)
                 if (delta != 0) {
-                    if (timeline.trimClipOut(trackRoot.DelegateModel.itemsIndex,
-                                             clip.DelegateModel.itemsIndex, delta)) {
+                    if (trimOut(trackRoot.DelegateModel.itemsIndex, clip.DelegateModel.itemsIndex,
+                                delta, mouse.modifiers)) {
                         // Show amount trimmed as a time in a "bubble" help.
                         var s = timeline.timecode(Math.abs(clip.originalX))
                         s = '%1%2 = %3'.arg((clip.originalX < 0)? '+' : (clip.originalX > 0)? '-' : '')
@@ -407,6 +407,20 @@ Rectangle {
                 timeline.lift(currentClipTrack, currentClip)
             currentClip = -1
             break;
+        case Qt.Key_Left:
+        case Qt.Key_Right:
+            // Alt slips, Ctrl slides, and Shift rolls the out point of the
+            // selected clip by one frame.
+            var delta = (event.key === Qt.Key_Left)? -1 : 1
+            if (currentClip >= 0 && event.modifiers === Qt.AltModifier)
+                timeline.slipClip(currentClipTrack, currentClip, delta)
+            else if (currentClip >= 0 && event.modifiers === Qt.ControlModifier)
+                timeline.slideClip(currentClipTrack, currentClip, delta)
+            else if (currentClip >= 0 && event.modifiers === Qt.ShiftModifier)
+                timeline.rollEdit(currentClipTrack, currentClip, delta)
+            else
+                timeline.pressKey(event.key, event.modifiers)
+            break;
         case Qt.Key_Equal:
             scaleSlider.value += 0.0625
             for (var i = 0; i < tracksRepeater.count; i++)
@@ -27,6 +27,7 @@
 #include <QIODevice>
 #include <QTemporaryFile>
 #include <QFile>
+#include <QThreadPool>
 #include <QtXml>
 #include <MltProducer.h>
 
@@ -191,7 +192,7 @@ void QmlFilter::analyze(bool isAudio)
     m_filter->set("results", NULL, 0);
     int disable = m_filter->get_int("disable");
     m_filter->set("disable", 0);
-    MLT.saveXML(tmpName, &service);
+    QString xml = MLT.XML(&service, QDir::tempPath());
     m_filter->set("disable", disable);
 
     // get temp filename for output xml
@@ -201,43 +202,27 @@ void QmlFilter::analyze(bool isAudio)
     tmpTarget.close();
     target.append(".mlt");
 
-    // parse xml
-    QFile f1(tmpName);
-    f1.open(QIODevice::ReadOnly);
-    QDomDocument dom(tmpName);
-    dom.setContent(&f1);
-    f1.close();
-
-    // add consumer element
-    QDomElement consumerNode = dom.createElement("consumer");
-    QDomNodeList profiles = dom.elementsByTagName("profile");
-    if (profiles.isEmpty())
-        dom.documentElement().insertAfter(consumerNode, dom.documentElement());
-    else
-        dom.documentElement().insertAfter(consumerNode, profiles.at(profiles.length() - 1));
-    consumerNode.setAttribute("mlt_service", "xml");
-    consumerNode.setAttribute("all", 1);
+    // consumer element
+    Mlt::Properties* consumer = new Mlt::Properties;
+    consumer->set("mlt_service", "xml");
+    consumer->set("all", 1);
     if (isAudio)
-        consumerNode.setAttribute("video_off", 1);
+        consumer->set("video_off", 1);
     else
-        consumerNode.setAttribute("audio_off", 1);
-    consumerNode.setAttribute("no_meta", 1);
-    consumerNode.setAttribute("resource", target);
-
-    // save new xml
-    f1.open(QIODevice::WriteOnly);
-    QTextStream ts(&f1);
-    dom.save(ts, 2);
-    f1.close();
+        consumer->set("audio_off", 1);
+    consumer->set("no_meta", 1);
+    consumer->set("resource", target.toUtf8().constData());
 
-    AbstractJob* job = new MeltJob(target, tmpName);
+    MeltJob* job = new MeltJob(target, tmpName);
     if (job) {
         AnalyzeDelegate* delegate = new AnalyzeDelegate(m_filter);
         connect(job, &AbstractJob::finished, delegate, &AnalyzeDelegate::onAnalyzeFinished);
         connect(job, &AbstractJob::finished, this, &QmlFilter::analyzeFinished);
         QFileInfo info(QString::fromUtf8(service.get("resource")));
         job->setLabel(tr("Analyze %1").arg(info.fileName()));
-        JOBS.add(job);
+        MeltXmlTask* task = new MeltXmlTask;
+        task->add(job, xml, consumer);
+        QThreadPool::globalInstance()->start(task);
     }
 }
 
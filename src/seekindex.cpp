@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "seekindex.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDebug>
+#include <Mlt.h>
+#include "database.h"
+
+SeekIndex::SeekIndex(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_process, SIGNAL(finished(int,QProcess::ExitStatus)), SLOT(onFinished(int,QProcess::ExitStatus)));
+}
+
+SeekIndex& SeekIndex::singleton()
+{
+    static SeekIndex* instance = 0;
+    if (!instance)
+        instance = new SeekIndex(QCoreApplication::instance());
+    return *instance;
+}
+
+bool SeekIndex::findSource(Mlt::Producer& producer, int position,
+                           QString& resource, int& frame, int& firstFrame)
+{
+    // Find the file that supplies the picture at position: the producer
+    // itself, or the clip on the topmost visible video track.
+    QString service(producer.get("mlt_service"));
+    if (service.startsWith("avformat") && !producer.is_cut()) {
+        resource = QString::fromUtf8(producer.get("resource"));
+        frame = position;
+        firstFrame = 0;
+        return true;
+    }
+    if (producer.type() != tractor_type)
+        return false;
+    Mlt::Tractor tractor(producer);
+    bool result = false;
+    for (int i = tractor.count() - 1; i >= 0; i--) {
+        Mlt::Producer* track = tractor.track(i);
+        if (!track)
+            continue;
+        // Skip the black background track, audio tracks, and hidden ones.
+        bool isVideo = !(track->get_int("hide") & 1) && !track->get("shotcut:audio")
+                && !track->get("shotcut:playlist");
+        if (isVideo && track->type() == playlist_type) {
+            Mlt::Playlist playlist(*track);
+            int index = playlist.get_clip_index_at(position);
+            Mlt::ClipInfo* info = playlist.clip_info(index);
+            if (info && info->producer && info->cut && !info->cut->is_blank()) {
+                Mlt::Producer parent(info->producer);
+                if (QString(parent.get("mlt_service")).startsWith("avformat")) {
+                    resource = QString::fromUtf8(parent.get("resource"));
+                    frame = position - info->start + info->frame_in;
+                    firstFrame = info->frame_in;
+                    result = true;
+                }
+                delete info;
+                delete track;
+                break;
+            }
+            delete info;
+        }
+        delete track;
+    }
+    return result;
+}
+
+bool SeekIndex::keyframeAtOrBefore(const QString& resource, int frame, double fps, int& keyframe)
+{
+    if (!m_keyframes.contains(resource)) {
+        QVector<double> times;
+        if (DB.getKeyframes(Database::fingerprint(resource), times)) {
+            m_keyframes.insert(resource, times);
+        } else {
+            // An empty list marks it as pending until the probe finishes.
+            m_keyframes.insert(resource, times);
+            if (QFileInfo(resource).isFile()) {
+                m_queue << resource;
+                probeNext();
+            }
+            return false;
+        }
+    }
+    const QVector<double>& times = m_keyframes[resource];
+    // Look up half a frame later so that rounding cannot skip a key frame.
+    QVector<double>::const_iterator i = qUpperBound(times.begin(), times.end(), (frame + 0.5) / fps);
+    if (i == times.begin())
+        return false;
+    keyframe = qRound(*(i - 1) * fps);
+    return true;
+}
+
+void SeekIndex::probeNext()
+{
+    if (m_process.state() != QProcess::NotRunning || m_queue.isEmpty())
+        return;
+    m_probing = m_queue.takeFirst();
+    QStringList args = probeArguments(m_probing);
+    QString shotcutPath = qApp->applicationDirPath();
+#ifdef Q_OS_WIN
+    QFileInfo path(shotcutPath, "ffprobe.exe");
+    m_process.start(path.absoluteFilePath(), args);
+#else
+    QFileInfo path(shotcutPath, "ffprobe");
+    args.prepend(path.absoluteFilePath());
+    m_process.start("/usr/bin/nice", args);
+#endif
+}
+
+QStringList SeekIndex::probeArguments(const QString& resource, int streamIndex, const QString& streamEntries)
+{
+    // List the video packets to find the key frames without decoding.
+    QStringList args;
+    args << "-v" << "error";
+    args << "-select_streams" << (streamIndex >= 0? QString::number(streamIndex) : QString("v:0"));
+    args << "-show_entries" << "packet=pts_time,flags:stream=start_time"
+            + (streamEntries.isEmpty()? QString() : "," + streamEntries);
+    args << "-of" << "default=nw=1";
+    args << resource;
+    return args;
+}
+
+QVector<double> SeekIndex::readKeyframes(QIODevice& device)
+{
+    QVector<double> times;
+    double startTime = 0.0;
+    double pts = -1.0;
+    while (!device.atEnd()) {
+        QString line = QString::fromUtf8(device.readLine()).trimmed();
+        if (line.startsWith("pts_time=")) {
+            bool ok = false;
+            pts = line.mid(9).toDouble(&ok);
+            if (!ok) pts = -1.0;
+        } else if (line.startsWith("flags=")) {
+            if (pts >= 0.0 && line.mid(6).contains('K'))
+                times << pts;
+            pts = -1.0;
+        } else if (line.startsWith("start_time=")) {
+            startTime = line.mid(11).toDouble();
+        }
+    }
+    for (int i = 0; i < times.size(); i++)
+        times[i] -= startTime;
+    qSort(times);
+    return times;
+}
+
+void SeekIndex::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        QVector<double> times = readKeyframes(m_process);
+        if (!times.isEmpty()) {
+            DB.putKeyframes(Database::fingerprint(m_probing), times);
+            m_keyframes[m_probing] = times;
+        }
+    } else {
+        qWarning() << "failed to index key frames" << m_probing;
+        m_process.readAll();
+    }
+    m_probing.clear();
+    probeNext();
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEEKINDEX_H
+#define SEEKINDEX_H
+
+#include <QObject>
+#include <QProcess>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+
+namespace Mlt {
+    class Producer;
+}
+
+// Knows where the key frames of the media sources are. Each source is listed
+// once with ffprobe in the background, and the result is kept in the database
+// next to the thumbnails. The player uses it to land on key frames while the
+// user scrubs quickly.
+class SeekIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static SeekIndex& singleton();
+    static bool findSource(Mlt::Producer& producer, int position,
+                           QString& resource, int& frame, int& firstFrame);
+    bool keyframeAtOrBefore(const QString& resource, int frame, double fps, int& keyframe);
+    // The ffprobe arguments that list the key frames of a file, and the
+    // reader of its output, which returns their sorted times in seconds
+    // from the start. The stream is the first video one unless an index is
+    // given, and more stream entries may be listed, which the reader skips.
+    static QStringList probeArguments(const QString& resource, int streamIndex = -1,
+                                      const QString& streamEntries = QString());
+    static QVector<double> readKeyframes(QIODevice& device);
+
+private slots:
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    explicit SeekIndex(QObject* parent = 0);
+    void probeNext();
+
+    QHash<QString, QVector<double> > m_keyframes; // seconds from the start
+    QStringList m_queue;
+    QString m_probing;
+    QProcess m_process;
+};
+
+#define SEEKINDEX SeekIndex::singleton()
+
+#endif // SEEKINDEX_H
@@ -169,6 +169,16 @@ void ShotcutSettings::setEncodePath(const QString& s)
     settings.setValue("encode/path", s);
 }
 
+int ShotcutSettings::jobsConcurrency() const
+{
+    return settings.value("jobs/concurrency", 1).toInt();
+}
+
+void ShotcutSettings::setJobsConcurrency(int n)
+{
+    settings.setValue("jobs/concurrency", n);
+}
+
 QStringList ShotcutSettings::meltedServers() const
 {
     return settings.value("melted/servers").toStringList();
@@ -310,6 +320,115 @@ void ShotcutSettings::setPlayerZoom(float f)
     settings.setValue("player/zoom", f);
 }
 
+int ShotcutSettings::playerFrameCache() const
+{
+    return settings.value("player/frameCache", 512).toInt();
+}
+
+void ShotcutSettings::setPlayerFrameCache(int megabytes)
+{
+    settings.setValue("player/frameCache", megabytes);
+}
+
+bool ShotcutSettings::playerRenderAhead() const
+{
+    return settings.value("player/renderAhead", false).toBool();
+}
+
+void ShotcutSettings::setPlayerRenderAhead(bool b)
+{
+    settings.setValue("player/renderAhead", b);
+}
+
+bool ShotcutSettings::playerAudioScrubber() const
+{
+    return settings.value("player/audioScrubber", true).toBool();
+}
+
+void ShotcutSettings::setPlayerAudioScrubber(bool b)
+{
+    settings.setValue("player/audioScrubber", b);
+}
+
+// 0 for automatic, otherwise the divisor of the resolution while playing
+int ShotcutSettings::playerPreviewScale() const
+{
+    return settings.value("player/previewScale", 1).toInt();
+}
+
+void ShotcutSettings::setPlayerPreviewScale(int divisor)
+{
+    settings.setValue("player/previewScale", divisor);
+}
+
+// Frames to hold each frame before presenting it, trading latency for smoothness
+int ShotcutSettings::playerPresentDelay() const
+{
+    return qBound(0, settings.value("player/presentDelay", 0).toInt(), 8);
+}
+
+void ShotcutSettings::setPlayerPresentDelay(int frames)
+{
+    settings.setValue("player/presentDelay", frames);
+}
+
+// 0 for automatic
+int ShotcutSettings::playerRenderThreads() const
+{
+    return settings.value("player/renderThreads", 0).toInt();
+}
+
+void ShotcutSettings::setPlayerRenderThreads(int count)
+{
+    settings.setValue("player/renderThreads", count);
+}
+
+// 0 for automatic
+int ShotcutSettings::playerDecodeThreads() const
+{
+    return settings.value("player/decodeThreads", 0).toInt();
+}
+
+void ShotcutSettings::setPlayerDecodeThreads(int count)
+{
+    settings.setValue("player/decodeThreads", count);
+}
+
+bool ShotcutSettings::proxyEnabled() const
+{
+    return settings.value("proxy/enabled", true).toBool();
+}
+
+void ShotcutSettings::setProxyEnabled(bool b)
+{
+    settings.setValue("proxy/enabled", b);
+}
+
+int ShotcutSettings::proxyHeight() const
+{
+    return settings.value("proxy/height", 540).toInt();
+}
+
+bool ShotcutSettings::projectLazyLoad() const
+{
+    return settings.value("project/lazyLoad", false).toBool();
+}
+
+void ShotcutSettings::setProjectLazyLoad(bool b)
+{
+    settings.setValue("project/lazyLoad", b);
+}
+
+bool ShotcutSettings::projectSnapshot() const
+{
+    return settings.value("project/snapshot", false).toBool();
+}
+
+void ShotcutSettings::setProjectSnapshot(bool b)
+{
+    settings.setValue("project/snapshot", b);
+}
+
 QString ShotcutSettings::playlistThumbnails() const
 {
     return settings.value("playlist/thumbnails", "small").toString();
@@ -331,6 +450,26 @@ void ShotcutSettings::setTimelineShowWaveforms(bool b)
     emit timelineShowWaveformsChanged();
 }
 
+int ShotcutSettings::undoBudget() const
+{
+    return qBound(1, settings.value("undo/budget", 64).toInt(), 4096);
+}
+
+void ShotcutSettings::setUndoBudget(int megabytes)
+{
+    settings.setValue("undo/budget", megabytes);
+}
+
+bool ShotcutSettings::undoSpill() const
+{
+    return settings.value("undo/spill", true).toBool();
+}
+
+void ShotcutSettings::setUndoSpill(bool b)
+{
+    settings.setValue("undo/spill", b);
+}
+
 QString ShotcutSettings::filterFavorite(const QString& filterName)
 {
     return settings.value("filter/favorite/" + filterName, "").toString();
@@ -68,6 +68,9 @@ public:
     QString encodePath() const;
     void setEncodePath(const QString&);
 
+    int jobsConcurrency() const;
+    void setJobsConcurrency(int);
+
     QStringList meltedServers() const;
     void setMeltedServers(const QStringList&);
 
@@ -97,6 +100,27 @@ public:
     void setPlayerVolume(int);
     float playerZoom() const;
     void setPlayerZoom(float);
+    int playerFrameCache() const;
+    void setPlayerFrameCache(int megabytes);
+    bool playerRenderAhead() const;
+    void setPlayerRenderAhead(bool);
+    bool playerAudioScrubber() const;
+    void setPlayerAudioScrubber(bool);
+    int playerPreviewScale() const;
+    void setPlayerPreviewScale(int);
+    int playerPresentDelay() const;
+    void setPlayerPresentDelay(int frames);
+    int playerRenderThreads() const;
+    void setPlayerRenderThreads(int);
+    int playerDecodeThreads() const;
+    void setPlayerDecodeThreads(int);
+    bool proxyEnabled() const;
+    void setProxyEnabled(bool);
+    int proxyHeight() const;
+    bool projectLazyLoad() const;
+    void setProjectLazyLoad(bool);
+    bool projectSnapshot() const;
+    void setProjectSnapshot(bool);
 
     QString playlistThumbnails() const;
     void setPlaylistThumbnails(const QString&);
@@ -104,6 +128,11 @@ public:
     bool timelineShowWaveforms() const;
     void setTimelineShowWaveforms(bool);
 
+    int undoBudget() const;
+    void setUndoBudget(int megabytes);
+    bool undoSpill() const;
+    void setUndoSpill(bool);
+
     QString filterFavorite(const QString& filterName);
     void setFilterFavorite(const QString& filterName, const QString& value);
 
@@ -22,8 +22,14 @@
 #include <QObject>
 #include <QExplicitlySharedDataPointer>
 #include <MltFrame.h>
+#include <framework/mlt_version.h>
 #include <stdint.h>
 
+// Planar 16-bit 4:2:2 images are available since MLT 6.2.
+#if LIBMLT_VERSION_INT >= ((6<<16)+(2<<8))
+#define SHOTCUT_HAVE_YUV422P16
+#endif
+
 class FrameData;
 
 /*!
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshotbenchmark.h"
+#include "mltcontroller.h"
+#include "projectsnapshot.h"
+#include <QTemporaryFile>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QDir>
+#include <QDebug>
+#include <Mlt.h>
+
+static const int kTrackCount = 4;
+static const int kRuns = 3;
+
+SnapshotBenchmark::SnapshotBenchmark(int clipCount)
+    : QObject(0)
+    , QRunnable()
+    , m_clipCount(clipCount)
+{
+    setAutoDelete(false);
+}
+
+void SnapshotBenchmark::run()
+{
+    emit progressed(tr("Generating a project with %1 clips...").arg(m_clipCount));
+    QString fileName = generate();
+    if (fileName.isEmpty()) {
+        emit finished(tr("Failed to generate the project."));
+        deleteLater();
+        return;
+    }
+
+    // Keep the fastest of a few runs of each.
+    emit progressed(tr("Opening the project from XML..."));
+    qint64 xmlTime = -1;
+    int xmlLength = 0;
+    for (int i = 0; i < kRuns; i++) {
+        Mlt::Profile profile;
+        QElapsedTimer timer;
+        timer.start();
+        Mlt::Producer producer(profile, "xml", fileName.toUtf8().constData());
+        qint64 elapsed = timer.elapsed();
+        if (xmlTime < 0 || elapsed < xmlTime)
+            xmlTime = elapsed;
+        xmlLength = producer.is_valid()? producer.get_length() : 0;
+    }
+    emit progressed(tr("Opening the project from its snapshot..."));
+    qint64 snapshotTime = -1;
+    int snapshotLength = 0;
+    for (int i = 0; i < kRuns; i++) {
+        Mlt::Profile profile;
+        QElapsedTimer timer;
+        timer.start();
+        QScopedPointer<Mlt::Producer> producer(ProjectSnapshot::open(profile, fileName));
+        qint64 elapsed = timer.elapsed();
+        if (snapshotTime < 0 || elapsed < snapshotTime)
+            snapshotTime = elapsed;
+        snapshotLength = producer? producer->get_length() : 0;
+    }
+    qDebug() << "xml" << xmlTime << "ms snapshot" << snapshotTime << "ms";
+
+    QString report = tr("A project with %1 clips on %2 tracks\n").arg(m_clipCount).arg(kTrackCount);
+    report += tr("XML: %1 KiB, opened in %2 ms\n")
+            .arg(QFileInfo(fileName).size() / 1024).arg(xmlTime);
+    report += tr("Snapshot: %1 KiB, opened in %2 ms\n")
+            .arg(QFileInfo(ProjectSnapshot::fileName(fileName)).size() / 1024).arg(snapshotTime);
+    if (xmlLength != snapshotLength)
+        report += tr("The snapshot does not match the XML.\n");
+    else if (snapshotTime > 0)
+        report += tr("The snapshot opens %1 times faster.\n").arg(double(xmlTime) / snapshotTime, 0, 'f', 1);
+    QFile::remove(fileName);
+    ProjectSnapshot::remove(fileName);
+    emit finished(report);
+    deleteLater();
+}
+
+// Builds a timeline like one Shotcut makes, with gaps, filters on some clips,
+// track transitions and a playlist, and saves it with its snapshot.
+QString SnapshotBenchmark::generate()
+{
+    QTemporaryFile tmp(QDir::tempPath().append("/shotcut-XXXXXX"));
+    tmp.open();
+    QString fileName = tmp.fileName();
+    tmp.close();
+    fileName.append(".mlt");
+
+    Mlt::Profile profile;
+    Mlt::Tractor tractor(profile);
+    tractor.set("shotcut", 1);
+    Mlt::Playlist bin(profile);
+    for (int t = 0; t < kTrackCount; t++) {
+        Mlt::Playlist playlist(profile);
+        playlist.set("shotcut:name", QString("V%1").arg(t + 1).toUtf8().constData());
+        for (int i = t; i < m_clipCount; i += kTrackCount) {
+            QString color = QString("#%1").arg(quint32(0xff000000 | (i * 2654435761u >> 8)), 8, 16, QChar('0'));
+            Mlt::Producer producer(profile, QString("color:%1").arg(color).toUtf8().constData());
+            producer.set("length", 1000);
+            producer.set("shotcut:caption", color.toUtf8().constData());
+            if (i % 10 == 0)
+                playlist.blank(i % 30);
+            int in = i % 50;
+            playlist.append(producer, in, in + 24 + i % 25);
+            if (i % 7 == 0) {
+                QScopedPointer<Mlt::Producer> cut(playlist.get_clip(playlist.count() - 1));
+                Mlt::Filter filter(profile, "brightness");
+                filter.set("level", 0.8);
+                filter.set("shotcut:filter", "brightness");
+                cut->attach(filter);
+            }
+            if (i < 100)
+                bin.append(producer);
+        }
+        tractor.set_track(playlist, t);
+        if (t > 0) {
+            Mlt::Transition mix(profile, "mix");
+            mix.set("always_active", 1);
+            mix.set("sum", 1);
+            tractor.plant_transition(mix, 0, t);
+        }
+    }
+    bin.set("id", "main bin");
+    tractor.set("xml_retain main bin", bin.get_service(), 0);
+
+    QString xml = Mlt::Controller::XML(profile, tractor, QFileInfo(fileName).absolutePath());
+    if (!Mlt::Controller::writeXML(fileName, xml))
+        return QString();
+    if (!ProjectSnapshot::save(fileName, ProjectSnapshot::write(profile, tractor))) {
+        QFile::remove(fileName);
+        return QString();
+    }
+    return fileName;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTBENCHMARK_H
+#define SNAPSHOTBENCHMARK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+// Generates a timeline project with thousands of clips, saves it as XML with
+// a snapshot, and measures opening each. It is run from the command line by
+// HeadlessBenchmark and deletes itself after emitting finished().
+class SnapshotBenchmark : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    explicit SnapshotBenchmark(int clipCount = 5000);
+    void run();
+
+signals:
+    void progressed(const QString& message);
+    void finished(const QString& report);
+
+private:
+    QString generate();
+
+    int m_clipCount;
+};
+
+#endif // SNAPSHOTBENCHMARK_H
@@ -10,6 +10,23 @@ win32:DEFINES += QT_STATIC
 include (../QWebSockets/qwebsockets.pri)
 
 SOURCES += main.cpp\
+    headlessexport.cpp \
+    headlessbenchmark.cpp \
+    framecache.cpp \
+    previewrender.cpp \
+    proxymanager.cpp \
+    seekindex.cpp \
+    playbacktrace.cpp \
+    threadbenchmark.cpp \
+    audioscrubber.cpp \
+    commands/undohistory.cpp \
+    autosavejournal.cpp \
+    mediaimporter.cpp \
+    mediainfocache.cpp \
+    models/timelinegraph.cpp \
+    projectsaver.cpp \
+    projectsnapshot.cpp \
+    snapshotbenchmark.cpp \
     mainwindow.cpp \
     mltcontroller.cpp \
     scrubbar.cpp \
@@ -90,6 +107,8 @@ SOURCES += main.cpp\
     jobs/meltjob.cpp \
     jobs/encodejob.cpp \
     jobs/videoqualityjob.cpp \
+    jobs/smartrenderjob.cpp \
+    jobs/proxyjob.cpp \
     commands/playlistcommands.cpp \
     docks/scopedock.cpp \
     controllers/scopecontroller.cpp \
@@ -101,6 +120,23 @@ SOURCES += main.cpp\
     widgets/audioscale.cpp
 
 HEADERS  += mainwindow.h \
+    headlessexport.h \
+    headlessbenchmark.h \
+    framecache.h \
+    previewrender.h \
+    proxymanager.h \
+    seekindex.h \
+    playbacktrace.h \
+    threadbenchmark.h \
+    audioscrubber.h \
+    commands/undohistory.h \
+    autosavejournal.h \
+    mediaimporter.h \
+    mediainfocache.h \
+    models/timelinegraph.h \
+    projectsaver.h \
+    projectsnapshot.h \
+    snapshotbenchmark.h \
     mltcontroller.h \
     scrubbar.h \
     openotherdialog.h \
@@ -180,6 +216,8 @@ HEADERS  += mainwindow.h \
     jobs/meltjob.h \
     jobs/encodejob.h \
     jobs/videoqualityjob.h \
+    jobs/smartrenderjob.h \
+    jobs/proxyjob.h \
     commands/playlistcommands.h \
     docks/scopedock.h \
     controllers/scopecontroller.h \
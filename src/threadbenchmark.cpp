@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "threadbenchmark.h"
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QList>
+#include <QScopedPointer>
+#include <QDebug>
+#include <Mlt.h>
+
+// Sets the decoding threads of the files of an opened project before any
+// frame is got, as the timeline does.
+static void setDecodeThreads(Mlt::Producer& producer, int threads)
+{
+    if (producer.type() == tractor_type) {
+        Mlt::Tractor tractor(producer);
+        for (int i = 0; i < tractor.count(); i++) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(i));
+            if (track && track->is_valid())
+                setDecodeThreads(*track, threads);
+        }
+    } else if (producer.type() == playlist_type) {
+        Mlt::Playlist playlist(producer);
+        for (int i = 0; i < playlist.count(); i++) {
+            QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+            if (clip && clip->is_valid() && !clip->is_blank())
+                setDecodeThreads(clip->parent(), threads);
+        }
+    } else if (QString(producer.get("mlt_service")).startsWith("avformat")) {
+        producer.set("threads", threads);
+    }
+}
+
+ThreadBenchmark::ThreadBenchmark(Mlt::Profile& profile, const QString& xml, int in, int length)
+    : QObject(0)
+    , QRunnable()
+    , m_profile(new Mlt::Profile)
+    , m_xml(xml)
+    , m_in(in)
+    , m_length(length)
+{
+    // Measure with the video mode of the project, in a copy that is not
+    // changed meanwhile.
+    m_profile->set_width(profile.width());
+    m_profile->set_height(profile.height());
+    m_profile->set_progressive(profile.progressive());
+    m_profile->set_colorspace(profile.colorspace());
+    m_profile->set_frame_rate(profile.frame_rate_num(), profile.frame_rate_den());
+    m_profile->set_sample_aspect(profile.sample_aspect_num(), profile.sample_aspect_den());
+    m_profile->set_display_aspect(profile.display_aspect_num(), profile.display_aspect_den());
+    m_profile->set_explicit(1);
+    setAutoDelete(false);
+}
+
+ThreadBenchmark::~ThreadBenchmark()
+{
+    delete m_profile;
+}
+
+void ThreadBenchmark::run()
+{
+    QList<int> renderCounts, decodeCounts;
+    for (int n = 1; n <= QThread::idealThreadCount(); n *= 2)
+        renderCounts << n;
+    for (int n = 1; n <= qMin(4, QThread::idealThreadCount()); n *= 2)
+        decodeCounts << n;
+
+    QString report = tr("Render threads, decoding threads: frames per second\n");
+    double best = 0.0;
+    int bestRender = 1;
+    int bestDecode = 1;
+    foreach (int render, renderCounts) {
+        foreach (int decode, decodeCounts) {
+            if (render * decode > 2 * QThread::idealThreadCount())
+                continue;
+            emit progressed(tr("Measuring %1 render and %2 decoding threads...").arg(render).arg(decode));
+            double fps = measure(render, decode);
+            qDebug() << "render threads" << render << "decode threads" << decode << "fps" << fps;
+            report += QString("%1, %2: %3\n").arg(render).arg(decode).arg(fps, 0, 'f', 1);
+            // Prefer fewer threads unless more are clearly faster.
+            if (fps > best * 1.05) {
+                best = fps;
+                bestRender = render;
+                bestDecode = decode;
+            }
+        }
+    }
+    // Show that setting them on the opened project, as the timeline does,
+    // takes effect as well as setting them in its XML.
+    QList<int> checked;
+    checked << 1;
+    if (bestDecode != 1)
+        checked << bestDecode;
+    foreach (int decode, checked) {
+        emit progressed(tr("Measuring %1 decoding threads set after opening...").arg(decode));
+        double fps = measure(bestRender, decode, false);
+        report += tr("%1, %2 set after opening: %3\n").arg(bestRender).arg(decode).arg(fps, 0, 'f', 1);
+    }
+    emit finished(report, bestRender, bestDecode);
+}
+
+double ThreadBenchmark::measure(int renderThreads, int decodeThreads, bool isInXml)
+{
+    // Set the decoding threads of the video files before they are opened,
+    // or else after.
+    QDomDocument dom;
+    dom.setContent(m_xml);
+    QDomNodeList producers = dom.elementsByTagName("producer");
+    for (int i = 0; i < producers.count(); i++) {
+        QDomElement producer = producers.at(i).toElement();
+        QDomNodeList properties = producer.elementsByTagName("property");
+        bool isAvformat = false;
+        for (int j = properties.count() - 1; j >= 0; j--) {
+            QDomElement property = properties.at(j).toElement();
+            if (property.attribute("name") == "mlt_service")
+                isAvformat = property.text().startsWith("avformat");
+            else if (property.attribute("name") == "threads")
+                producer.removeChild(property);
+        }
+        if (isAvformat && isInXml) {
+            QDomElement property = dom.createElement("property");
+            property.setAttribute("name", "threads");
+            property.appendChild(dom.createTextNode(QString::number(decodeThreads)));
+            producer.appendChild(property);
+        }
+    }
+
+    Mlt::Producer producer(*m_profile, "xml-string", dom.toString(0).toUtf8().constData());
+    if (!producer.is_valid())
+        return 0.0;
+    if (!isInXml)
+        setDecodeThreads(producer, decodeThreads);
+    Mlt::Producer cut(producer.cut(m_in, m_in + m_length - 1));
+    Mlt::Consumer consumer(*m_profile, "null");
+    consumer.set("real_time", -renderThreads);
+    consumer.set("terminate_on_pause", 1);
+    consumer.set("mlt_image_format", "yuv422");
+    consumer.connect(cut);
+    QElapsedTimer timer;
+    timer.start();
+    consumer.run();
+    qint64 elapsed = timer.elapsed();
+    return elapsed > 0? m_length * 1000.0 / elapsed : 0.0;
+}
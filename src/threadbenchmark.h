@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Meltytech, LLC
+ * Author: Dan Dennedy <dan@dennedy.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADBENCHMARK_H
+#define THREADBENCHMARK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+namespace Mlt {
+    class Profile;
+}
+
+// Measures the frame rate of rendering a few seconds of a project, as the
+// preview does, with each combination of render and decoding threads. It is
+// run from the command line by HeadlessBenchmark.
+class ThreadBenchmark : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    ThreadBenchmark(Mlt::Profile& profile, const QString& xml, int in, int length);
+    ~ThreadBenchmark();
+    void run();
+
+signals:
+    void progressed(const QString& message);
+    void finished(const QString& report, int renderThreads, int decodeThreads);
+
+private:
+    double measure(int renderThreads, int decodeThreads, bool isInXml = true);
+
+    Mlt::Profile* m_profile;
+    QString m_xml;
+    int m_in;
+    int m_length;
+};
+
+#endif // THREADBENCHMARK_H
@@ -54,11 +54,23 @@ void VideoWaveformScopeWidget::refreshScope(const QSize& size, bool full)
         m_renderImg.fill(bgColor);
 
         const uint8_t* yData = m_frame.get_image();
+        // Luma is every other byte of packed 4:2:2, and the high byte of
+        // each 16-bit sample of planar 4:2:2.
+        int step = 1;
+        int offset = 0;
+        if (m_frame.get_image_format() == mlt_image_yuv422)
+            step = 2;
+#ifdef SHOTCUT_HAVE_YUV422P16
+        if (m_frame.get_image_format() == mlt_image_yuv422p16) {
+            step = 2;
+            offset = 1;
+        }
+#endif
 
         for (int x = 0; x < columns; x++) {
             int pixels = m_frame.get_image_height();
             for (int j = 0; j < pixels; j++) {
-                int y = 255 - (yData[j * columns + x]);
+                int y = 255 - (yData[(j * columns + x) * step + offset]);
                 QRgb currentVal = m_renderImg.pixel(x,y);
                 if (currentVal < 0xffffffff) {
                     currentVal += 0x0f0f0f0f;